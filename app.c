@@ -1,5 +1,10 @@
 #include "app.h"
 #include "src/alloc_free.h"
+#include "src/frame.h"
+#include "src/ha.h"
+#include "src/ha_history.h"
+#include "src/ha_poll.h"
+#include "src/wifi_link.h"
 #include "libs/jsmn.h"
 #include <storage/storage.h>
 
@@ -7,6 +12,9 @@ const uint16_t polling_values[4] = {500U, 1000U, 5000U, 10000U};
 const char* polling_names[4] = {"500ms", "1s", "5s", "10s"};
 const char* ctrl_mode_names[3] = {"Wifi", "Sghz+BT Home", "Bt Serial"};
 const char* randomize_mac_names[2] = {"Off", "On"};
+const char* bt_buttons_names[2] = {"Single", "Per Ctrl."};
+const uint16_t history_res_values[4] = {10U, 60U, 300U, 900U};
+const char* history_res_names[4] = {"10s", "1m", "5m", "15m"};
 
 static const char FRAME_URL_KEY[] = "frame_url";
 static const char FRAME_SSID_KEY[] = "frame_ssid";
@@ -19,7 +27,9 @@ static const char HA_PASS_KEY[] = "ha_pass";
 static const char HA_POLLING_KEY[] = "ha_polling";
 static const char HA_CTRL_MODE_KEY[] = "ha_ctrl";
 static const char RANDOMIZE_MAC_KEY[] = "bt_randomize_mac";
+static const char BT_BUTTONS_KEY[] = "bt_buttons";
 static const char HA_TOKEN_KEY[] = "ha_token";
+static const char HA_HISTORY_RES_KEY[] = "ha_history_res";
 
 //This pin will be set to 1 to wake the board when the app is in use
 const GpioPin* const pin_wake = &gpio_ext_pa4;
@@ -53,6 +63,8 @@ void save_settings(App* app) {
         furi_json_add_entry(json, HA_POLLING_KEY, (uint32_t)ha_model->polling_rate_index);
         furi_json_add_entry(json, HA_CTRL_MODE_KEY, (uint32_t)ha_model->control_mode);
         furi_json_add_entry(json, RANDOMIZE_MAC_KEY, (uint32_t)ha_model->ble->randomize_mac_enb);
+        furi_json_add_entry(json, HA_HISTORY_RES_KEY, (uint32_t)ha_model->history_res_index);
+        furi_json_add_entry(json, BT_BUTTONS_KEY, (uint32_t)ha_model->ble->multi_object);
 
         furi_json_add_entry(json, HA_TOKEN_KEY, furi_string_get_cstr(ha_model->token));
 
@@ -199,6 +211,28 @@ void load_settings(App* app) {
         FURI_LOG_E(TAG, "Error: Key [%s] not found while loading config.", RANDOMIZE_MAC_KEY);
     }
 
+    value = get_json_value(HA_HISTORY_RES_KEY, furi_string_get_cstr(json), max_tokens);
+    if(value) {
+        uint32_t index = strtoul(value, NULL, 10);
+        if(index < COUNT_OF(history_res_values)) {
+            ha_model->history_res_index = index;
+        }
+        free(value);
+    } else {
+        FURI_LOG_E(TAG, "Error: Key [%s] not found while loading config.", HA_HISTORY_RES_KEY);
+    }
+
+    value = get_json_value(BT_BUTTONS_KEY, furi_string_get_cstr(json), max_tokens);
+    if(value) {
+        uint32_t index = strtoul(value, NULL, 10);
+        if(index < COUNT_OF(bt_buttons_names)) {
+            ha_model->ble->multi_object = index;
+        }
+        free(value);
+    } else {
+        FURI_LOG_E(TAG, "Error: Key [%s] not found while loading config.", BT_BUTTONS_KEY);
+    }
+
     value = get_json_value(HA_TOKEN_KEY, furi_string_get_cstr(json), max_tokens);
     if(value) {
         furi_string_set_str(ha_model->token, value);
@@ -327,6 +361,8 @@ void variable_item_setting_changed(VariableItem* item) {
     FURI_LOG_I(TAG, "Index %u", index);
     switch(index) {
     case ConfigVariableItemPolling:
+        // The warm backend keeps the old period, the next enter starts it again
+        ha_wifi_stop(app);
         ha_model->polling_rate_index = variable_item_get_current_value_index(item);
         variable_item_set_current_value_text(item, polling_names[ha_model->polling_rate_index]);
         ha_model->polling_rate = polling_values[ha_model->polling_rate_index];
@@ -334,6 +370,9 @@ void variable_item_setting_changed(VariableItem* item) {
     case ConfigVariableItemCtrlMode:
         ha_model->control_mode = variable_item_get_current_value_index(item);
         variable_item_set_current_value_text(item, ctrl_mode_names[ha_model->control_mode]);
+        if(ha_model->control_mode != HaCtrlWifi) {
+            ha_wifi_stop(app);
+        }
         break;
 
     case ConfigVariableItemRandomizeMac:
@@ -342,6 +381,20 @@ void variable_item_setting_changed(VariableItem* item) {
             item, randomize_mac_names[variable_item_get_current_value_index(item)]);
         break;
 
+    case ConfigVariableItemHistoryRes:
+        ha_model->history_res_index = variable_item_get_current_value_index(item);
+        variable_item_set_current_value_text(item, history_res_names[ha_model->history_res_index]);
+        // Samples at a different resolution can't share the ring
+        ha_history_reset(ha_model->history, history_res_values[ha_model->history_res_index]);
+        break;
+
+    case ConfigVariableItemBtButtons:
+        // Used by the next beacon_packet_build, when the page opens
+        ha_model->ble->multi_object = variable_item_get_current_value_index(item);
+        variable_item_set_current_value_text(
+            item, bt_buttons_names[variable_item_get_current_value_index(item)]);
+        break;
+
     default:
         FURI_LOG_E(TAG, "Unhandled index [%u] in variable_item_setting_changed.", index);
         return;
@@ -359,6 +412,10 @@ void conf_text_updated(void* context) {
     ReqModel* ha_model = view_get_model(app->view_ha);
     uint8_t upd_flag = 0;
 
+    // The warm backend would keep polling with the old url and payloads, and joining the frame
+    // network under it leaves the ESP32 away from Home Assistant. The next enter restarts it
+    ha_wifi_stop(app);
+
     switch(app->config_index) {
     // Frame
     case ConfigTextInputFramePath:
@@ -406,14 +463,17 @@ void conf_text_updated(void* context) {
         return;
     }
 
+    // Only new credentials are sent from here, probing an association is left to the workers
     switch(upd_flag) {
     case 1U:
-        flipper_http_save_wifi(
-            fhttp, furi_string_get_cstr(app->frame_ssid), furi_string_get_cstr(app->frame_pass));
+        if(!wifi_link_matches(app->wifi_link, app->frame_ssid, app->frame_pass)) {
+            wifi_link_join(app->wifi_link, fhttp, app->frame_ssid, app->frame_pass);
+        }
         break;
     case 2U:
-        flipper_http_save_wifi(
-            fhttp, furi_string_get_cstr(app->ha_ssid), furi_string_get_cstr(app->ha_pass));
+        if(!wifi_link_matches(app->wifi_link, app->ha_ssid, app->ha_pass)) {
+            wifi_link_join(app->wifi_link, fhttp, app->ha_ssid, app->ha_pass);
+        }
         break;
 
     default:
@@ -523,7 +583,10 @@ void setting_item_clicked(void* context, uint32_t index) {
 */
 void comm_thread_timer_callback(void* context) {
     App* app = (App*)context;
-    furi_thread_flags_set(app->comm_thread_id, ThreadCommUpdData);
+    ReqModel* ha_model = view_get_model(app->view_ha);
+    if(ha_poll_tick(&ha_model->poll, ha_model->polling_rate, ha_poll_screen_on(&ha_model->poll))) {
+        furi_thread_flags_set(app->comm_thread_id, ThreadCommUpdData);
+    }
 }
 
 /*
@@ -554,6 +617,10 @@ bool view_custom_event_callback(uint32_t event, void* context) {
     switch(event) {
     // Redraw the screen, called by the timer callback every timer tick
     case EventIdFrameRedrawScreen: {
+        // Presses merged while a request was in flight go out once it's done
+        if(FRAME_DIRECT_ACTION) {
+            frame_send_pending(app);
+        }
         with_view_model(app->view_frame, ReqModel * model, { UNUSED(model); }, true);
         return true;
     }
@@ -615,6 +682,8 @@ int32_t home_remote_app(void* _p) {
     furi_hal_gpio_write(pin_wake, true);
     furi_delay_ms(100);
     App* app = app_alloc();
+    // Associate and send the first request while the menu is showing
+    ha_wifi_warm_up(app);
     view_dispatcher_run(app->view_dispatcher);
 
     app_free(app);
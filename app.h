@@ -3,6 +3,7 @@
 #include "devices/devices.h"
 #include "home_remote_icons.h"
 #include <libs/furi_utils.h>
+#include <libs/spsc_queue.h>
 #include <furi.h>
 #include <furi_hal.h>
 #include <furi_hal_bt.h>
@@ -67,6 +68,8 @@ typedef enum {
     ConfigVariableItemPolling,
     ConfigVariableItemCtrlMode,
     ConfigVariableItemRandomizeMac,
+    ConfigVariableItemHistoryRes,
+    ConfigVariableItemBtButtons,
 } ConfigIndex;
 
 typedef enum {
@@ -102,6 +105,14 @@ typedef enum {
     BtStateLost
 } BtState;
 
+// Connection parameters asked to the central, by how recently the view was used
+typedef enum {
+    BtConnInteractive,
+    BtConnIdle,
+    BtConnBackground,
+    BtConnCount,
+} BtConnProfile;
+
 typedef enum {
     SGHZ_INIT,
     SGHZ_INACTIVE,
@@ -121,12 +132,17 @@ typedef enum {
     ThreadCommSendCmd = 0b00000100,
     ThreadCommStopCmd = 0b00001000,
     ThreadCommSendCmdBt = 0b00010000,
+    ThreadCommLoadLog = 0b00100000,
+    ThreadCommTxDone = 0b01000000,
+    ThreadCommInput = 0b10000000,
 } EventCommReq;
 
 typedef enum {
     PageFirst,
     PageSecond,
     PageThird,
+    PageHistory,
+    PageLink,
     PageLast,
 } PageIndex;
 
@@ -136,6 +152,44 @@ typedef enum {
     HaCtrlBtSerial
 } HaCtrlMode;
 
+#define HA_LINK_UNKNOWN 0xFF
+
+typedef enum {
+    HaEntityBedroomTemp,
+    HaEntityBedroomHum,
+    HaEntityKitchenTemp,
+    HaEntityKitchenHum,
+    HaEntityOutsideTemp,
+    HaEntityOutsideHum,
+    HaEntityCo2,
+    HaEntityPm2_5,
+    HaEntityCount,
+} HaEntity;
+
+typedef struct {
+    uint32_t timestamp; // RTC timestamp of the last update
+    uint16_t valid; // Bitmask of the HaEntity values received so far
+    int16_t values[HaEntityCount]; // Fixed point values, see ha_entity_scale
+    bool dehum_sts;
+    bool dehum_aut_sts;
+    int8_t rssi; // dBm of the link the values came from, 0 if unknown
+    uint8_t loss_pct; // Recent packet loss of the link, HA_LINK_UNKNOWN if unknown
+} HaSnapshot;
+
+typedef struct {
+    // Credentials last sent to the ESP32
+    FuriString* ssid;
+    FuriString* pass;
+    bool associated; // Credentials sent, the ESP32 is probed before they're trusted again
+    // The address request in progress, its answer is taken by the line callback
+    FlipperHTTP* fhttp;
+    FuriEventFlag* probe_done;
+    volatile bool probing;
+    volatile bool probe_up;
+    uint32_t joins;
+    uint32_t skips;
+} WifiLink;
+
 typedef struct App {
     NotificationApp* notification;
     ViewDispatcher* view_dispatcher; // Switches between our views
@@ -194,6 +248,8 @@ typedef struct App {
     VariableItem* polling_ha_item;
     VariableItem* ctrl_mode_ha_item;
     VariableItem* randomize_mac_enb_item;
+    VariableItem* history_res_item;
+    VariableItem* bt_buttons_item;
     uint8_t bool_config_index;
     FuriMutex* config_mutex;
 
@@ -203,8 +259,94 @@ typedef struct App {
     FuriThreadId comm_thread_id;
     FuriThread* comm_thread;
     FuriTimer* timer_comm_upd;
+    WifiLink* wifi_link;
 } App;
 
+#define SGHZ_RX_RING_SIZE 256U
+
+// Reassembles the Sub-GHz messages from the chunks read by the rx worker
+typedef struct {
+    uint8_t ring[SGHZ_RX_RING_SIZE];
+    size_t head; // Free running write index
+    size_t tail; // Free running read index
+    uint32_t last_rx_tick;
+    // Statistics
+    uint32_t bytes;
+    uint32_t frames;
+    uint32_t resyncs; // Bytes skipped looking for the start of a frame
+    uint32_t drops; // Bytes lost to a full ring or to a frame never completed
+    uint32_t crc_errors; // Binary frame candidates with a wrong CRC
+    uint32_t fec_frames; // Frames received with forward error correction
+    uint32_t fec_corrected; // Bits fixed by the error correction
+} SghzRx;
+
+#define SGHZ_LINK_WINDOW 32U
+
+// Link quality of the Sub-GHz receiver
+typedef struct {
+    uint8_t last_counter;
+    bool have_last;
+    uint32_t received;
+    uint32_t lost; // Counter values never received
+    uint32_t duplicates;
+    // Rolling window of the last expected frames, bit set if received, newest in bit 0
+    uint32_t window;
+    uint8_t window_len;
+    // RSSI in dBm of the last received frames
+    int8_t rssi[SGHZ_LINK_WINDOW];
+    uint8_t rssi_idx;
+    uint8_t rssi_count;
+} SghzLink;
+
+// Listen windows synchronised to the Sub-GHz sender, times in ticks and ms
+typedef struct {
+    uint32_t period_ms; // Learned period of the sender
+    uint32_t window_ms; // Half width of the listen window
+    uint32_t last_rx_tick;
+    uint8_t last_counter;
+    bool have_last;
+    uint8_t samples; // Consistent intervals seen while not locked
+    bool locked;
+    uint8_t misses; // Windows without a frame since the last one
+    bool radio_on;
+    // Duty cycle
+    uint32_t start_tick;
+    uint32_t state_tick;
+    uint32_t on_ms;
+} SghzSched;
+
+typedef enum {
+    SghzCommandNone,
+    SghzCommandDehum, // Toggle the dehumidifier
+    SghzCommandDehumAut, // Toggle the dehumidifier automation
+} SghzCommand;
+
+typedef enum {
+    CmdChannelIdle,
+    CmdChannelPending, // Submitted, not sent yet
+    CmdChannelWaitAck,
+} CmdChannelState;
+
+// Acknowledged command channel to the Sub-GHz or BT serial sender, times in ticks and ms
+typedef struct {
+    CmdChannelState state;
+    uint8_t command;
+    uint8_t seq;
+    uint8_t attempts;
+    uint32_t ack_timeout_ms; // For the first attempt, doubled at every retry
+    uint32_t submit_tick;
+    uint32_t sent_tick;
+    // Statistics
+    uint32_t sent;
+    uint32_t retries;
+    uint32_t acked;
+    uint32_t failed;
+    uint32_t failed_tick; // Last give up, shown on the page for a while
+    uint32_t latency_last_ms;
+    uint32_t latency_max_ms;
+    uint32_t latency_sum_ms;
+} CmdChannel;
+
 typedef struct {
     FuriMutex* worker_mutex;
     InputKey last_input;
@@ -216,6 +358,25 @@ typedef struct {
     FuriString* last_message;
     int8_t curr_page;
     uint8_t last_counter;
+    // Set by the rx thread, cleared when the draw callback parses the data
+    bool message_ready;
+    bool frame_ready;
+    HaSnapshot frame; // Last binary frame
+    uint8_t frame_counter;
+    uint32_t frame_errors;
+    SghzRx rx;
+    SghzSched sched;
+    SghzLink link;
+    CmdChannel cmd;
+    // Commands from the input callback, a bit per SghzCommand set on each press, taken by the
+    // rx thread
+    uint8_t cmd_request;
+    uint8_t cmd_pending; // Taken by the rx thread, waiting for the channel
+    // The sender talks the binary format, so it can acknowledge commands
+    bool peer_binary;
+    bool charge_suppressed; // Only while a receiver start went through, see sghz_radio_set
+    FuriThreadId beacon_thread_id;
+    uint32_t frequency;
 } SghzComm;
 
 typedef struct {
@@ -232,10 +393,20 @@ typedef struct {
     bool prev_exists;
     // BR Home Data
     uint8_t cnt;
+    // Advertisement built once by beacon_packet_build, only counter and event change
+    uint8_t packet[EXTRA_BEACON_MAX_DATA_SIZE];
+    uint8_t packet_len;
     char* device_name;
     size_t device_name_len;
     int8_t curr_page;
-    uint8_t event_type;
+    SpscQueue* events; // Button events from the input callback to the worker
+    uint32_t event_tick; // When the current event went on air
+    // Press to air latency of the events sent
+    uint32_t air_events;
+    uint32_t air_ms_sum;
+    uint32_t air_ms_max;
+    bool persistent; // Keep the beacon advertising between presses, see BEACON_PERSISTENT
+    bool multi_object; // A button object per control, the BT Buttons setting
     // Beacon settings
     GapExtraBeaconConfig config;
     uint16_t beacon_period;
@@ -260,6 +431,57 @@ typedef struct {
 } DataStruct;
 #pragma pack(pop)
 
+#define BT_RPC_MAX_CALLS 4U
+
+// Completion of a call, the reply packet is NULL on timeout
+typedef void (*BtRpcCallback)(void* context, uint8_t status, const uint8_t* reply, size_t len);
+// Transport of the requests, false if the packet can't be sent now
+typedef bool (*BtRpcSend)(void* context, uint8_t* data, size_t len);
+
+typedef struct {
+    bool active;
+    uint8_t id;
+    uint8_t method;
+    uint32_t sent_tick;
+    uint32_t timeout_ms;
+    BtRpcCallback callback;
+    void* context;
+} BtRpcCall;
+
+// Calls in flight over the BT serial profile, matched to the replies by id
+typedef struct {
+    BtRpcCall calls[BT_RPC_MAX_CALLS];
+    uint8_t next_id;
+    BtRpcSend send;
+    void* send_context;
+    // Statistics
+    uint32_t sent;
+    uint32_t replies;
+    uint32_t timeouts;
+    uint32_t unmatched; // Replies for no call, late or duplicated
+    uint32_t latency_max_ms;
+    uint32_t latency_sum_ms;
+} BtRpc;
+
+typedef struct {
+    uint32_t notifications;
+    uint32_t latency_sum_ms; // From the notification to its DataSent
+    uint32_t latency_max_ms;
+    uint32_t bytes; // Notified and confirmed
+    uint32_t time_ms; // Spent in the profile
+    // Granted by the central, 0 if unknown
+    uint16_t interval; // 1.25 ms units
+    uint16_t latency;
+} BtConnStats;
+
+// The connection profile of the view activity and what each one achieved, see bt_conn.c
+typedef struct {
+    BtConnProfile profile;
+    uint32_t profile_tick; // The profile started
+    BtConnProfile requested; // Asked to the central, BtConnCount if none yet
+    BtConnStats stats[BtConnCount];
+} BtConn;
+
 typedef struct {
     Bt* bt;
     FuriString* mac_address_str;
@@ -267,10 +489,80 @@ typedef struct {
     FuriHalBleProfileBase* ble_serial_profile;
     BtState bt_state;
     DataStruct data;
+    // Values from TLV packets not shown yet, merged if more arrive in between
+    HaSnapshot update;
+    bool update_flags; // The update has the dehumidifier flags
+    // Set by the callback, cleared when the draw callback parses the data
+    bool data_ready;
+    bool update_ready;
+    uint32_t rx_errors;
+    // Filled by the BLE callback, decoded by rx_thread
+    SpscQueue* rx_queue;
+    FuriThread* rx_thread;
+    FuriThreadId rx_thread_id;
+    uint32_t rx_packets;
+    uint32_t rx_drops;
+    uint32_t rx_depth_max;
+    // Toggles from the input callback, a bit per entity of bt_serial_write
+    uint8_t cmd_request;
+    uint8_t cmd_pending; // Taken by the worker, waiting for the channel
+    CmdChannel cmd;
+    bool peer_tlv; // The sender uses TLV packets, so it acknowledges commands
+    // Set while a notification waits for the confirmation of the central
+    bool tx_busy;
+    uint32_t tx_tick;
+    size_t tx_len;
+    uint32_t tx_errors;
+    uint32_t input_tick;
+    BtConn conn;
+    // Set by the status callback of the BT service
+    volatile bool connected;
+    // Link supervisor, run by the worker, ticks
+    uint32_t packet_tick; // Last accepted packet
+    uint32_t gap_avg_ms; // Between packets
+    uint32_t lost_tick;
+    uint32_t restart_tick; // Advertising last restarted
+    uint32_t restart_delay_ms;
+    uint32_t recoveries;
+    uint32_t recover_last_ms;
+    uint32_t recover_max_ms;
+    // Set by the draw callback when a value is shown
+    uint32_t value_tick[HaEntityCount];
+    // Values of the page shown are fetched with RPC calls
+    BtRpc rpc;
+    uint8_t rpc_page; // Set by the draw callback
+    uint16_t rpc_mask; // Of the last GetEntities call
+    uint32_t rpc_tick;
+    uint8_t rpc_misses; // GetEntities calls timed out in a row
     uint8_t lines_count;
     uint32_t last_packet;
 } BtSerial;
 
+typedef enum {
+    HaPollFast, // Right after a command or a change in the values
+    HaPollBackoff, // Values are stable, the period doubles at every unchanged response
+    HaPollPaused, // Screen is off, no requests
+    HaPollModeCount,
+} HaPollMode;
+
+typedef struct {
+    uint8_t mode;
+    uint32_t period_ms;
+    uint32_t last_req_tick;
+    uint8_t fast_left; // Requests left at the configured rate before backing off
+    // Statistics, reset every hour
+    uint32_t hour_start_tick;
+    uint32_t requests[HaPollModeCount];
+    uint32_t ticks; // Requests the fixed period would have sent
+    // Key presses in any view, the backlight goes off some time after the last one
+    FuriPubSub* input_events;
+    FuriPubSubSubscription* input_sub;
+    volatile uint32_t input_tick;
+} HaPoll;
+
+typedef struct HaHistory HaHistory;
+typedef struct HaTelemetry HaTelemetry;
+
 typedef struct {
     bool req_sts;
     bool populated;
@@ -284,9 +576,19 @@ typedef struct {
     uint16_t token_lenght;
     FuriMutex* worker_mutex;
     InputKey last_input;
-    FuriString* curr_cmd;
-    uint16_t polling_rate;
+    uint8_t frame_cmd; // FrameCmd selected, a single byte so the draw callback needs no lock
+    // Presses not sent yet in direct action mode: net NEXT minus PREV, then a RAND before them
+    int8_t frame_skip;
+    bool frame_rand;
+    uint32_t frame_presses;
+    uint32_t frame_requests;
+    // Draw time of the frame view, in CPU cycles
+    uint32_t draw_count;
+    uint32_t draw_cycles_max;
+    uint64_t draw_cycles_sum;
+    uint16_t polling_rate; // Minimum period of the adaptive polling
     uint16_t polling_rate_index;
+    HaPoll poll;
     uint8_t control_mode;
     FuriString* print_bedroom_temp;
     FuriString* print_bedroom_hum;
@@ -298,6 +600,17 @@ typedef struct {
     FuriString* print_co2;
     FuriString* print_pm2_5;
     FuriString* print_aidx;
+    HaSnapshot snapshot;
+    HaHistory* history;
+    HaTelemetry* telemetry;
+    uint8_t history_res_index;
+    uint8_t history_entity;
+    uint8_t history_back; // Windows back in the telemetry log, 0 shows the live history
+    bool stale; // Values shown are cached, waiting for new data
+    uint32_t enter_tick;
+    bool first_frame_logged;
+    bool fresh_logged;
+    bool warm_start; // The WiFi backend was already polling when the view opened
     int8_t curr_page;
     BtBeacon* ble;
     SghzComm* sghz;
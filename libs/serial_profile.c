@@ -7,7 +7,13 @@
 #include <services/battery_service.h>
 #include <services/serial_service.h>
 #include <furi.h>
+#if BLE_PROFILE_SERIAL_CONN_PARAMS
+#include <ble/ble.h>
 #include <ble/core/ble_defs.h>
+#include <furi_ble/event_dispatcher.h>
+#endif
+
+#define CONNECTION_HANDLE_NONE (0xFFFF)
 
 typedef struct {
     FuriHalBleProfileBase base;
@@ -15,9 +21,74 @@ typedef struct {
     BleServiceDevInfo* dev_info_svc;
     BleServiceBattery* battery_svc;
     BleServiceSerial* serial_svc;
+#if BLE_PROFILE_SERIAL_CONN_PARAMS
+    // Connection tracking, written by the BLE event thread
+    GapSvcEventHandler* event_handler;
+    volatile uint16_t conn_handle;
+    volatile BleProfileSerialConnParams conn_params;
+#endif
 } BleProfileSerial;
 _Static_assert(offsetof(BleProfileSerial, base) == 0, "Wrong layout");
 
+#if BLE_PROFILE_SERIAL_CONN_PARAMS
+static void ble_profile_serial_set_conn(
+    BleProfileSerial* profile,
+    uint16_t handle,
+    uint16_t interval,
+    uint16_t latency,
+    uint16_t timeout) {
+    profile->conn_params.interval = interval;
+    profile->conn_params.latency = latency;
+    profile->conn_params.timeout = timeout;
+    profile->conn_handle = handle;
+}
+
+// Only looks at the events, GAP still handles them
+static BleEventAckStatus ble_profile_serial_event_handler(void* event, void* context) {
+    BleProfileSerial* profile = context;
+    hci_event_pckt* event_pckt = (hci_event_pckt*)(((hci_uart_pckt*)event)->data);
+
+    if(event_pckt->evt == HCI_DISCONNECTION_COMPLETE_EVT_CODE) {
+        profile->conn_handle = CONNECTION_HANDLE_NONE;
+    } else if(event_pckt->evt == HCI_LE_META_EVT_CODE) {
+        evt_le_meta_event* meta_evt = (evt_le_meta_event*)event_pckt->data;
+        if(meta_evt->subevent == HCI_LE_CONNECTION_COMPLETE_SUBEVT_CODE) {
+            hci_le_connection_complete_event_rp0* evt = (void*)meta_evt->data;
+            if(evt->Status == BLE_STATUS_SUCCESS) {
+                ble_profile_serial_set_conn(
+                    profile,
+                    evt->Connection_Handle,
+                    evt->Conn_Interval,
+                    evt->Conn_Latency,
+                    evt->Supervision_Timeout);
+            }
+        } else if(meta_evt->subevent == HCI_LE_ENHANCED_CONNECTION_COMPLETE_SUBEVT_CODE) {
+            hci_le_enhanced_connection_complete_event_rp0* evt = (void*)meta_evt->data;
+            if(evt->Status == BLE_STATUS_SUCCESS) {
+                ble_profile_serial_set_conn(
+                    profile,
+                    evt->Connection_Handle,
+                    evt->Conn_Interval,
+                    evt->Conn_Latency,
+                    evt->Supervision_Timeout);
+            }
+        } else if(meta_evt->subevent == HCI_LE_CONNECTION_UPDATE_COMPLETE_SUBEVT_CODE) {
+            hci_le_connection_update_complete_event_rp0* evt = (void*)meta_evt->data;
+            if(evt->Status == BLE_STATUS_SUCCESS) {
+                ble_profile_serial_set_conn(
+                    profile,
+                    evt->Connection_Handle,
+                    evt->Conn_Interval,
+                    evt->Conn_Latency,
+                    evt->Supervision_Timeout);
+            }
+        }
+    }
+
+    return BleEventNotAck;
+}
+#endif
+
 static FuriHalBleProfileBase* ble_profile_serial_start(FuriHalBleProfileParams profile_params) {
     UNUSED(profile_params);
 
@@ -28,6 +99,11 @@ static FuriHalBleProfileBase* ble_profile_serial_start(FuriHalBleProfileParams p
     profile->dev_info_svc = ble_svc_dev_info_start();
     profile->battery_svc = ble_svc_battery_start(true);
     profile->serial_svc = ble_svc_serial_start();
+#if BLE_PROFILE_SERIAL_CONN_PARAMS
+    profile->conn_handle = CONNECTION_HANDLE_NONE;
+    profile->event_handler =
+        ble_event_dispatcher_register_svc_handler(ble_profile_serial_event_handler, profile);
+#endif
 
     return &profile->base;
 }
@@ -37,6 +113,9 @@ static void ble_profile_serial_stop(FuriHalBleProfileBase* profile) {
     furi_check(profile->config == ble_profile_serial);
 
     BleProfileSerial* serial_profile = (BleProfileSerial*)profile;
+#if BLE_PROFILE_SERIAL_CONN_PARAMS
+    ble_event_dispatcher_unregister_svc_handler(serial_profile->event_handler);
+#endif
     ble_svc_battery_stop(serial_profile->battery_svc);
     ble_svc_dev_info_stop(serial_profile->dev_info_svc);
     ble_svc_serial_stop(serial_profile->serial_svc);
@@ -141,3 +220,46 @@ bool ble_profile_serial_tx(FuriHalBleProfileBase* profile, uint8_t* data, uint16
 
     return ble_svc_serial_update_tx(serial_profile->serial_svc, data, size);
 }
+
+bool ble_profile_serial_get_conn_params(
+    FuriHalBleProfileBase* profile,
+    BleProfileSerialConnParams* params) {
+    furi_check(profile && (profile->config == ble_profile_serial));
+
+#if BLE_PROFILE_SERIAL_CONN_PARAMS
+    BleProfileSerial* serial_profile = (BleProfileSerial*)profile;
+    if(serial_profile->conn_handle == CONNECTION_HANDLE_NONE) {
+        return false;
+    }
+    params->interval = serial_profile->conn_params.interval;
+    params->latency = serial_profile->conn_params.latency;
+    params->timeout = serial_profile->conn_params.timeout;
+    return true;
+#else
+    UNUSED(params);
+    return false;
+#endif
+}
+
+bool ble_profile_serial_request_conn_params(
+    FuriHalBleProfileBase* profile,
+    const GapConnectionParamsRequest* params) {
+    furi_check(profile && (profile->config == ble_profile_serial));
+    furi_check(params);
+
+#if BLE_PROFILE_SERIAL_CONN_PARAMS
+    BleProfileSerial* serial_profile = (BleProfileSerial*)profile;
+    const uint16_t handle = serial_profile->conn_handle;
+    if(handle == CONNECTION_HANDLE_NONE) {
+        return false;
+    }
+    return aci_l2cap_connection_parameter_update_req(
+               handle,
+               params->conn_int_min,
+               params->conn_int_max,
+               params->slave_latency,
+               params->supervisor_timeout) == BLE_STATUS_SUCCESS;
+#else
+    return false;
+#endif
+}
@@ -7,10 +7,14 @@ typedef struct {
     uint16_t mac_xor; /**< XOR mask for device address, for uniqueness */
 } BleProfileSerialParams;
 #define BT_SERIAL_BUFFER_SIZE 128
+// Track the connection and ask for new parameters, with HCI calls stock firmware doesn't
+// export to apps. Without it the connection keeps the parameters of the profile config
+#define BLE_PROFILE_SERIAL_CONN_PARAMS false
 
 #include <furi_ble/profile_interface.h>
 
 #include <services/serial_service.h>
+#include <gap.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,6 +27,13 @@ typedef enum {
     FuriHalBtSerialRpcStatusActive,
 } FuriHalBtSerialRpcStatus;
 
+/** Parameters of the current connection */
+typedef struct {
+    uint16_t interval; /**< In 1.25 ms units */
+    uint16_t latency; /**< Connection events the peripheral may skip */
+    uint16_t timeout; /**< Supervision timeout in 10 ms units */
+} BleProfileSerialConnParams;
+
 /** Serial service callback type */
 typedef SerialServiceEventCallback FuriHalBtSerialCallback;
 
@@ -64,6 +75,31 @@ void ble_profile_serial_set_event_callback(
     FuriHalBtSerialCallback callback,
     void* context);
 
+/** Get the parameters of the current connection
+ *
+ * @param profile       Profile instance
+ * @param params        filled with the parameters
+ *
+ * @return      false if not connected, or BLE_PROFILE_SERIAL_CONN_PARAMS is off
+ */
+bool ble_profile_serial_get_conn_params(
+    FuriHalBleProfileBase* profile,
+    BleProfileSerialConnParams* params);
+
+/** Ask the central to change the connection parameters
+ *
+ * The central decides, the result shows in ble_profile_serial_get_conn_params.
+ *
+ * @param profile       Profile instance
+ * @param params        the requested parameters, same units as GapConfig
+ *
+ * @return      false if not connected, the request could not be sent, or
+ *              BLE_PROFILE_SERIAL_CONN_PARAMS is off
+ */
+bool ble_profile_serial_request_conn_params(
+    FuriHalBleProfileBase* profile,
+    const GapConnectionParamsRequest* params);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,112 @@
+#include "spsc_queue.h"
+#include <furi.h>
+
+struct SpscQueue {
+    uint8_t* buffer;
+    size_t capacity; // Power of 2
+    size_t item_size;
+    // Free running, written only by the producer and by the consumer respectively
+    volatile uint32_t head;
+    volatile uint32_t tail;
+};
+
+/**
+ * @brief       Allocate a queue
+ * @param       capacity   the number of items, must be a power of 2
+ * @param       item_size  the size of an item in bytes
+ * @return      the queue
+*/
+SpscQueue* spsc_queue_alloc(size_t capacity, size_t item_size) {
+    furi_check(capacity > 0 && (capacity & (capacity - 1)) == 0);
+    SpscQueue* queue = malloc(sizeof(SpscQueue));
+    queue->buffer = malloc(capacity * item_size);
+    queue->capacity = capacity;
+    queue->item_size = item_size;
+    queue->head = 0;
+    queue->tail = 0;
+    return queue;
+}
+
+void spsc_queue_free(SpscQueue* queue) {
+    free(queue->buffer);
+    free(queue);
+}
+
+/**
+ * @brief       Add an item, producer side only
+ * @param       queue  the queue
+ * @param       item   the item to copy in
+ * @return      false if the queue is full, the item is not added
+*/
+bool spsc_queue_push(SpscQueue* queue, const void* item) {
+    const uint32_t head = queue->head;
+    const uint32_t tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+    if(head - tail >= queue->capacity) {
+        return false;
+    }
+    memcpy(
+        &queue->buffer[(head & (queue->capacity - 1)) * queue->item_size],
+        item,
+        queue->item_size);
+    // The item must be visible before the consumer sees the new head
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief       Copy the oldest item without removing it, consumer side only
+ * @param       queue  the queue
+ * @param       item   filled with the item
+ * @return      false if the queue is empty
+*/
+bool spsc_queue_peek(SpscQueue* queue, void* item) {
+    const uint32_t tail = queue->tail;
+    const uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    if(head == tail) {
+        return false;
+    }
+    memcpy(
+        item,
+        &queue->buffer[(tail & (queue->capacity - 1)) * queue->item_size],
+        queue->item_size);
+    return true;
+}
+
+/**
+ * @brief       Remove the oldest item, consumer side only
+ * @param       queue  the queue
+ * @param       item   filled with the item, can be NULL to just drop it
+ * @return      false if the queue is empty
+*/
+bool spsc_queue_pop(SpscQueue* queue, void* item) {
+    const uint32_t tail = queue->tail;
+    const uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    if(head == tail) {
+        return false;
+    }
+    if(item) {
+        memcpy(
+            item,
+            &queue->buffer[(tail & (queue->capacity - 1)) * queue->item_size],
+            queue->item_size);
+    }
+    // The slot can be reused only after the copy
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief       Number of queued items, exact only on the consumer side
+*/
+size_t spsc_queue_count(SpscQueue* queue) {
+    return __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) -
+           __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief       Drop all the items, only while neither side is using the queue
+*/
+void spsc_queue_reset(SpscQueue* queue) {
+    queue->head = 0;
+    queue->tail = 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Lock-free queue for one producer and one consumer, safe from an ISR or callback on
+ * one side and a thread on the other. Items are copied in and out.
+*/
+typedef struct SpscQueue SpscQueue;
+
+SpscQueue* spsc_queue_alloc(size_t capacity, size_t item_size);
+void spsc_queue_free(SpscQueue* queue);
+bool spsc_queue_push(SpscQueue* queue, const void* item);
+bool spsc_queue_pop(SpscQueue* queue, void* item);
+bool spsc_queue_peek(SpscQueue* queue, void* item);
+size_t spsc_queue_count(SpscQueue* queue);
+void spsc_queue_reset(SpscQueue* queue);
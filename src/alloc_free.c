@@ -1,7 +1,11 @@
 #include "alloc_free.h"
 #include "ble_beacon.h"
+#include "bt_serial.h"
 #include "frame.h"
 #include "ha.h"
+#include "ha_history.h"
+#include "ha_telemetry.h"
+#include "wifi_link.h"
 #include "libs/furi_utils.h"
 
 static const char FRAME_PATH_CONFIG_LABEL[] = "Frame URL";
@@ -15,6 +19,8 @@ static const char HA_PASS_CONFIG_LABEL[] = "HA Pass.";
 static const char* POLLING_CONFIG_LABEL = "Polling";
 static const char* CTRL_MODE_CONFIG_LABEL = "Ctrl. Mode";
 static const char* RANDOMIZE_MAC_LABEL = "Randomize MAC";
+static const char* HISTORY_RES_LABEL = "History Res.";
+static const char* BT_BUTTONS_LABEL = "BT Buttons";
 
 extern FlipperHTTP* fhttp;
 
@@ -22,6 +28,9 @@ extern const uint16_t polling_values[4];
 extern const char* polling_names[4];
 extern const char* ctrl_mode_names[3];
 extern const char* randomize_mac_names[2];
+extern const char* bt_buttons_names[2];
+extern const uint16_t history_res_values[4];
+extern const char* history_res_names[4];
 
 /**
  * @brief      Allocate the application.
@@ -169,8 +178,7 @@ App* app_alloc() {
     frame_model->last_input = INPUT_RESET;
     frame_model->worker_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
     frame_model->url = furi_string_alloc();
-    frame_model->curr_cmd = furi_string_alloc();
-    furi_string_set_str(frame_model->curr_cmd, "   -> ");
+    frame_model->frame_cmd = FrameCmdNone;
     frame_model->req_path = furi_string_alloc();
     furi_string_set_str(frame_model->req_path, "");
     view_dispatcher_add_view(app->view_dispatcher, ViewFrame, app->view_frame);
@@ -191,7 +199,6 @@ App* app_alloc() {
     ha_model->url = furi_string_alloc();
     ha_model->url_cmd = furi_string_alloc();
     ha_model->token = furi_string_alloc();
-    ha_model->curr_cmd = furi_string_alloc();
     ha_model->headers = furi_string_alloc();
     ha_model->payload = furi_string_alloc();
     ha_model->payload_dehum = furi_string_alloc();
@@ -206,9 +213,14 @@ App* app_alloc() {
     ha_model->print_pm2_5 = furi_string_alloc();
     ha_model->print_aidx = furi_string_alloc();
     ha_model->curr_page = PageFirst;
+    ha_model->history_res_index = HISTORY_RES_DEFAULT_IDX;
+    ha_model->history_entity = HaEntityBedroomTemp;
     ha_model->sghz = malloc(sizeof(SghzComm));
     ha_model->sghz->worker_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
     ha_model->sghz->last_counter = 0;
+    ha_model->sghz->message_ready = false;
+    ha_model->sghz->frame_ready = false;
+    ha_model->sghz->frame_errors = 0;
 
     view_dispatcher_add_view(app->view_dispatcher, ViewHa, app->view_ha);
 
@@ -224,6 +236,14 @@ App* app_alloc() {
     ha_model->ble = malloc(sizeof(BtBeacon));
     ha_model->ble->mac_address_str = furi_string_alloc();
     ha_model->ble->cnt = 0;
+    ha_model->ble->events = spsc_queue_alloc(BEACON_EVENT_QUEUE_SIZE, sizeof(BeaconEvent));
+    ha_model->ble->status = BEACON_INACTIVE;
+    ha_model->ble->event_tick = 0;
+    ha_model->ble->air_events = 0;
+    ha_model->ble->air_ms_sum = 0;
+    ha_model->ble->air_ms_max = 0;
+    ha_model->ble->persistent = BEACON_PERSISTENT;
+    ha_model->ble->multi_object = BEACON_MULTI_OBJECT;
     ha_model->ble->config.adv_channel_map = GapAdvChannelMapAll;
     ha_model->ble->config.adv_power_level = GapAdvPowerLevel_6dBm;
     ha_model->ble->config.address_type = GapAddressTypePublic;
@@ -261,8 +281,16 @@ App* app_alloc() {
     // BT Serial
     ha_model->bt_serial = malloc(sizeof(BtSerial));
     ha_model->bt_serial->bt = furi_record_open(RECORD_BT);
+    ha_model->bt_serial->data_ready = false;
+    ha_model->bt_serial->update_ready = false;
+    ha_model->bt_serial->rx_errors = 0;
+    ha_model->bt_serial->rx_queue =
+        spsc_queue_alloc(BT_SERIAL_RX_QUEUE_SIZE, sizeof(BtSerialPacket));
+    ha_model->bt_serial->rx_thread = NULL;
 
     load_settings(app);
+    ha_model->history = ha_history_alloc(history_res_values[ha_model->history_res_index]);
+    ha_model->telemetry = ha_telemetry_alloc();
 
     // Variable Items
     app->variable_item_list_config = variable_item_list_alloc();
@@ -364,6 +392,26 @@ App* app_alloc() {
         variable_item_setting_changed,
         app);
 
+    // History resolution
+    app->history_res_item = futils_variable_item_init(
+        app->variable_item_list_config,
+        HISTORY_RES_LABEL,
+        history_res_names[ha_model->history_res_index],
+        COUNT_OF(history_res_values),
+        ha_model->history_res_index,
+        variable_item_setting_changed,
+        app);
+
+    // BT Buttons
+    app->bt_buttons_item = futils_variable_item_init(
+        app->variable_item_list_config,
+        BT_BUTTONS_LABEL,
+        bt_buttons_names[ha_model->ble->multi_object],
+        COUNT_OF(bt_buttons_names),
+        ha_model->ble->multi_object,
+        variable_item_setting_changed,
+        app);
+
     variable_item_list_set_enter_callback(
         app->variable_item_list_config, setting_item_clicked, app);
     view_set_previous_callback(
@@ -378,11 +426,13 @@ App* app_alloc() {
         &app->widget_about, ViewAbout, NULL, navigation_submenu_callback, &app->view_dispatcher);
 
     // Flipper HTTP
+    app->wifi_link = wifi_link_alloc();
     fhttp = flipper_http_alloc();
     if(fhttp == NULL) {
         FURI_LOG_E(TAG, "Failed to initialize UART");
         return NULL;
     }
+    wifi_link_attach(app->wifi_link, fhttp);
 
     while(fhttp->state == INACTIVE) {
         flipper_http_ping(fhttp);
@@ -417,7 +467,10 @@ void app_free(App* app) {
         furi_check(furi_hal_bt_extra_beacon_start());
     }
 
+    // The WiFi backend is still polling if the app is closed from the menu
+    ha_wifi_stop(app);
     flipper_http_free(fhttp);
+    wifi_link_free(app->wifi_link);
 
     furi_mutex_free(app->config_mutex);
     furi_mutex_free(frame_model->worker_mutex);
@@ -439,7 +492,6 @@ void app_free(App* app) {
     furi_string_free(app->frame_pass);
     furi_string_free(frame_model->url);
     furi_string_free(frame_model->req_path);
-    furi_string_free(frame_model->curr_cmd);
 
     furi_string_free(app->ha_ssid);
     furi_string_free(app->ha_pass);
@@ -449,7 +501,6 @@ void app_free(App* app) {
     furi_string_free(ha_model->headers);
     furi_string_free(ha_model->payload);
     furi_string_free(ha_model->payload_dehum);
-    furi_string_free(ha_model->curr_cmd);
 
     furi_string_free(ha_model->ble->mac_address_str);
 
@@ -490,6 +541,8 @@ void app_free(App* app) {
     view_free(app->view_frame);
     view_dispatcher_remove_view(app->view_dispatcher, ViewHa);
     free(ha_model->sghz);
+    ha_history_free(ha_model->history);
+    ha_telemetry_free(ha_model->telemetry);
     view_free(app->view_ha);
 
     text_box_free(app->text_box_resp);
@@ -503,7 +556,9 @@ void app_free(App* app) {
     furi_record_close(RECORD_GUI);
     furi_record_close(RECORD_BT);
 
+    spsc_queue_free(ha_model->ble->events);
     free(ha_model->ble);
+    spsc_queue_free(ha_model->bt_serial->rx_queue);
     free(ha_model->bt_serial);
     free(app);
 }
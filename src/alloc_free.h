@@ -6,5 +6,7 @@
 
 #define MAX_NAME_LENGHT 15
 
+#define HISTORY_RES_DEFAULT_IDX 2U
+
 App* app_alloc();
 void app_free(App* app);
@@ -20,10 +20,35 @@ void timer_beacon_reset_callback(void* context) {
     furi_thread_flags_set(app->comm_thread_id, ThreadCommStopCmd);
 }
 
-bool make_packet(BtBeacon* ble, uint8_t* _size, uint8_t** _packet) {
-    uint8_t* packet = malloc(EXTRA_BEACON_MAX_DATA_SIZE);
+/**
+ * @brief      Number of button objects in the advertisement.
+ * @param      ble  the BtBeacon object
+ * @return     one per control with the BT Buttons setting on, else one
+*/
+uint8_t beacon_slots(const BtBeacon* ble) {
+    return ble->multi_object ? BEACON_SLOTS_MAX : 1U;
+}
+
+/**
+ * @brief      Build the advertisement, the device name and the BT Buttons setting don't
+ *             change while the beacon runs.
+ * @param      ble  the BtBeacon object
+ * @return     false if the packet doesn't fit in a beacon
+*/
+bool beacon_packet_build(BtBeacon* ble) {
+    uint8_t* packet = ble->packet;
+    const uint8_t slots = beacon_slots(ble);
     size_t i = 0;
-    ble->cnt++;
+    ble->packet_len = 0;
+
+    if(BEACON_PACKET_HEADER_SIZE(slots) + ble->device_name_len > EXTRA_BEACON_MAX_DATA_SIZE) {
+        FURI_LOG_E(
+            BT_TAG,
+            "Packet too big: Max = %u, Size = %u",
+            EXTRA_BEACON_MAX_DATA_SIZE,
+            BEACON_PACKET_HEADER_SIZE(slots) + ble->device_name_len);
+        return false;
+    }
 
     // Flag data
     packet[i++] = 0x02; // length
@@ -31,7 +56,7 @@ bool make_packet(BtBeacon* ble, uint8_t* _size, uint8_t** _packet) {
     packet[i++] =
         0b00000110; // bit 1: “LE General Discoverable Mode”, bit 2: “BR/EDR Not Supported”
     // Service data
-    packet[i++] = 0x08; // length
+    packet[i++] = 0x06 + 2 * slots; // length
     packet[i++] = 0x16; // Type: Flags
     // BTHome Data
     packet[i++] = 0xD2; // UUID 1
@@ -39,10 +64,12 @@ bool make_packet(BtBeacon* ble, uint8_t* _size, uint8_t** _packet) {
     packet[i++] = 0b01000100; // BTHome Device Information
     // Packet Id
     packet[i++] = 0x00; // Type: Packet ID
-    packet[i++] = ble->cnt; // Packet Counter
-    // Actual Data
-    packet[i++] = 0x3A; // Type: Object ID Button
-    packet[i++] = ble->event_type; // Event Press
+    packet[i++] = 0x00; // Packet Counter, see BEACON_PACKET_CNT_POS
+    // Actual Data, buttons are numbered in order
+    for(size_t slot = 0; slot < slots; slot++) {
+        packet[i++] = 0x3A; // Type: Object ID Button
+        packet[i++] = 0x00; // Event Press, see BEACON_PACKET_EVENT_POS
+    }
     //Device name
     packet[i++] = ble->device_name_len + 1; // Lenght
     packet[i++] = 0x09; // Full name
@@ -51,19 +78,44 @@ bool make_packet(BtBeacon* ble, uint8_t* _size, uint8_t** _packet) {
         packet[i++] = (uint8_t)ble->device_name[j];
     }
 
-    if(i > EXTRA_BEACON_MAX_DATA_SIZE) {
-        FURI_LOG_E(BT_TAG, "Packet too big: Max = %u, Size = %u", EXTRA_BEACON_MAX_DATA_SIZE, i);
-        free(packet);
+    ble->packet_len = i;
+    return true;
+}
+
+/**
+ * @brief      Prepare the advertisement for new events, no allocation involved.
+ * @param      ble     the BtBeacon object
+ * @param      events  the BTHomeEventType of every button object, NULL for all idle
+ * @return     false if beacon_packet_build failed
+*/
+bool beacon_packet_patch(BtBeacon* ble, const uint8_t events[BEACON_SLOTS_MAX]) {
+    if(ble->packet_len == 0) {
         return false;
     }
-
-    packet = realloc(packet, i);
-    *_size = i;
-    *_packet = packet;
-
+    ble->cnt++;
+    ble->packet[BEACON_PACKET_CNT_POS] = ble->cnt;
+    for(size_t slot = 0; slot < beacon_slots(ble); slot++) {
+        ble->packet[BEACON_PACKET_EVENT_POS(slot)] = events ? events[slot] : BTHomeNone;
+    }
     return true;
 }
 
+/**
+ * @brief      Configure and start the beacon once, advertising the idle event.
+ * @details    While active only the data can change, so presses skip the reconfiguration.
+ * @param      ble  the BtBeacon object
+*/
+void beacon_session_start(BtBeacon* ble) {
+    if(furi_hal_bt_extra_beacon_is_active()) {
+        furi_check(furi_hal_bt_extra_beacon_stop());
+    }
+    furi_check(furi_hal_bt_extra_beacon_set_config(&ble->config));
+    if(beacon_packet_patch(ble, NULL)) {
+        furi_check(furi_hal_bt_extra_beacon_set_data(ble->packet, ble->packet_len));
+        furi_check(furi_hal_bt_extra_beacon_start());
+    }
+}
+
 void randomize_mac(uint8_t address[EXTRA_BEACON_MAC_ADDR_SIZE]) {
     furi_hal_random_fill_buf(address, EXTRA_BEACON_MAC_ADDR_SIZE);
 }
@@ -79,45 +131,181 @@ void pretty_print_mac(FuriString* mac_str, uint8_t address[EXTRA_BEACON_MAC_ADDR
     FURI_LOG_I(BT_TAG, "Current MAC address: %s", furi_string_get_cstr(mac_str));
 }
 
-int32_t bt_comm_worker(void* context) {
-    BtBeacon* ble = context;
-    bool run = true;
-
-    while(run) {
-        uint32_t events = furi_thread_flags_wait(
-            ThreadCommStop | ThreadCommStopCmd | ThreadCommSendCmd,
-            FuriFlagWaitAny,
-            FuriWaitForever);
-        if(events & ThreadCommStop) {
-            run = false;
-            FURI_LOG_I(TAG, "Thread event: Stop command request");
+/**
+ * @brief      Queue a button event for the worker, then signal it with ThreadCommSendCmd.
+ * @details    Only one thread may push: the input callback, or the Sub-GHz rx thread when
+ *             the Sub-GHz command channel is on.
+ * @param      ble      the BtBeacon object
+ * @param      control  the control that was used
+ * @return     false if the queue is full and the event is dropped
+*/
+bool beacon_event_push(BtBeacon* ble, BeaconControl control) {
+    // With a single button the controls are told apart by the press type
+    const BeaconEvent event = {
+        .slot = ble->multi_object ? control : 0,
+        .event = ble->multi_object || control == BeaconControlDehum ? BTHomeShortPress :
+                                                                       BTHomeLongPress,
+        .tick = furi_get_tick(),
+    };
+    if(!spsc_queue_push(ble->events, &event)) {
+        FURI_LOG_W(BT_TAG, "Event queue full, control %u dropped", control);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief      Take the next events for one advertisement.
+ * @details    Every event is sent as queued, a slot carries one event per advertisement.
+ *             Events for other slots are packed in the same advertisement, until the next one
+ *             is for a slot already taken, so the order is kept.
+ * @param      ble     the BtBeacon object
+ * @param      events  filled with the BTHome event of every slot
+ * @param      ticks   filled with when the event of every slot was queued
+ * @return     false if the queue is empty
+*/
+static bool beacon_event_take(
+    BtBeacon* ble,
+    uint8_t events[BEACON_SLOTS_MAX],
+    uint32_t ticks[BEACON_SLOTS_MAX]) {
+    const uint8_t slots = beacon_slots(ble);
+    BeaconEvent next;
+    bool taken = false;
+    for(size_t slot = 0; slot < BEACON_SLOTS_MAX; slot++) {
+        events[slot] = BTHomeNone;
+    }
+    while(spsc_queue_peek(ble->events, &next)) {
+        const uint8_t slot = next.slot < slots ? next.slot : 0;
+        if(events[slot] != BTHomeNone) {
+            break;
+        }
+        spsc_queue_pop(ble->events, NULL);
+        events[slot] = next.event;
+        ticks[slot] = next.tick;
+        taken = true;
+    }
+    return taken;
+}
+
+/**
+ * @brief      Put the next queued events on air.
+ * @details    The latency of every event is counted once its data is advertised, so the
+ *             restart of the beacon without BEACON_PERSISTENT is part of it.
+ * @param      ble  the BtBeacon object
+*/
+static void beacon_send_next(BtBeacon* ble) {
+    uint8_t events[BEACON_SLOTS_MAX];
+    uint32_t ticks[BEACON_SLOTS_MAX];
+    if(!beacon_event_take(ble, events, ticks)) {
+        return;
+    }
+    ble->status = BEACON_BUSY;
+    FURI_LOG_I(BT_TAG, "Sending BTHome event %u...", events[0]);
+    if(ble->persistent && furi_hal_bt_extra_beacon_is_active()) {
+        if(beacon_packet_patch(ble, events)) {
+            furi_check(furi_hal_bt_extra_beacon_set_data(ble->packet, ble->packet_len));
+            furi_timer_start(ble->timer_reset_beacon, ble->beacon_duration);
+        }
+    } else {
+        if(furi_hal_bt_extra_beacon_is_active()) {
+            furi_check(furi_hal_bt_extra_beacon_stop());
+        }
+
+        GapExtraBeaconConfig* config = &ble->config;
 
-        } else if(events & ThreadCommStopCmd) {
+        furi_check(furi_hal_bt_extra_beacon_set_config(config));
+        if(beacon_packet_patch(ble, events)) {
+            furi_check(furi_hal_bt_extra_beacon_set_data(ble->packet, ble->packet_len));
+            furi_check(furi_hal_bt_extra_beacon_start());
+            furi_timer_start(ble->timer_reset_beacon, ble->beacon_duration);
+        }
+    }
+    ble->event_tick = furi_get_tick();
+
+    for(size_t slot = 0; slot < BEACON_SLOTS_MAX; slot++) {
+        if(events[slot] == BTHomeNone) {
+            continue;
+        }
+        const uint32_t air_ms = ble->event_tick - ticks[slot];
+        ble->air_events++;
+        ble->air_ms_sum += air_ms;
+        ble->air_ms_max = MAX(ble->air_ms_max, air_ms);
+        FURI_LOG_I(BT_TAG, "Press to air: %lums", air_ms);
+    }
+}
+
+/**
+ * @brief      Handle the flags of one wait of the worker, all but ThreadCommStop.
+ * @param      ble     the BtBeacon object
+ * @param      events  the flags, or an error when the wait timed out
+ * @return     how long to wait for the next flags
+*/
+uint32_t beacon_worker_step(BtBeacon* ble, uint32_t events) {
+    // A queued event replaces the one on air after BEACON_EVENT_HOLD_ADV advertisements
+    const uint32_t hold = furi_ms_to_ticks(ble->beacon_period * BEACON_EVENT_HOLD_ADV);
+    if(events & FuriFlagError) {
+        // Only waiting with a timeout when events are queued
+        events = ThreadCommSendCmd;
+    }
+
+    if(events & ThreadCommStopCmd) {
+        if(spsc_queue_count(ble->events) > 0) {
+            // The next event replaces this one anyway
+        } else if(ble->persistent) {
+            ble->status = BEACON_INACTIVE;
+            // Back to the idle event, the beacon keeps running
+            if(beacon_packet_patch(ble, NULL)) {
+                furi_check(furi_hal_bt_extra_beacon_set_data(ble->packet, ble->packet_len));
+            }
+        } else {
             ble->status = BEACON_INACTIVE;
             FURI_LOG_I(BT_TAG, "Resetting Beacon...");
             if(furi_hal_bt_extra_beacon_is_active()) {
                 furi_check(furi_hal_bt_extra_beacon_stop());
             }
             FURI_LOG_I(BT_TAG, "Resetting Beacon done.");
-        } else if(events & ThreadCommSendCmd) {
-            ble->status = BEACON_BUSY;
-            FURI_LOG_I(BT_TAG, "Sending BTHome data...");
-            if(furi_hal_bt_extra_beacon_is_active()) {
-                furi_check(furi_hal_bt_extra_beacon_stop());
-            }
+        }
+    } else if(events & ThreadCommSendCmd) {
+        const uint32_t on_air = furi_get_tick() - ble->event_tick;
+        if(ble->status != BEACON_BUSY || on_air >= hold) {
+            beacon_send_next(ble);
+        }
+    }
 
-            uint8_t size;
-            uint8_t* packet;
-            GapExtraBeaconConfig* config = &ble->config;
+    if(spsc_queue_count(ble->events) == 0) {
+        return FuriWaitForever;
+    }
+    const uint32_t on_air = furi_get_tick() - ble->event_tick;
+    return on_air < hold ? hold - on_air : 1;
+}
 
-            furi_check(furi_hal_bt_extra_beacon_set_config(config));
-            if(make_packet(ble, &size, &packet)) {
-                furi_check(furi_hal_bt_extra_beacon_set_data(packet, size));
-                furi_check(furi_hal_bt_extra_beacon_start());
-                furi_timer_start(ble->timer_reset_beacon, ble->beacon_duration);
-                free(packet);
+int32_t bt_comm_worker(void* context) {
+    BtBeacon* ble = context;
+    uint32_t timeout = FuriWaitForever;
+
+    if(ble->persistent) {
+        beacon_session_start(ble);
+    }
+
+    while(true) {
+        const uint32_t events = furi_thread_flags_wait(
+            ThreadCommStop | ThreadCommStopCmd | ThreadCommSendCmd, FuriFlagWaitAny, timeout);
+        if(!(events & FuriFlagError) && (events & ThreadCommStop)) {
+            FURI_LOG_I(TAG, "Thread event: Stop command request");
+            if(ble->persistent && furi_hal_bt_extra_beacon_is_active()) {
+                furi_check(furi_hal_bt_extra_beacon_stop());
             }
+            break;
         }
+        timeout = beacon_worker_step(ble, events);
+    }
+    if(ble->air_events > 0) {
+        FURI_LOG_I(
+            BT_TAG,
+            "Press to air: %lu events, avg %lums, max %lums",
+            ble->air_events,
+            ble->air_ms_sum / ble->air_events,
+            ble->air_ms_max);
     }
     FURI_LOG_I(TAG, "Thread event: Stopping...");
     return 0;
@@ -10,15 +10,54 @@
 #include <gui/view_dispatcher.h>
 
 #define BT_TAG "BT"
+// Keep the beacon configured and advertising while the page is open, presses only swap data
+#define BEACON_PERSISTENT true
+// Queued button events, presses faster than the beacon can air them
+#define BEACON_EVENT_QUEUE_SIZE 8U
+// Advertisements an event is held for when the next one is queued, so a burst advances every
+// interval. The last event stays on air until the reset timer
+#define BEACON_EVENT_HOLD_ADV 1U
+
+// Default of the BT Buttons setting: one BTHome button object for each control, instead of
+// short and long press of one button. The buttons show up in Home Assistant as separate
+// entities, so automations must match.
+#define BEACON_MULTI_OBJECT false
+#define BEACON_SLOTS_MAX    BeaconControlCount
+
+// Fixed part of the advertisement before the device name
+#define BEACON_PACKET_HEADER_SIZE(slots) (12U + 2U * (slots))
+#define BEACON_PACKET_CNT_POS     9U
+// Event of the button object in a slot
+#define BEACON_PACKET_EVENT_POS(slot) (11U + 2U * (slot))
 
 typedef enum {
+    BTHomeNone = 0x00,
     BTHomeShortPress = 0x01,
     BTHomeLongPress = 0x04,
 } BTHomeEventType;
 
+// Controls of the Home Assistant view sent through the beacon
+typedef enum {
+    BeaconControlDehum,
+    BeaconControlDehumAut,
+    BeaconControlCount,
+} BeaconControl;
+
+// Queued event: button object slot and BTHome event
+typedef struct {
+    uint8_t slot;
+    uint8_t event;
+    uint32_t tick; // When it was queued, for the press to air latency
+} BeaconEvent;
+
 bool allow_cmd_bt(BtBeacon* bt_model);
 void timer_beacon_reset_callback(void* context);
-bool make_packet(BtBeacon* bt_model, uint8_t* _size, uint8_t** _packet);
+uint8_t beacon_slots(const BtBeacon* ble);
+bool beacon_packet_build(BtBeacon* ble);
+bool beacon_packet_patch(BtBeacon* ble, const uint8_t events[BEACON_SLOTS_MAX]);
 void randomize_mac(uint8_t address[EXTRA_BEACON_MAC_ADDR_SIZE]);
 void pretty_print_mac(FuriString* mac_str, uint8_t address[EXTRA_BEACON_MAC_ADDR_SIZE]);
+bool beacon_event_push(BtBeacon* ble, BeaconControl control);
+void beacon_session_start(BtBeacon* ble);
+uint32_t beacon_worker_step(BtBeacon* ble, uint32_t events);
 int32_t bt_comm_worker(void* context);
@@ -0,0 +1,121 @@
+#include "bt_conn.h"
+
+static const char* const bt_conn_names[BtConnCount] = {"interactive", "idle", "background"};
+
+const char* bt_conn_name(BtConnProfile profile) {
+    return profile < BtConnCount ? bt_conn_names[profile] : "none";
+}
+
+/**
+ * @brief      Start in the interactive profile, nothing asked to the central yet.
+ * @param      conn  the BtConn object
+ * @param      now   the current tick
+*/
+void bt_conn_reset(BtConn* conn, uint32_t now) {
+    memset(conn, 0, sizeof(BtConn));
+    conn->profile = BtConnInteractive;
+    conn->profile_tick = now;
+    conn->requested = BtConnCount;
+}
+
+/**
+ * @brief      Pick the profile from the last input, the time spent goes to the previous one.
+ * @param      conn        the BtConn object
+ * @param      input_tick  the last input on the view
+ * @param      now         the current tick
+ * @param      wait_ms     set to the time until the profile changes, FuriWaitForever if never
+ * @return     the BtConnProfile
+*/
+BtConnProfile bt_conn_update(BtConn* conn, uint32_t input_tick, uint32_t now, uint32_t* wait_ms) {
+    const uint32_t unused = now - input_tick;
+    BtConnProfile profile;
+    if(unused < BT_CONN_IDLE_MS) {
+        profile = BtConnInteractive;
+        *wait_ms = BT_CONN_IDLE_MS - unused;
+    } else if(unused < BT_CONN_BACKGROUND_MS) {
+        profile = BtConnIdle;
+        *wait_ms = BT_CONN_BACKGROUND_MS - unused;
+    } else {
+        profile = BtConnBackground;
+        *wait_ms = FuriWaitForever;
+    }
+
+    if(profile != conn->profile) {
+        conn->stats[conn->profile].time_ms += now - conn->profile_tick;
+        conn->profile = profile;
+        conn->profile_tick = now;
+    }
+    return profile;
+}
+
+/**
+ * @brief      Count a notification the central confirmed, in the current profile.
+ * @param      conn        the BtConn object
+ * @param      bytes       the notification length
+ * @param      latency_ms  from the notification to its DataSent
+*/
+void bt_conn_on_sent(BtConn* conn, size_t bytes, uint32_t latency_ms) {
+    BtConnStats* stats = &conn->stats[conn->profile];
+    stats->notifications++;
+    stats->bytes += bytes;
+    stats->latency_sum_ms += latency_ms;
+    stats->latency_max_ms = MAX(stats->latency_max_ms, latency_ms);
+}
+
+/**
+ * @brief      Estimate the radio duty of the granted parameters.
+ * @details    One connection event every interval * (1 + latency), the peripheral
+ *             skipping the events it has nothing to send in.
+ * @param      stats  the BtConnStats of a profile
+ * @return     the duty in 0.1 %, 0 if the parameters are unknown
+*/
+uint32_t bt_conn_duty_permille(const BtConnStats* stats) {
+    if(stats->interval == 0) {
+        return 0;
+    }
+    const uint32_t period_us = stats->interval * 1250U * (1U + stats->latency);
+    return BT_CONN_EVENT_US * 1000U / period_us;
+}
+
+/**
+ * @brief      Get the confirmed notification bytes per second spent in a profile.
+ * @param      stats  the BtConnStats of a profile
+ * @return     the throughput in B/s, 0 if no time was spent in the profile
+*/
+uint32_t bt_conn_throughput(const BtConnStats* stats) {
+    if(stats->time_ms == 0) {
+        return 0;
+    }
+    return (uint64_t)stats->bytes * 1000U / stats->time_ms;
+}
+
+/**
+ * @brief      Log what every profile achieved, the current one counts until now.
+ * @param      conn  the BtConn object
+ * @param      now   the current tick
+*/
+void bt_conn_log(BtConn* conn, uint32_t now) {
+    conn->stats[conn->profile].time_ms += now - conn->profile_tick;
+    conn->profile_tick = now;
+    for(size_t i = 0; i < BtConnCount; i++) {
+        const BtConnStats* stats = &conn->stats[i];
+        if(stats->time_ms == 0) {
+            continue;
+        }
+        const uint32_t duty_permille = bt_conn_duty_permille(stats);
+        FURI_LOG_I(
+            BT_CONN_TAG,
+            "%s: %lums, %u x1.25ms latency %u, duty ~%lu.%lu%%, notifications %lu, avg %lums, "
+            "max %lums, %lu B/s",
+            bt_conn_names[i],
+            stats->time_ms,
+            stats->interval,
+            stats->latency,
+            duty_permille / 10,
+            duty_permille % 10,
+            stats->notifications,
+            stats->notifications > 0 ? stats->latency_sum_ms / stats->notifications : 0,
+            stats->latency_max_ms,
+            bt_conn_throughput(stats));
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "app.h"
+
+#define BT_CONN_TAG "BT_CONN"
+
+// Without input for this long the view is idle, then in the background
+#define BT_CONN_IDLE_MS       10000U
+#define BT_CONN_BACKGROUND_MS 60000U
+// Radio time of a connection event with little data, for the duty estimate
+#define BT_CONN_EVENT_US 1000U
+
+const char* bt_conn_name(BtConnProfile profile);
+void bt_conn_reset(BtConn* conn, uint32_t now);
+BtConnProfile bt_conn_update(BtConn* conn, uint32_t input_tick, uint32_t now, uint32_t* wait_ms);
+void bt_conn_on_sent(BtConn* conn, size_t bytes, uint32_t latency_ms);
+uint32_t bt_conn_duty_permille(const BtConnStats* stats);
+uint32_t bt_conn_throughput(const BtConnStats* stats);
+void bt_conn_log(BtConn* conn, uint32_t now);
@@ -0,0 +1,269 @@
+#include "bt_rpc.h"
+
+/**
+ * @brief      Clear the calls and the statistics.
+ * @param      rpc           the BtRpc object
+ * @param      send          sends a request packet
+ * @param      send_context  the context of send
+ * @param      first_id      the id of the first call. Should change between sessions, so a
+ *                           late reply of the previous one doesn't match
+*/
+void bt_rpc_init(BtRpc* rpc, BtRpcSend send, void* send_context, uint8_t first_id) {
+    memset(rpc, 0, sizeof(BtRpc));
+    rpc->send = send;
+    rpc->send_context = send_context;
+    rpc->next_id = first_id;
+}
+
+/**
+ * @brief      Get the call waiting for a reply with this id.
+ * @param      rpc  the BtRpc object
+ * @param      id   the call id
+ * @return     the call, NULL if none
+*/
+static BtRpcCall* bt_rpc_find(BtRpc* rpc, uint8_t id) {
+    for(size_t i = 0; i < BT_RPC_MAX_CALLS; i++) {
+        if(rpc->calls[i].active && rpc->calls[i].id == id) {
+            return &rpc->calls[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief      Send a request, the callback runs once with the reply or the timeout.
+ * @param      rpc         the BtRpc object
+ * @param      method      the BtRpcMethod
+ * @param      args        the arguments of the method
+ * @param      args_len    the length of the arguments
+ * @param      timeout_ms  wait this long for the reply
+ * @param      callback    the completion, may be NULL
+ * @param      context     the context of the callback
+ * @param      now         the current tick
+ * @return     the call id, BT_RPC_NO_CALL if all the calls are in flight or the send failed
+*/
+int16_t bt_rpc_call(
+    BtRpc* rpc,
+    uint8_t method,
+    const uint8_t* args,
+    size_t args_len,
+    uint32_t timeout_ms,
+    BtRpcCallback callback,
+    void* context,
+    uint32_t now) {
+    BtRpcCall* call = NULL;
+    for(size_t i = 0; i < BT_RPC_MAX_CALLS && !call; i++) {
+        if(!rpc->calls[i].active) {
+            call = &rpc->calls[i];
+        }
+    }
+    if(!call || args_len > UINT8_MAX) {
+        return BT_RPC_NO_CALL;
+    }
+    // Skip the ids still in flight, a wrap can't reach them with so few calls
+    while(bt_rpc_find(rpc, rpc->next_id)) {
+        rpc->next_id++;
+    }
+    const uint8_t id = rpc->next_id;
+
+    uint8_t buffer[BT_TLV_HEADER_SIZE + 3 * BT_TLV_RECORD_SIZE + 2 + UINT8_MAX];
+    size_t pos = 0;
+    buffer[pos++] = BT_TLV_MAGIC;
+    buffer[pos++] = BT_TLV_VERSION;
+    buffer[pos++] = BT_TLV_TYPE_RPC_ID;
+    buffer[pos++] = 1;
+    buffer[pos++] = id;
+    buffer[pos++] = BT_TLV_TYPE_RPC_METHOD;
+    buffer[pos++] = 1;
+    buffer[pos++] = method;
+    if(args_len > 0) {
+        buffer[pos++] = BT_TLV_TYPE_RPC_ARGS;
+        buffer[pos++] = args_len;
+        memcpy(&buffer[pos], args, args_len);
+        pos += args_len;
+    }
+    if(!rpc->send(rpc->send_context, buffer, pos)) {
+        return BT_RPC_NO_CALL;
+    }
+
+    rpc->next_id++;
+    rpc->sent++;
+    call->active = true;
+    call->id = id;
+    call->method = method;
+    call->sent_tick = now;
+    call->timeout_ms = timeout_ms;
+    call->callback = callback;
+    call->context = context;
+    return id;
+}
+
+int16_t bt_rpc_get_entities(
+    BtRpc* rpc,
+    uint16_t mask,
+    uint32_t timeout_ms,
+    BtRpcCallback callback,
+    void* context,
+    uint32_t now) {
+    const uint8_t args[] = {mask & 0xFF, mask >> 8};
+    return bt_rpc_call(
+        rpc, BtRpcMethodGetEntities, args, sizeof(args), timeout_ms, callback, context, now);
+}
+
+int16_t bt_rpc_get_history(
+    BtRpc* rpc,
+    HaEntity entity,
+    uint32_t back_s,
+    uint8_t count,
+    uint32_t timeout_ms,
+    BtRpcCallback callback,
+    void* context,
+    uint32_t now) {
+    const uint8_t args[] = {
+        entity,
+        back_s & 0xFF,
+        (back_s >> 8) & 0xFF,
+        (back_s >> 16) & 0xFF,
+        back_s >> 24,
+        count,
+    };
+    return bt_rpc_call(
+        rpc, BtRpcMethodGetHistory, args, sizeof(args), timeout_ms, callback, context, now);
+}
+
+int16_t bt_rpc_call_service(
+    BtRpc* rpc,
+    const char* service,
+    const char* entity_id,
+    uint32_t timeout_ms,
+    BtRpcCallback callback,
+    void* context,
+    uint32_t now) {
+    char args[UINT8_MAX + 1];
+    const int len = snprintf(args, sizeof(args), "%s %s", service, entity_id);
+    if(len < 0 || (size_t)len >= sizeof(args)) {
+        return BT_RPC_NO_CALL;
+    }
+    return bt_rpc_call(
+        rpc,
+        BtRpcMethodCallService,
+        (const uint8_t*)args,
+        len,
+        timeout_ms,
+        callback,
+        context,
+        now);
+}
+
+/**
+ * @brief      Check if a call of a method waits for its reply.
+ * @param      rpc     the BtRpc object
+ * @param      method  the BtRpcMethod
+ * @return     true if one is in flight
+*/
+bool bt_rpc_in_flight(const BtRpc* rpc, uint8_t method) {
+    for(size_t i = 0; i < BT_RPC_MAX_CALLS; i++) {
+        if(rpc->calls[i].active && rpc->calls[i].method == method) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief      Complete the call a reply is for.
+ * @details    The reply may carry entity records too, decoding them is up to the caller.
+ * @param      rpc     the BtRpc object
+ * @param      packet  a received TLV packet
+ * @param      len     the packet length
+ * @param      now     the tick the packet was received at
+ * @return     true if the packet is a reply, even to no call
+*/
+bool bt_rpc_on_packet(BtRpc* rpc, const uint8_t* packet, size_t len, uint32_t now) {
+    uint8_t value_len;
+    const uint8_t* id = bt_tlv_find(packet, len, BT_TLV_TYPE_RPC_ID, &value_len);
+    if(!id || value_len != 1) {
+        return false;
+    }
+    const uint8_t* status = bt_tlv_find(packet, len, BT_TLV_TYPE_RPC_STATUS, &value_len);
+
+    BtRpcCall* call = bt_rpc_find(rpc, *id);
+    if(!call) {
+        rpc->unmatched++;
+        return true;
+    }
+    const BtRpcCall done = *call;
+    call->active = false;
+
+    const uint32_t latency_ms = now - done.sent_tick;
+    rpc->replies++;
+    rpc->latency_sum_ms += latency_ms;
+    rpc->latency_max_ms = MAX(rpc->latency_max_ms, latency_ms);
+    if(done.callback) {
+        done.callback(
+            done.context, status && value_len == 1 ? *status : BtRpcStatusOk, packet, len);
+    }
+    return true;
+}
+
+/**
+ * @brief      Time out the calls without reply.
+ * @param      rpc  the BtRpc object
+ * @param      now  the current tick
+ * @return     the time until the next timeout, UINT32_MAX if no call is in flight
+*/
+uint32_t bt_rpc_run(BtRpc* rpc, uint32_t now) {
+    uint32_t wait_ms = UINT32_MAX;
+    for(size_t i = 0; i < BT_RPC_MAX_CALLS; i++) {
+        BtRpcCall* call = &rpc->calls[i];
+        if(!call->active) {
+            continue;
+        }
+        const uint32_t elapsed = now - call->sent_tick;
+        if(elapsed < call->timeout_ms) {
+            wait_ms = MIN(wait_ms, call->timeout_ms - elapsed);
+            continue;
+        }
+        const BtRpcCall done = *call;
+        call->active = false;
+        rpc->timeouts++;
+        FURI_LOG_W(BT_RPC_TAG, "Call %u method %u timed out", done.id, done.method);
+        if(done.callback) {
+            done.callback(done.context, BtRpcStatusTimeout, NULL, 0);
+        }
+    }
+    return wait_ms;
+}
+
+/**
+ * @brief      Get the samples of a history reply.
+ * @param      reply    the reply packet
+ * @param      len      the packet length
+ * @param      samples  filled with the samples, oldest first
+ * @param      max      the size of samples
+ * @return     the number of samples
+*/
+size_t bt_rpc_samples(const uint8_t* reply, size_t len, int16_t* samples, size_t max) {
+    uint8_t value_len;
+    const uint8_t* value = bt_tlv_find(reply, len, BT_TLV_TYPE_SAMPLES, &value_len);
+    if(!value) {
+        return 0;
+    }
+    const size_t count = MIN(value_len / sizeof(int16_t), max);
+    for(size_t i = 0; i < count; i++) {
+        samples[i] = (int16_t)(value[2 * i] | (uint16_t)value[2 * i + 1] << 8);
+    }
+    return count;
+}
+
+void bt_rpc_log(const BtRpc* rpc) {
+    FURI_LOG_I(
+        BT_RPC_TAG,
+        "Calls: %lu, replies: %lu, timeouts: %lu, unmatched: %lu, latency avg: %lums, max: %lums",
+        rpc->sent,
+        rpc->replies,
+        rpc->timeouts,
+        rpc->unmatched,
+        rpc->replies > 0 ? rpc->latency_sum_ms / rpc->replies : 0,
+        rpc->latency_max_ms);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "app.h"
+#include "bt_tlv.h"
+
+#define BT_RPC_TAG "BT_RPC"
+
+// Request: id, method and args records. Reply: id, status and the result records
+typedef enum {
+    // Args: uint16 little endian mask of HaEntity, bit 15 for the flags.
+    // Reply: the entity and flags records
+    BtRpcMethodGetEntities = 1,
+    // Args: HaEntity, uint32 little endian seconds back, sample count.
+    // Reply: one samples record
+    BtRpcMethodGetHistory = 2,
+    // Args: "domain.service entity_id". Reply: status only
+    BtRpcMethodCallService = 3,
+} BtRpcMethod;
+
+typedef enum {
+    BtRpcStatusOk = 0,
+    BtRpcStatusError = 1,
+    BtRpcStatusUnknownMethod = 2,
+    BtRpcStatusTimeout = 0xFF, // Local, no reply in time
+} BtRpcStatus;
+
+#define BT_RPC_ENTITIES_FLAGS (1U << 15)
+#define BT_RPC_NO_CALL        (-1)
+
+void bt_rpc_init(BtRpc* rpc, BtRpcSend send, void* send_context, uint8_t first_id);
+int16_t bt_rpc_call(
+    BtRpc* rpc,
+    uint8_t method,
+    const uint8_t* args,
+    size_t args_len,
+    uint32_t timeout_ms,
+    BtRpcCallback callback,
+    void* context,
+    uint32_t now);
+int16_t bt_rpc_get_entities(
+    BtRpc* rpc,
+    uint16_t mask,
+    uint32_t timeout_ms,
+    BtRpcCallback callback,
+    void* context,
+    uint32_t now);
+int16_t bt_rpc_get_history(
+    BtRpc* rpc,
+    HaEntity entity,
+    uint32_t back_s,
+    uint8_t count,
+    uint32_t timeout_ms,
+    BtRpcCallback callback,
+    void* context,
+    uint32_t now);
+int16_t bt_rpc_call_service(
+    BtRpc* rpc,
+    const char* service,
+    const char* entity_id,
+    uint32_t timeout_ms,
+    BtRpcCallback callback,
+    void* context,
+    uint32_t now);
+bool bt_rpc_in_flight(const BtRpc* rpc, uint8_t method);
+bool bt_rpc_on_packet(BtRpc* rpc, const uint8_t* packet, size_t len, uint32_t now);
+uint32_t bt_rpc_run(BtRpc* rpc, uint32_t now);
+size_t bt_rpc_samples(const uint8_t* reply, size_t len, int16_t* samples, size_t max);
+void bt_rpc_log(const BtRpc* rpc);
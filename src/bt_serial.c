@@ -1,41 +1,543 @@
 #include "src/bt_serial.h"
+#include "src/bt_conn.h"
+#include "src/bt_rpc.h"
+#include "src/bt_tlv.h"
+#include "src/ha_helpers.h"
+#include "src/cmd_channel.h"
 
+// The entities bt_serial_write can toggle, a bit each in cmd_request
+static const char* const bt_serial_toggles[] = {"dh", "ad"};
+
+// Intervals in 1.25 ms units, supervision timeout in 10 ms units
+static const GapConnectionParamsRequest bt_serial_conn_params[BtConnCount] = {
+    // 7.5-15 ms, every event
+    [BtConnInteractive] =
+        {.conn_int_min = 6, .conn_int_max = 12, .slave_latency = 0, .supervisor_timeout = 200},
+    // 30-50 ms, may skip 4 events when there's nothing to send
+    [BtConnIdle] =
+        {.conn_int_min = 24, .conn_int_max = 40, .slave_latency = 4, .supervisor_timeout = 400},
+    // 100-200 ms
+    [BtConnBackground] =
+        {.conn_int_min = 80, .conn_int_max = 160, .slave_latency = 4, .supervisor_timeout = 600},
+};
+
+/**
+ * @brief      Queue a received packet for bt_serial_worker.
+ * @details    Runs in the BLE stack context, so it only copies the packet and signals the
+ *             worker. Decoding, logging and the notification happen in bt_serial_worker.
+ *             DataSent, the confirmation of a notification, only signals the worker too.
+ * @param      event  the serial service event
+ * @param      ctx    the App object
+ * @return     always 0
+*/
 static uint16_t bt_serial_callback(SerialServiceEvent event, void* ctx) {
     furi_assert(ctx);
     App* app = ctx;
     ReqModel* ha_model = view_get_model(app->view_ha);
+    BtSerial* bt_serial = ha_model->bt_serial;
 
     if(event.event == SerialServiceEventTypeDataReceived) {
-        FURI_LOG_I(
-            TAG,
-            "SerialServiceEventTypeDataReceived. Size: %u/%u. Data: %s",
-            event.data.size,
-            sizeof(DataStruct),
-            (char*)event.data.buffer);
+        BtSerialPacket packet;
+        bt_serial->rx_packets++;
+        if(event.data.size > sizeof(packet.data)) {
+            bt_serial->rx_drops++;
+            return 0;
+        }
+        packet.size = event.data.size;
+        memcpy(packet.data, event.data.buffer, event.data.size);
+        if(!spsc_queue_push(bt_serial->rx_queue, &packet)) {
+            bt_serial->rx_drops++;
+            return 0;
+        }
+        const uint32_t depth = spsc_queue_count(bt_serial->rx_queue);
+        if(depth > bt_serial->rx_depth_max) {
+            bt_serial->rx_depth_max = depth;
+        }
+        furi_thread_flags_set(bt_serial->rx_thread_id, ThreadCommUpdData);
+    } else if(event.event == SerialServiceEventTypeDataSent) {
+        furi_thread_flags_set(bt_serial->rx_thread_id, ThreadCommTxDone);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief      Follow the connection for the link supervisor.
+ * @details    Runs in the BT service thread, a disconnection wakes the worker at once.
+ * @param      status   the BtStatus
+ * @param      context  the BtSerial object
+*/
+static void bt_serial_status_callback(BtStatus status, void* context) {
+    BtSerial* bt_serial = context;
+    bt_serial->connected = status == BtStatusConnected;
+    if(!bt_serial->connected) {
+        furi_thread_flags_set(bt_serial->rx_thread_id, ThreadCommInput);
+    }
+}
+
+/**
+ * @brief      Restart advertising, the first seconds are fast so the central finds it soon.
+ * @details    If the central is still connected this closes the connection too.
+ * @param      bt_serial  the BtSerial object
+ * @param      now        the current tick
+*/
+static void bt_serial_link_restart(BtSerial* bt_serial, uint32_t now) {
+    FURI_LOG_I(TAG, "Restarting advertising, next in %lums", bt_serial->restart_delay_ms);
+    furi_hal_bt_stop_advertising();
+    furi_hal_bt_start_advertising();
+    bt_serial->restart_tick = now;
+}
+
+/**
+ * @brief      Update the link supervisor with an accepted packet.
+ * @details    Called with worker_mutex held, the draw callback reads the state.
+ * @param      bt_serial  the BtSerial object
+ * @param      now        the tick the packet was handled at
+*/
+static void bt_serial_link_on_packet(BtSerial* bt_serial, uint32_t now) {
+    if(bt_serial->bt_state == BtStateRecieving || bt_serial->bt_state == BtStateNoData) {
+        const uint32_t gap = now - bt_serial->packet_tick;
+        bt_serial->gap_avg_ms =
+            bt_serial->gap_avg_ms > 0 ? (bt_serial->gap_avg_ms * 7 + gap) / 8 : gap;
+    } else if(bt_serial->bt_state == BtStateLost) {
+        bt_serial->recoveries++;
+        bt_serial->recover_last_ms = now - bt_serial->lost_tick;
+        bt_serial->recover_max_ms = MAX(bt_serial->recover_max_ms, bt_serial->recover_last_ms);
+        FURI_LOG_I(TAG, "Link recovered after %lums", bt_serial->recover_last_ms);
+    }
+    bt_serial->packet_tick = now;
+    bt_serial->bt_state = BtStateRecieving;
+}
+
+/**
+ * @brief      Derive the link state from the packet gaps and recover a lost link.
+ * @details    A sender that stopped without disconnecting keeps the connection open, so
+ *             the gaps are the only sign of it. Called with worker_mutex held.
+ * @param      bt_serial  the BtSerial object
+ * @return     the time until the state may change, FuriWaitForever if only a packet can
+*/
+static uint32_t bt_serial_link_run(BtSerial* bt_serial) {
+    const uint32_t now = furi_get_tick();
+    const bool connected = bt_serial->connected;
+    uint32_t wait_ms = FuriWaitForever;
+
+    if(bt_serial->bt_state == BtStateRecieving || bt_serial->bt_state == BtStateNoData) {
+        const uint32_t gap = now - bt_serial->packet_tick;
+        const uint32_t nodata_ms =
+            MAX(BT_SERIAL_NODATA_GAPS * bt_serial->gap_avg_ms, BT_SERIAL_NODATA_MIN_MS);
+        if(!connected || gap >= BT_SERIAL_LOST_MS) {
+            FURI_LOG_W(TAG, "Link lost, %s", connected ? "no data" : "disconnected");
+            bt_serial->bt_state = BtStateLost;
+            bt_serial->lost_tick = now;
+            bt_serial->restart_delay_ms = BT_SERIAL_RESTART_MIN_MS;
+            if(connected) {
+                bt_serial_link_restart(bt_serial, now);
+            } else {
+                // GAP advertises fast by itself after a disconnection
+                bt_serial->restart_tick = now;
+            }
+        } else if(gap >= nodata_ms) {
+            if(bt_serial->bt_state != BtStateNoData) {
+                FURI_LOG_W(TAG, "No data for %lums", gap);
+            }
+            bt_serial->bt_state = BtStateNoData;
+            wait_ms = BT_SERIAL_LOST_MS - gap;
+        } else {
+            wait_ms = nodata_ms - gap;
+        }
+    }
+
+    if(bt_serial->bt_state == BtStateLost) {
+        uint32_t elapsed = now - bt_serial->restart_tick;
+        if(elapsed >= bt_serial->restart_delay_ms) {
+            bt_serial->restart_delay_ms =
+                MIN(bt_serial->restart_delay_ms * 2, BT_SERIAL_RESTART_MAX_MS);
+            bt_serial_link_restart(bt_serial, now);
+            elapsed = 0;
+        }
+        wait_ms = bt_serial->restart_delay_ms - elapsed;
+    }
+    return wait_ms;
+}
+
+/**
+ * @brief      Decode a packet, TLV first, then the legacy struct.
+ * @param      app     the App object
+ * @param      packet  the packet to decode
+*/
+static void bt_serial_handle_packet(App* app, const BtSerialPacket* packet) {
+    ReqModel* ha_model = view_get_model(app->view_ha);
+    BtSerial* bt_serial = ha_model->bt_serial;
+
+    FURI_LOG_I(
+        TAG,
+        "SerialServiceEventTypeDataReceived. Size: %u, legacy size %u",
+        packet->size,
+        sizeof(DataStruct));
 
-        if(event.data.size == sizeof(DataStruct)) {
-            memcpy(&ha_model->bt_serial->data, event.data.buffer, sizeof(DataStruct));
-            ha_model->bt_serial->bt_state = BtStateRecieving;
-            ha_model->bt_serial->last_packet = furi_hal_rtc_get_timestamp();
-            notification_message(app->notification, &sequence_blink_blue_10);
+    HaSnapshot update;
+    bool has_flags;
+    int16_t ack;
+    const BtTlvResult result =
+        bt_tlv_decode(packet->data, packet->size, &update, &has_flags, &ack);
+    bool accepted = false;
+    if(result == BtTlvOk) {
+        bt_serial->peer_tlv = true;
+        if(ack != BT_TLV_NO_ACK) {
+            cmd_channel_on_ack(&bt_serial->cmd, ack, furi_get_tick());
         }
+        // The values in a reply are taken below like pushed ones
+        bt_rpc_on_packet(&bt_serial->rpc, packet->data, packet->size, furi_get_tick());
+    }
+    // Off the BLE path, so waiting for the draw callback is fine
+    furi_check(furi_mutex_acquire(ha_model->worker_mutex, FuriWaitForever) == FuriStatusOk);
+    if(result == BtTlvOk && update.valid == 0 && !has_flags) {
+        // Only an acknowledgement or an RPC status
+        accepted = true;
+    } else if(result == BtTlvOk) {
+        if(bt_serial->update_ready) {
+            // Keep the flags of the previous update if this one has none
+            if(!has_flags) {
+                update.dehum_sts = bt_serial->update.dehum_sts;
+                update.dehum_aut_sts = bt_serial->update.dehum_aut_sts;
+            }
+            ha_snapshot_merge(&bt_serial->update, &update);
+            bt_serial->update_flags |= has_flags;
+        } else {
+            bt_serial->update = update;
+            bt_serial->update_flags = has_flags;
+        }
+        bt_serial->update_ready = true;
+        accepted = true;
+    } else if(packet->size == sizeof(DataStruct)) {
+        // Legacy senders, a float can start with the TLV magic
+        memcpy(&bt_serial->data, packet->data, sizeof(DataStruct));
+        bt_serial->data_ready = true;
+        accepted = true;
+    } else {
+        bt_serial->rx_errors++;
+    }
+    if(accepted) {
+        bt_serial_link_on_packet(bt_serial, furi_get_tick());
+        bt_serial->last_packet = furi_hal_rtc_get_timestamp();
     }
+    furi_check(furi_mutex_release(ha_model->worker_mutex) == FuriStatusOk);
 
+    if(accepted) {
+        notification_message(app->notification, &sequence_blink_blue_10);
+    } else {
+        FURI_LOG_W(TAG, "Packet dropped, TLV error %u", result);
+    }
+}
+
+/**
+ * @brief      Send a notification, one at a time.
+ * @param      bt_serial  the BtSerial object
+ * @param      data       the packet
+ * @param      len        the packet length
+ * @return     false if the stack refused it
+*/
+static bool bt_serial_tx(BtSerial* bt_serial, uint8_t* data, size_t len) {
+    if(!ble_profile_serial_tx(bt_serial->ble_serial_profile, data, len)) {
+        bt_serial->tx_errors++;
+        return false;
+    }
+    bt_serial->tx_busy = true;
+    bt_serial->tx_tick = furi_get_tick();
+    bt_serial->tx_len = len;
+    return true;
+}
+
+/**
+ * @brief      Run the command channel.
+ * @details    Toggles requested while a command waits for its acknowledgement are merged,
+ *             then sent together in one packet. A sender of the legacy struct can't
+ *             acknowledge, so it gets the old "entity:toggle" strings, one per notification.
+ * @param      bt_serial  the BtSerial object
+ * @return     the time until the channel needs to run again, FuriWaitForever if idle
+*/
+static uint32_t bt_serial_cmd_run(BtSerial* bt_serial) {
+    const uint32_t now = furi_get_tick();
+    // Toggling twice is the same as not toggling
+    bt_serial->cmd_pending ^= __atomic_exchange_n(&bt_serial->cmd_request, 0, __ATOMIC_ACQUIRE);
+
+    if(bt_serial->tx_busy) {
+        const uint32_t elapsed = now - bt_serial->tx_tick;
+        if(elapsed < BT_SERIAL_TX_TIMEOUT_MS) {
+            return BT_SERIAL_TX_TIMEOUT_MS - elapsed;
+        }
+        FURI_LOG_W(TAG, "No DataSent for the last notification");
+        bt_serial->tx_busy = false;
+    }
+
+    if(!bt_serial->peer_tlv) {
+        for(size_t i = 0; i < COUNT_OF(bt_serial_toggles); i++) {
+            if(bt_serial->cmd_pending & (1 << i)) {
+                char buffer[32];
+                snprintf(buffer, sizeof(buffer), "%s:%s", bt_serial_toggles[i], "toggle");
+                if(!bt_serial_tx(bt_serial, (uint8_t*)buffer, strlen(buffer))) {
+                    return BT_SERIAL_TX_RETRY_MS;
+                }
+                bt_serial->cmd_pending &= ~(1 << i);
+                return bt_serial->cmd_pending ? BT_SERIAL_TX_TIMEOUT_MS : FuriWaitForever;
+            }
+        }
+        return FuriWaitForever;
+    }
+
+    if(bt_serial->cmd_pending &&
+       cmd_channel_submit(
+           &bt_serial->cmd, bt_serial->cmd_pending, now, BT_SERIAL_ACK_TIMEOUT_MS)) {
+        bt_serial->cmd_pending = 0;
+    }
+    uint32_t wait_ms;
+    switch(cmd_channel_update(&bt_serial->cmd, now, &wait_ms)) {
+    case CmdChannelActionSend: {
+        const char* entities[COUNT_OF(bt_serial_toggles)];
+        size_t count = 0;
+        for(size_t i = 0; i < COUNT_OF(bt_serial_toggles); i++) {
+            if(bt_serial->cmd.command & (1 << i)) {
+                entities[count++] = bt_serial_toggles[i];
+            }
+        }
+        uint8_t buffer[BT_SERIAL_BUFFER_SIZE];
+        const size_t len = bt_tlv_encode_cmd(
+            bt_serial->cmd.seq, entities, count, BT_TLV_CMD_TOGGLE, buffer, sizeof(buffer));
+        // A refused notification is an attempt without acknowledgement, retried the same way
+        bt_serial_tx(bt_serial, buffer, len);
+    } break;
+
+    case CmdChannelActionGiveUp:
+        // The page tells it's lost
+        FURI_LOG_W(TAG, "Command seq %u lost", bt_serial->cmd.seq);
+        break;
+
+    default:
+        break;
+    }
+    return wait_ms == UINT32_MAX ? FuriWaitForever : wait_ms;
+}
+
+/**
+ * @brief      Transport of the RPC requests, sharing the flow control of the commands.
+ * @param      context  the BtSerial object
+ * @param      data     the request
+ * @param      len      the request length
+ * @return     false if a notification is in flight or the stack refused it
+*/
+static bool bt_serial_rpc_send(void* context, uint8_t* data, size_t len) {
+    BtSerial* bt_serial = context;
+    return !bt_serial->tx_busy && bt_serial_tx(bt_serial, data, len);
+}
+
+/**
+ * @brief      Count the GetEntities calls without reply, the values come with the packet.
+ * @param      context  the BtSerial object
+ * @param      status   the BtRpcStatus
+ * @param      reply    the reply, NULL on timeout
+ * @param      len      the reply length
+*/
+static void bt_serial_rpc_entities_done(
+    void* context,
+    uint8_t status,
+    const uint8_t* reply,
+    size_t len) {
+    UNUSED(reply);
+    UNUSED(len);
+    BtSerial* bt_serial = context;
+    if(status == BtRpcStatusTimeout) {
+        if(bt_serial->rpc_misses < UINT8_MAX) {
+            bt_serial->rpc_misses++;
+        }
+    } else {
+        bt_serial->rpc_misses = 0;
+        if(status != BtRpcStatusOk) {
+            FURI_LOG_W(TAG, "GetEntities failed, status %u", status);
+        }
+    }
+}
+
+/**
+ * @brief      Get the values a page shows, as a GetEntities mask.
+ * @param      page  the PageIndex
+ * @return     the mask, 0 if the page shows no value
+*/
+static uint16_t bt_serial_page_entities(uint8_t page) {
+    switch(page) {
+    case PageFirst:
+        return 1 << HaEntityBedroomTemp | 1 << HaEntityBedroomHum | 1 << HaEntityKitchenTemp |
+               1 << HaEntityKitchenHum;
+    case PageSecond:
+        return 1 << HaEntityOutsideTemp | 1 << HaEntityOutsideHum | BT_RPC_ENTITIES_FLAGS;
+    case PageThird:
+        return 1 << HaEntityCo2 | 1 << HaEntityPm2_5;
+    case PageHistory:
+        // The history keeps every value
+        return ((1 << HaEntityCount) - 1) | BT_RPC_ENTITIES_FLAGS;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief      Fetch the values of the page shown, at once when the page changes.
+ * @param      bt_serial  the BtSerial object
+ * @return     the time until the next call or timeout
+*/
+static uint32_t bt_serial_rpc_run(BtSerial* bt_serial) {
+    const uint32_t now = furi_get_tick();
+    uint32_t wait_ms = bt_rpc_run(&bt_serial->rpc, now);
+    const uint16_t mask = bt_serial_page_entities(bt_serial->rpc_page);
+    // A sender of the legacy struct doesn't know RPC
+    if(!BT_SERIAL_RPC || !bt_serial->peer_tlv || mask == 0 ||
+       bt_rpc_in_flight(&bt_serial->rpc, BtRpcMethodGetEntities)) {
+        return wait_ms;
+    }
+
+    const uint32_t period_ms = bt_serial->rpc_misses < BT_SERIAL_RPC_MAX_MISSES ?
+                                   BT_SERIAL_RPC_POLL_MS :
+                                   BT_SERIAL_RPC_SLOW_MS;
+    const uint32_t elapsed = now - bt_serial->rpc_tick;
+    if(mask == bt_serial->rpc_mask && elapsed < period_ms) {
+        return MIN(wait_ms, period_ms - elapsed);
+    }
+    if(bt_rpc_get_entities(
+           &bt_serial->rpc,
+           mask,
+           BT_SERIAL_RPC_TIMEOUT_MS,
+           bt_serial_rpc_entities_done,
+           bt_serial,
+           now) == BT_RPC_NO_CALL) {
+        // DataSent wakes the worker, this is for a refused notification
+        return MIN(wait_ms, BT_SERIAL_TX_RETRY_MS);
+    }
+    bt_serial->rpc_mask = mask;
+    bt_serial->rpc_tick = now;
+    return MIN(wait_ms, BT_SERIAL_RPC_TIMEOUT_MS);
+}
+
+/**
+ * @brief      Follow the use of the view, asking the central for fitting parameters.
+ * @param      bt_serial  the BtSerial object
+ * @return     the time until the profile needs to change, FuriWaitForever if never
+*/
+static uint32_t bt_serial_conn_run(BtSerial* bt_serial) {
+    uint32_t wait_ms;
+    const BtConnProfile profile =
+        bt_conn_update(&bt_serial->conn, bt_serial->input_tick, furi_get_tick(), &wait_ms);
+    BleProfileSerialConnParams params;
+    if(!ble_profile_serial_get_conn_params(bt_serial->ble_serial_profile, &params)) {
+        // A new connection starts with the parameters of the serial profile
+        bt_serial->conn.requested = BtConnCount;
+        return wait_ms;
+    }
+    bt_serial->conn.stats[profile].interval = params.interval;
+    bt_serial->conn.stats[profile].latency = params.latency;
+
+    if(BT_SERIAL_CONN_PROFILES && profile != bt_serial->conn.requested) {
+        if(ble_profile_serial_request_conn_params(
+               bt_serial->ble_serial_profile, &bt_serial_conn_params[profile])) {
+            FURI_LOG_I(
+                TAG,
+                "Connection profile %s, was %u x1.25ms latency %u",
+                bt_conn_name(profile),
+                params.interval,
+                params.latency);
+            bt_serial->conn.requested = profile;
+        } else {
+            wait_ms = MIN(wait_ms, BT_SERIAL_CONN_RETRY_MS);
+        }
+    }
+    return wait_ms;
+}
+
+/**
+ * @brief      Decode the packets queued by bt_serial_callback and send the commands.
+ * @param      context  the App object
+ * @return     0
+*/
+static int32_t bt_serial_worker(void* context) {
+    App* app = context;
+    ReqModel* ha_model = view_get_model(app->view_ha);
+    BtSerial* bt_serial = ha_model->bt_serial;
+    BtSerialPacket packet;
+    uint32_t timeout = FuriWaitForever;
+    bool run = true;
+
+    while(run) {
+        const uint32_t events = furi_thread_flags_wait(
+            ThreadCommStop | ThreadCommUpdData | ThreadCommSendCmdBt | ThreadCommTxDone |
+                ThreadCommInput,
+            FuriFlagWaitAny,
+            timeout == FuriWaitForever ? FuriWaitForever : furi_ms_to_ticks(timeout));
+        // On timeout only the command channel runs
+        if(!(events & FuriFlagError)) {
+            if(events & ThreadCommStop) {
+                run = false;
+                continue;
+            }
+            if(events & ThreadCommTxDone) {
+                bt_serial->tx_busy = false;
+                bt_conn_on_sent(
+                    &bt_serial->conn, bt_serial->tx_len, furi_get_tick() - bt_serial->tx_tick);
+            }
+            if(events & ThreadCommUpdData) {
+                while(spsc_queue_pop(bt_serial->rx_queue, &packet)) {
+                    bt_serial_handle_packet(app, &packet);
+                }
+                // Let a sender using the flow control characteristic send again
+                ble_profile_serial_notify_buffer_is_empty(bt_serial->ble_serial_profile);
+            }
+        }
+        timeout = MIN(bt_serial_cmd_run(bt_serial), bt_serial_conn_run(bt_serial));
+        // The draw callback reads the link state
+        furi_check(furi_mutex_acquire(ha_model->worker_mutex, FuriWaitForever) == FuriStatusOk);
+        timeout = MIN(timeout, bt_serial_link_run(bt_serial));
+        furi_check(furi_mutex_release(ha_model->worker_mutex) == FuriStatusOk);
+        timeout = MIN(timeout, bt_serial_rpc_run(bt_serial));
+    }
+    FURI_LOG_I(
+        TAG,
+        "BT rx: packets %lu, drops %lu, max depth %lu, errors %lu, tx errors %lu",
+        bt_serial->rx_packets,
+        bt_serial->rx_drops,
+        bt_serial->rx_depth_max,
+        bt_serial->rx_errors,
+        bt_serial->tx_errors);
+    cmd_channel_log(&bt_serial->cmd);
+    bt_conn_log(&bt_serial->conn, furi_get_tick());
+    bt_rpc_log(&bt_serial->rpc);
+    FURI_LOG_I(
+        TAG,
+        "Link recovered %lu times, last after %lums, max %lums",
+        bt_serial->recoveries,
+        bt_serial->recover_last_ms,
+        bt_serial->recover_max_ms);
     return 0;
 }
 
+/**
+ * @brief      Queue a command for the worker, it sends it when the channel is free.
+ * @param      app     the App object
+ * @param      cmd     the BtSerialCmd
+ * @param      entity  the two character entity
+*/
 void bt_serial_write(App* app, BtSerialCmd cmd, char entity[3]) {
     ReqModel* ha_model = view_get_model(app->view_ha);
+    BtSerial* bt_serial = ha_model->bt_serial;
     entity[2] = '\0';
-    char buffer[32];
 
     switch(cmd) {
     case BtSerialCmdToggle:
-        snprintf(buffer, sizeof(buffer), "%s:%s", entity, "toggle");
-        size_t len = strlen(buffer);
-
-        notification_message(app->notification, &sequence_blink_green_10);
-        ble_profile_serial_tx(ha_model->bt_serial->ble_serial_profile, (uint8_t*)buffer, len);
+        for(size_t i = 0; i < COUNT_OF(bt_serial_toggles); i++) {
+            if(strcmp(entity, bt_serial_toggles[i]) == 0) {
+                __atomic_fetch_xor(&bt_serial->cmd_request, 1 << i, __ATOMIC_RELEASE);
+                notification_message(app->notification, &sequence_blink_green_10);
+                furi_thread_flags_set(bt_serial->rx_thread_id, ThreadCommSendCmdBt);
+                return;
+            }
+        }
+        FURI_LOG_W(TAG, "Unknown entity: %s", entity);
         break;
 
     default:
@@ -44,6 +546,44 @@ void bt_serial_write(App* app, BtSerialCmd cmd, char entity[3]) {
     }
 }
 
+/**
+ * @brief      Keep the interactive connection profile while the view is used.
+ * @param      app  the App object
+*/
+void bt_serial_activity(App* app) {
+    ReqModel* ha_model = view_get_model(app->view_ha);
+    ha_model->bt_serial->input_tick = furi_get_tick();
+    if(ha_model->bt_serial->conn.profile != BtConnInteractive) {
+        furi_thread_flags_set(ha_model->bt_serial->rx_thread_id, ThreadCommInput);
+    }
+}
+
+/**
+ * @brief      Check if a value shown is too old, the draw callback sets the ticks.
+ * @details    Called with worker_mutex held, the worker writes the link state under it.
+ * @param      bt_serial  the BtSerial object
+ * @param      entity     the HaEntity
+ * @return     true if the value should be marked
+*/
+bool bt_serial_value_stale(const BtSerial* bt_serial, HaEntity entity) {
+    return bt_serial->bt_state == BtStateLost ||
+           furi_get_tick() - bt_serial->value_tick[entity] >= BT_SERIAL_VALUE_STALE_MS;
+}
+
+/**
+ * @brief      Tell the worker which page is shown, so it fetches its values.
+ * @param      bt_serial  the BtSerial object
+ * @param      page       the PageIndex
+*/
+void bt_serial_page_shown(BtSerial* bt_serial, uint8_t page) {
+    if(page != bt_serial->rpc_page) {
+        bt_serial->rpc_page = page;
+        if(BT_SERIAL_RPC) {
+            furi_thread_flags_set(bt_serial->rx_thread_id, ThreadCommInput);
+        }
+    }
+}
+
 bool init_bt_serial(App* app) {
     ReqModel* ha_model = view_get_model(app->view_ha);
 
@@ -58,11 +598,50 @@ bool init_bt_serial(App* app) {
         bt_profile_start(ha_model->bt_serial->bt, ble_profile_serial, &params);
 
     furi_check(ha_model->bt_serial->ble_serial_profile);
+    // Packets left from the previous visit are stale, the worker isn't running yet
+    spsc_queue_reset(ha_model->bt_serial->rx_queue);
+    ha_model->bt_serial->rx_packets = 0;
+    ha_model->bt_serial->rx_drops = 0;
+    ha_model->bt_serial->rx_depth_max = 0;
+    ha_model->bt_serial->cmd_request = 0;
+    ha_model->bt_serial->cmd_pending = 0;
+    cmd_channel_reset(&ha_model->bt_serial->cmd, furi_hal_random_get());
+    ha_model->bt_serial->peer_tlv = false;
+    ha_model->bt_serial->tx_busy = false;
+    ha_model->bt_serial->tx_errors = 0;
+    ha_model->bt_serial->input_tick = furi_get_tick();
+    bt_conn_reset(&ha_model->bt_serial->conn, furi_get_tick());
+    ha_model->bt_serial->gap_avg_ms = 0;
+    ha_model->bt_serial->recoveries = 0;
+    ha_model->bt_serial->recover_last_ms = 0;
+    ha_model->bt_serial->recover_max_ms = 0;
+    ha_model->bt_serial->connected = false;
+    ha_model->bt_serial->rx_errors = 0;
+    // The view may already draw
+    furi_check(furi_mutex_acquire(ha_model->worker_mutex, FuriWaitForever) == FuriStatusOk);
+    ha_model->bt_serial->bt_state = BtStateWaiting;
+    ha_model->bt_serial->data_ready = false;
+    ha_model->bt_serial->update_ready = false;
+    furi_check(furi_mutex_release(ha_model->worker_mutex) == FuriStatusOk);
+    bt_rpc_init(
+        &ha_model->bt_serial->rpc, bt_serial_rpc_send, ha_model->bt_serial, furi_hal_random_get());
+    ha_model->bt_serial->rpc_page = ha_model->curr_page;
+    ha_model->bt_serial->rpc_mask = 0;
+    ha_model->bt_serial->rpc_misses = 0;
+    // Cached values are old until the sender refreshes them
+    for(size_t e = 0; e < HaEntityCount; e++) {
+        ha_model->bt_serial->value_tick[e] = furi_get_tick() - BT_SERIAL_VALUE_STALE_MS;
+    }
+    ha_model->bt_serial->rx_thread =
+        furi_thread_alloc_ex("bt_serial", 2048, bt_serial_worker, app);
+    furi_thread_start(ha_model->bt_serial->rx_thread);
+    ha_model->bt_serial->rx_thread_id = furi_thread_get_id(ha_model->bt_serial->rx_thread);
+    bt_set_status_changed_callback(
+        ha_model->bt_serial->bt, bt_serial_status_callback, ha_model->bt_serial);
     ble_profile_serial_set_event_callback(
         ha_model->bt_serial->ble_serial_profile, BT_SERIAL_BUFFER_SIZE, bt_serial_callback, app);
     furi_hal_bt_start_advertising();
 
-    ha_model->bt_serial->bt_state = BtStateWaiting;
     FURI_LOG_D(TAG, "Bluetooth is active!");
 
     return true;
@@ -71,6 +650,14 @@ bool init_bt_serial(App* app) {
 bool deinit_bt_serial(App* app) {
     ReqModel* ha_model = view_get_model(app->view_ha);
     ble_profile_serial_set_event_callback(ha_model->bt_serial->ble_serial_profile, 0, NULL, NULL);
+    bt_set_status_changed_callback(ha_model->bt_serial->bt, NULL, NULL);
+    // Stop thread and wait for exit, the callback can't queue anymore
+    if(ha_model->bt_serial->rx_thread) {
+        furi_thread_flags_set(ha_model->bt_serial->rx_thread_id, ThreadCommStop);
+        furi_thread_join(ha_model->bt_serial->rx_thread);
+        furi_thread_free(ha_model->bt_serial->rx_thread);
+        ha_model->bt_serial->rx_thread = NULL;
+    }
     bt_disconnect(ha_model->bt_serial->bt);
     // Wait 2nd core to update nvm storage
     furi_delay_ms(200);
@@ -2,10 +2,48 @@
 #include "app.h"
 #include "libs/serial_profile.h"
 
+#define BT_SERIAL_RX_QUEUE_SIZE 8U
+// The first attempt of a command waits this long for the acknowledgement
+#define BT_SERIAL_ACK_TIMEOUT_MS 1000U
+// Without a DataSent event in this time the notification is considered lost
+#define BT_SERIAL_TX_TIMEOUT_MS 500U
+// Wait before trying again a notification the stack refused
+#define BT_SERIAL_TX_RETRY_MS 20U
+// Ask for short connection intervals while the view is used, longer ones after. The
+// latency and throughput of every profile are measured either way
+#define BT_SERIAL_CONN_PROFILES BLE_PROFILE_SERIAL_CONN_PARAMS
+#define BT_SERIAL_CONN_RETRY_MS 1000U
+// No data after this many average packet gaps, but not sooner than the minimum
+#define BT_SERIAL_NODATA_GAPS   3U
+#define BT_SERIAL_NODATA_MIN_MS 5000U
+// Lost after this long without packets, or when the central disconnects
+#define BT_SERIAL_LOST_MS 30000U
+// While lost, advertising restarts with a fast burst, waiting twice as long every time
+#define BT_SERIAL_RESTART_MIN_MS 30000U
+#define BT_SERIAL_RESTART_MAX_MS 300000U
+// A value not sent for this long is marked on screen, senders should refresh all of them
+#define BT_SERIAL_VALUE_STALE_MS 300000U
+// Fetch the values of the page shown with RPC calls, as well as taking what the sender pushes
+#define BT_SERIAL_RPC            true
+#define BT_SERIAL_RPC_POLL_MS    5000U
+#define BT_SERIAL_RPC_TIMEOUT_MS 2000U
+// After this many calls without reply the sender may not know RPC, poll slower
+#define BT_SERIAL_RPC_MAX_MISSES 3U
+#define BT_SERIAL_RPC_SLOW_MS    60000U
+
 typedef enum {
     BtSerialCmdToggle = 1
 } BtSerialCmd;
 
+// A packet as received, queued by the BLE callback for the rx worker
+typedef struct {
+    uint16_t size;
+    uint8_t data[BT_SERIAL_BUFFER_SIZE];
+} BtSerialPacket;
+
 bool init_bt_serial(App* app);
 bool deinit_bt_serial(App* app);
 void bt_serial_write(App* app, BtSerialCmd cmd, char entity[3]);
+void bt_serial_activity(App* app);
+bool bt_serial_value_stale(const BtSerial* bt_serial, HaEntity entity);
+void bt_serial_page_shown(BtSerial* bt_serial, uint8_t page);
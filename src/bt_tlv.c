@@ -0,0 +1,178 @@
+#include "bt_tlv.h"
+
+/**
+ * @brief      Decode a TLV packet of the BT serial backend.
+ * @details    Only the entities in the packet are set in the update and flagged valid.
+ *             Records of unknown type, or for entities this app doesn't have, are skipped,
+ *             so newer senders can add fields. The packet is rejected as a whole if a
+ *             record runs past its end.
+ * @param      buffer     the received bytes
+ * @param      len        the number of received bytes
+ * @param      update     filled with the values in the packet
+ * @param      has_flags  set if the packet has the dehumidifier flags
+ * @param      ack        set to the acknowledged command sequence, BT_TLV_NO_ACK if none
+ * @return     BtTlvOk if the packet is valid
+*/
+BtTlvResult bt_tlv_decode(
+    const uint8_t* buffer,
+    size_t len,
+    HaSnapshot* update,
+    bool* has_flags,
+    int16_t* ack) {
+    if(len < BT_TLV_HEADER_SIZE || buffer[0] != BT_TLV_MAGIC) {
+        return BtTlvNotTlv;
+    }
+    if(buffer[1] != BT_TLV_VERSION) {
+        return BtTlvBadVersion;
+    }
+
+    // Check the whole packet first, nothing is set from a broken one
+    size_t pos = BT_TLV_HEADER_SIZE;
+    while(pos < len) {
+        if(len - pos < BT_TLV_RECORD_SIZE || len - pos - BT_TLV_RECORD_SIZE < buffer[pos + 1]) {
+            return BtTlvTruncated;
+        }
+        const uint8_t type = buffer[pos];
+        const uint8_t value_len = buffer[pos + 1];
+        if((type >= BT_TLV_TYPE_ENTITY_FIRST && type <= BT_TLV_TYPE_ENTITY_LAST &&
+            value_len != sizeof(int16_t)) ||
+           (type == BT_TLV_TYPE_FLAGS && value_len != 1) ||
+           (type == BT_TLV_TYPE_SEQ && value_len != 1) ||
+           (type == BT_TLV_TYPE_CMD && value_len != BT_TLV_CMD_SIZE) ||
+           ((type == BT_TLV_TYPE_RPC_ID || type == BT_TLV_TYPE_RPC_METHOD ||
+             type == BT_TLV_TYPE_RPC_STATUS) &&
+            value_len != 1) ||
+           (type == BT_TLV_TYPE_SAMPLES && value_len % sizeof(int16_t) != 0)) {
+            return BtTlvBadLength;
+        }
+        pos += BT_TLV_RECORD_SIZE + value_len;
+    }
+
+    update->valid = 0;
+    *has_flags = false;
+    *ack = BT_TLV_NO_ACK;
+    pos = BT_TLV_HEADER_SIZE;
+    while(pos < len) {
+        const uint8_t type = buffer[pos];
+        const uint8_t* value = &buffer[pos + BT_TLV_RECORD_SIZE];
+        const uint8_t entity = type - BT_TLV_TYPE_ENTITY_FIRST;
+        if(type >= BT_TLV_TYPE_ENTITY_FIRST && entity < HaEntityCount) {
+            update->values[entity] = (int16_t)(value[0] | (uint16_t)value[1] << 8);
+            update->valid |= 1 << entity;
+        } else if(type == BT_TLV_TYPE_FLAGS) {
+            update->dehum_sts = value[0] & BT_TLV_FLAG_DEHUM;
+            update->dehum_aut_sts = value[0] & BT_TLV_FLAG_DEHUM_AUT;
+            *has_flags = true;
+        } else if(type == BT_TLV_TYPE_SEQ) {
+            *ack = value[0];
+        }
+        pos += BT_TLV_RECORD_SIZE + buffer[pos + 1];
+    }
+
+    return BtTlvOk;
+}
+
+/**
+ * @brief      Find the first record of a type.
+ * @param      buffer     the packet
+ * @param      len        the packet length
+ * @param      type       the record type
+ * @param      value_len  set to the length of the value
+ * @return     the value, NULL if the packet isn't TLV or has no such record
+*/
+const uint8_t* bt_tlv_find(const uint8_t* buffer, size_t len, uint8_t type, uint8_t* value_len) {
+    if(len < BT_TLV_HEADER_SIZE || buffer[0] != BT_TLV_MAGIC || buffer[1] != BT_TLV_VERSION) {
+        return NULL;
+    }
+    size_t pos = BT_TLV_HEADER_SIZE;
+    while(len - pos >= BT_TLV_RECORD_SIZE &&
+          len - pos - BT_TLV_RECORD_SIZE >= buffer[pos + 1]) {
+        if(buffer[pos] == type) {
+            *value_len = buffer[pos + 1];
+            return &buffer[pos + BT_TLV_RECORD_SIZE];
+        }
+        pos += BT_TLV_RECORD_SIZE + buffer[pos + 1];
+    }
+    return NULL;
+}
+
+/**
+ * @brief      Encode the valid values of a snapshot, the format the sender must use.
+ * @param      snapshot  the values to send
+ * @param      flags     add the dehumidifier flags
+ * @param      buffer    the output buffer
+ * @param      size      the output buffer size
+ * @return     the packet length, 0 if the buffer is too small
+*/
+size_t bt_tlv_encode(const HaSnapshot* snapshot, bool flags, uint8_t* buffer, size_t size) {
+    const size_t needed = BT_TLV_HEADER_SIZE +
+                          __builtin_popcount(snapshot->valid & ((1 << HaEntityCount) - 1)) *
+                              (BT_TLV_RECORD_SIZE + sizeof(int16_t)) +
+                          (flags ? BT_TLV_RECORD_SIZE + 1 : 0);
+    if(size < needed) {
+        return 0;
+    }
+
+    size_t pos = 0;
+    buffer[pos++] = BT_TLV_MAGIC;
+    buffer[pos++] = BT_TLV_VERSION;
+    for(size_t e = 0; e < HaEntityCount; e++) {
+        if(snapshot->valid & (1 << e)) {
+            const uint16_t value = (uint16_t)snapshot->values[e];
+            buffer[pos++] = BT_TLV_TYPE_ENTITY_FIRST + e;
+            buffer[pos++] = sizeof(int16_t);
+            buffer[pos++] = value & 0xFF;
+            buffer[pos++] = value >> 8;
+        }
+    }
+    if(flags) {
+        buffer[pos++] = BT_TLV_TYPE_FLAGS;
+        buffer[pos++] = 1;
+        buffer[pos++] = (snapshot->dehum_sts ? BT_TLV_FLAG_DEHUM : 0) |
+                        (snapshot->dehum_aut_sts ? BT_TLV_FLAG_DEHUM_AUT : 0);
+    }
+
+    return pos;
+}
+
+/**
+ * @brief      Encode a command packet, one record per entity and the sequence.
+ * @details    The sender acknowledges with the sequence in its next packet and must not
+ *             repeat a sequence it already executed, commands are resent until acknowledged.
+ * @param      seq       the command sequence
+ * @param      entities  the two character entities, as in bt_serial_write
+ * @param      count     the number of entities
+ * @param      action    the action for every entity, BT_TLV_CMD_TOGGLE
+ * @param      buffer    the output buffer
+ * @param      size      the output buffer size
+ * @return     the packet length, 0 if the buffer is too small
+*/
+size_t bt_tlv_encode_cmd(
+    uint8_t seq,
+    const char* const* entities,
+    size_t count,
+    uint8_t action,
+    uint8_t* buffer,
+    size_t size) {
+    const size_t needed = BT_TLV_HEADER_SIZE + BT_TLV_RECORD_SIZE + 1 +
+                          count * (BT_TLV_RECORD_SIZE + BT_TLV_CMD_SIZE);
+    if(size < needed) {
+        return 0;
+    }
+
+    size_t pos = 0;
+    buffer[pos++] = BT_TLV_MAGIC;
+    buffer[pos++] = BT_TLV_VERSION;
+    buffer[pos++] = BT_TLV_TYPE_SEQ;
+    buffer[pos++] = 1;
+    buffer[pos++] = seq;
+    for(size_t i = 0; i < count; i++) {
+        buffer[pos++] = BT_TLV_TYPE_CMD;
+        buffer[pos++] = BT_TLV_CMD_SIZE;
+        buffer[pos++] = (uint8_t)entities[i][0];
+        buffer[pos++] = (uint8_t)entities[i][1];
+        buffer[pos++] = action;
+    }
+
+    return pos;
+}
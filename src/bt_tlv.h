@@ -0,0 +1,61 @@
+#pragma once
+#include "app.h"
+
+// Packet: magic, version, then records of type, length and value, in any order
+#define BT_TLV_MAGIC       0xB5
+#define BT_TLV_VERSION     1U
+#define BT_TLV_HEADER_SIZE 2U
+#define BT_TLV_RECORD_SIZE 2U
+
+// Record types
+// HaEntity value, int16 little endian in fixed point (see ha_entity_scale)
+#define BT_TLV_TYPE_ENTITY_FIRST 0x01
+#define BT_TLV_TYPE_ENTITY_LAST  0x3F
+// One byte, bit 0 dehumidifier on, bit 1 automation on
+#define BT_TLV_TYPE_FLAGS 0x40
+
+// One byte, in a command the sequence, from the sender the last command it executed
+#define BT_TLV_TYPE_SEQ 0x41
+// Three bytes, the two characters of the entity and the action. Only in commands
+#define BT_TLV_TYPE_CMD 0x42
+// RPC, see bt_rpc.h. One byte call id, echoed in the reply
+#define BT_TLV_TYPE_RPC_ID 0x43
+// One byte BtRpcMethod, in requests
+#define BT_TLV_TYPE_RPC_METHOD 0x44
+// The arguments of the method, in requests
+#define BT_TLV_TYPE_RPC_ARGS 0x45
+// One byte BtRpcStatus, in replies
+#define BT_TLV_TYPE_RPC_STATUS 0x46
+// int16 little endian values, oldest first, in history replies
+#define BT_TLV_TYPE_SAMPLES 0x47
+
+#define BT_TLV_FLAG_DEHUM     0b00000001
+#define BT_TLV_FLAG_DEHUM_AUT 0b00000010
+
+#define BT_TLV_CMD_SIZE   3U
+#define BT_TLV_CMD_TOGGLE 1U
+#define BT_TLV_NO_ACK     (-1)
+
+typedef enum {
+    BtTlvOk,
+    BtTlvNotTlv, // No magic, maybe the legacy DataStruct
+    BtTlvBadVersion,
+    BtTlvTruncated,
+    BtTlvBadLength, // A known record with the wrong value length
+} BtTlvResult;
+
+BtTlvResult bt_tlv_decode(
+    const uint8_t* buffer,
+    size_t len,
+    HaSnapshot* update,
+    bool* has_flags,
+    int16_t* ack);
+const uint8_t* bt_tlv_find(const uint8_t* buffer, size_t len, uint8_t type, uint8_t* value_len);
+size_t bt_tlv_encode(const HaSnapshot* snapshot, bool flags, uint8_t* buffer, size_t size);
+size_t bt_tlv_encode_cmd(
+    uint8_t seq,
+    const char* const* entities,
+    size_t count,
+    uint8_t action,
+    uint8_t* buffer,
+    size_t size);
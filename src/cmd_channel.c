@@ -0,0 +1,140 @@
+#include "cmd_channel.h"
+
+/**
+ * @brief      Clear the channel and the statistics.
+ * @param      cmd  the CmdChannel object
+ * @param      seq  the sequence of the last command, the next one is seq + 1. Should change
+ *                  between sessions, so the sender doesn't drop the first command as a repeat
+*/
+void cmd_channel_reset(CmdChannel* cmd, uint8_t seq) {
+    memset(cmd, 0, sizeof(CmdChannel));
+    cmd->state = CmdChannelIdle;
+    cmd->seq = seq;
+}
+
+/**
+ * @brief      Queue a command, it's sent by the next cmd_channel_update.
+ * @param      cmd             the CmdChannel object
+ * @param      command         the SghzCommand
+ * @param      now             the current tick
+ * @param      ack_timeout_ms  wait for the acknowledgement of the first attempt
+ * @return     false if a command is still waiting for its acknowledgement
+*/
+bool cmd_channel_submit(CmdChannel* cmd, uint8_t command, uint32_t now, uint32_t ack_timeout_ms) {
+    if(cmd->state != CmdChannelIdle) {
+        return false;
+    }
+    cmd->state = CmdChannelPending;
+    cmd->command = command;
+    cmd->seq++;
+    cmd->attempts = 0;
+    cmd->ack_timeout_ms = ack_timeout_ms;
+    cmd->submit_tick = now;
+    return true;
+}
+
+/**
+ * @brief      Advance the channel state.
+ * @details    Every retry waits twice as long as the previous attempt, the sender may
+ *             be busy or the acknowledging frame may be lost too.
+ * @param      cmd      the CmdChannel object
+ * @param      now      the current tick
+ * @param      wait_ms  filled with the time until the next call is needed, UINT32_MAX if
+ *                      nothing is in progress
+ * @return     what the caller must do
+*/
+CmdChannelAction cmd_channel_update(CmdChannel* cmd, uint32_t now, uint32_t* wait_ms) {
+    *wait_ms = UINT32_MAX;
+
+    switch(cmd->state) {
+    case CmdChannelIdle:
+        return CmdChannelActionNone;
+
+    case CmdChannelWaitAck: {
+        uint32_t timeout_ms = cmd->ack_timeout_ms << (cmd->attempts - 1);
+        if(timeout_ms > CMD_CHANNEL_MAX_TIMEOUT_MS) {
+            timeout_ms = CMD_CHANNEL_MAX_TIMEOUT_MS;
+        }
+        const uint32_t elapsed = now - cmd->sent_tick;
+        if(elapsed < timeout_ms) {
+            *wait_ms = timeout_ms - elapsed;
+            return CmdChannelActionNone;
+        }
+        if(cmd->attempts >= CMD_CHANNEL_MAX_ATTEMPTS) {
+            cmd->state = CmdChannelIdle;
+            cmd->failed++;
+            cmd->failed_tick = now;
+            FURI_LOG_W(
+                CMD_CHANNEL_TAG, "Command %u seq %u not acknowledged", cmd->command, cmd->seq);
+            return CmdChannelActionGiveUp;
+        }
+        cmd->retries++;
+    }
+        // fall through
+    case CmdChannelPending: {
+        cmd->state = CmdChannelWaitAck;
+        cmd->attempts++;
+        cmd->sent++;
+        cmd->sent_tick = now;
+        uint32_t timeout_ms = cmd->ack_timeout_ms << (cmd->attempts - 1);
+        *wait_ms = MIN(timeout_ms, CMD_CHANNEL_MAX_TIMEOUT_MS);
+        return CmdChannelActionSend;
+    }
+
+    default:
+        return CmdChannelActionNone;
+    }
+}
+
+/**
+ * @brief      Handle the acknowledgement carried by a frame of the sender.
+ * @details    The sender keeps acknowledging its last command in every frame, so
+ *             acknowledgements of older commands are ignored.
+ * @param      cmd  the CmdChannel object
+ * @param      seq  the acknowledged sequence
+ * @param      now  the tick the frame was received at
+ * @return     true if the command in progress is done
+*/
+bool cmd_channel_on_ack(CmdChannel* cmd, uint8_t seq, uint32_t now) {
+    if(cmd->state != CmdChannelWaitAck || seq != cmd->seq) {
+        return false;
+    }
+    cmd->state = CmdChannelIdle;
+    cmd->acked++;
+    cmd->latency_last_ms = now - cmd->submit_tick;
+    cmd->latency_sum_ms += cmd->latency_last_ms;
+    if(cmd->latency_last_ms > cmd->latency_max_ms) {
+        cmd->latency_max_ms = cmd->latency_last_ms;
+    }
+    FURI_LOG_I(
+        CMD_CHANNEL_TAG,
+        "Command %u seq %u acknowledged after %lums, %u attempts",
+        cmd->command,
+        seq,
+        cmd->latency_last_ms,
+        cmd->attempts);
+    return true;
+}
+
+/**
+ * @brief      Check if the page should still tell the last command was lost.
+ * @param      cmd  the CmdChannel object
+ * @param      now  the current tick
+ * @return     true for CMD_CHANNEL_FAILED_SHOW_MS after a give up
+*/
+bool cmd_channel_failed_recently(const CmdChannel* cmd, uint32_t now) {
+    return cmd->failed > 0 &&
+           now - cmd->failed_tick < furi_ms_to_ticks(CMD_CHANNEL_FAILED_SHOW_MS);
+}
+
+void cmd_channel_log(const CmdChannel* cmd) {
+    FURI_LOG_I(
+        CMD_CHANNEL_TAG,
+        "Sent: %lu, retries: %lu, acknowledged: %lu, failed: %lu, latency avg: %lums, max: %lums",
+        cmd->sent,
+        cmd->retries,
+        cmd->acked,
+        cmd->failed,
+        cmd->acked > 0 ? cmd->latency_sum_ms / cmd->acked : 0,
+        cmd->latency_max_ms);
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "app.h"
+
+#define CMD_CHANNEL_TAG "CMD_CHANNEL"
+
+// Attempts before giving up, the command is reported as lost
+#define CMD_CHANNEL_MAX_ATTEMPTS   3U
+#define CMD_CHANNEL_MAX_TIMEOUT_MS 60000U
+#define CMD_CHANNEL_FAILED_SHOW_MS 5000U
+
+typedef enum {
+    CmdChannelActionNone,
+    CmdChannelActionSend, // Send the command frame now
+    CmdChannelActionGiveUp, // No acknowledgement after all the attempts
+} CmdChannelAction;
+
+void cmd_channel_reset(CmdChannel* cmd, uint8_t seq);
+bool cmd_channel_submit(CmdChannel* cmd, uint8_t command, uint32_t now, uint32_t ack_timeout_ms);
+CmdChannelAction cmd_channel_update(CmdChannel* cmd, uint32_t now, uint32_t* wait_ms);
+bool cmd_channel_on_ack(CmdChannel* cmd, uint8_t seq, uint32_t now);
+bool cmd_channel_failed_recently(const CmdChannel* cmd, uint32_t now);
+void cmd_channel_log(const CmdChannel* cmd);
@@ -1,4 +1,6 @@
 #include "frame.h"
+#include "ha.h"
+#include "wifi_link.h"
 #include "libs/furi_utils.h"
 
 static const char FRAME_PREV_PATH[] = "/prev";
@@ -6,6 +8,15 @@ static const char FRAME_NEXT_PATH[] = "/next";
 static const char FRAME_RAND_PATH[] = "/rand";
 static const char FRAME_SHUTDOWN_PATH[] = "/shutdown";
 
+// Shown in the dolphin box, indexed by FrameCmd
+static const char frame_cmd_labels[FrameCmdCount][FRAME_CMD_LABEL_SIZE] = {
+    [FrameCmdNone] = "   -> ",
+    [FrameCmdPrev] = "PREV",
+    [FrameCmdNext] = "NEXT",
+    [FrameCmdRand] = "RAND",
+    [FrameCmdShutdown] = "STDN",
+};
+
 extern FlipperHTTP* fhttp;
 
 /**
@@ -25,6 +36,21 @@ static void view_frame_timer_callback(void* context) {
     }
 }
 
+/**
+ * @brief      Join the frame network off the GUI thread, then wait to be stopped.
+ * @details    The probe of a previous association may wait for the ESP32 to answer.
+ * @param      context  The context - App object.
+ * @return     0
+*/
+static int32_t frame_wifi_worker(void* context) {
+    App* app = (App*)context;
+    if(!wifi_link_join(app->wifi_link, fhttp, app->frame_ssid, app->frame_pass)) {
+        FURI_LOG_E(TAG, "Failed to connect to frame WiFi");
+    }
+    furi_thread_flags_wait(ThreadCommStop, FuriFlagWaitAny, FuriWaitForever);
+    return 0;
+}
+
 /**
  * @brief      Callback of the frame screen on enter.
  * @details    Prepare the timer_draw and reset get status.
@@ -35,22 +61,25 @@ void frame_enter_callback(void* context) {
     app->current_view = ViewFrame;
     ReqModel* frame_model = view_get_model(app->view_frame);
 
-    if(!flipper_http_save_wifi(
-           fhttp, furi_string_get_cstr(app->frame_ssid), furi_string_get_cstr(app->frame_pass))) {
-        FURI_LOG_E(TAG, "Failed to connect to frame WiFi");
-    } else {
-        FURI_LOG_I(
-            TAG,
-            "Attempting connection to ssid: %s, pass: %s",
-            furi_string_get_cstr(app->frame_ssid),
-            furi_string_get_cstr(app->frame_pass));
-    }
+    // Stop the Home Assistant polling started at launch, the ESP32 is needed here
+    ha_wifi_stop(app);
+
+    app->comm_thread = furi_thread_alloc_ex("Comm_Thread", 1024, frame_wifi_worker, app);
+    furi_thread_start(app->comm_thread);
+    app->comm_thread_id = furi_thread_get_id(app->comm_thread);
 
     app->timer_draw = furi_timer_alloc(view_frame_timer_callback, FuriTimerTypePeriodic, context);
     // This timer reset the pressed key graphics
     app->timer_reset_key =
         furi_timer_alloc(view_timer_key_reset_callback, FuriTimerTypeOnce, context);
     frame_model->req_sts = false;
+    frame_model->draw_count = 0;
+    frame_model->frame_skip = 0;
+    frame_model->frame_rand = false;
+    frame_model->frame_presses = 0;
+    frame_model->frame_requests = 0;
+    frame_model->draw_cycles_max = 0;
+    frame_model->draw_cycles_sum = 0;
     furi_timer_start(app->timer_draw, furi_ms_to_ticks(DRAW_PERIOD));
 }
 
@@ -61,6 +90,7 @@ void frame_enter_callback(void* context) {
 */
 void frame_exit_callback(void* context) {
     App* app = (App*)context;
+    ReqModel* frame_model = view_get_model(app->view_frame);
     furi_timer_flush();
     furi_timer_stop(app->timer_draw);
     furi_timer_free(app->timer_draw);
@@ -68,6 +98,28 @@ void frame_exit_callback(void* context) {
     furi_timer_stop(app->timer_reset_key);
     furi_timer_free(app->timer_reset_key);
     app->timer_reset_key = NULL;
+    // Stop the join worker, it may still be waiting for the probe
+    furi_thread_flags_set(app->comm_thread_id, ThreadCommStop);
+    furi_thread_join(app->comm_thread);
+    furi_thread_free(app->comm_thread);
+    app->comm_thread = NULL;
+
+    if(frame_model->frame_presses > 0) {
+        FURI_LOG_I(
+            TAG,
+            "Frame presses: %lu, requests: %lu",
+            frame_model->frame_presses,
+            frame_model->frame_requests);
+    }
+    if(frame_model->draw_count > 0) {
+        const uint32_t cycles_per_us = furi_hal_cortex_instructions_per_microsecond();
+        FURI_LOG_I(
+            TAG,
+            "Frame draws: %lu, avg %luus, max %luus",
+            frame_model->draw_count,
+            (uint32_t)(frame_model->draw_cycles_sum / frame_model->draw_count / cycles_per_us),
+            frame_model->draw_cycles_max / cycles_per_us);
+    }
 
     // Prepare textbox
     futils_text_box_format_msg(
@@ -82,81 +134,185 @@ void frame_exit_callback(void* context) {
 */
 void frame_draw_callback(Canvas* canvas, void* model) {
     ReqModel* frame_model = (ReqModel*)model;
+    const uint32_t start = furi_hal_cortex_timer_get(0).start;
     uint8_t dolphin_sts = DolphinIdle;
+    // Single byte reads, the input callback and the HTTP worker may change them meanwhile
     const uint8_t http_state = fhttp->state;
     const uint8_t resp_state = fhttp->curr_req_sts;
+    const bool req_sts = frame_model->req_sts;
+    const uint8_t frame_cmd = frame_model->frame_cmd;
+    const char* cmd = frame_cmd_labels[frame_cmd < FrameCmdCount ? frame_cmd : FrameCmdNone];
 
-    bool req_sts = frame_model->req_sts;
-    // This mutex will stop the timer to run the function again, in case it's still not finished
-    if(furi_mutex_acquire(frame_model->worker_mutex, FuriWaitForever) == FuriStatusOk) {
-        canvas_set_bitmap_mode(canvas, true);
-        futils_draw_header(canvas, "Pi Frame Control", 1, 8);
-        FuriString* cmd = furi_string_alloc();
-        furi_string_set_str(cmd, furi_string_get_cstr(frame_model->curr_cmd));
-
-        // Draw pressed or not grahic
-        if(frame_model->last_input == InputKeyDown) {
-            canvas_draw_icon(canvas, 87, 33, &I_down_hover);
-        } else {
-            canvas_draw_icon(canvas, 87, 33, &I_down);
-        }
+    // Held only to tell the timer a draw is in progress, nothing here needs the lock
+    const bool locked = furi_mutex_acquire(frame_model->worker_mutex, 0) == FuriStatusOk;
+    canvas_set_bitmap_mode(canvas, true);
+    futils_draw_header(canvas, "Pi Frame Control", 1, 8);
 
-        if(frame_model->last_input == InputKeyLeft) {
-            canvas_draw_icon(canvas, 67, 12, &I_left_hover);
-        } else {
-            canvas_draw_icon(canvas, 67, 12, &I_left);
-        }
+    // Draw pressed or not grahic
+    if(frame_model->last_input == InputKeyDown) {
+        canvas_draw_icon(canvas, 87, 33, &I_down_hover);
+    } else {
+        canvas_draw_icon(canvas, 87, 33, &I_down);
+    }
 
-        if(frame_model->last_input == InputKeyOk) {
-            canvas_draw_icon(canvas, 87, 12, &I_ok_hover);
-        } else {
-            canvas_draw_icon(canvas, 87, 12, &I_ok);
-        }
+    if(frame_model->last_input == InputKeyLeft) {
+        canvas_draw_icon(canvas, 67, 12, &I_left_hover);
+    } else {
+        canvas_draw_icon(canvas, 67, 12, &I_left);
+    }
 
-        if(frame_model->last_input == InputKeyRight) {
-            canvas_draw_icon(canvas, 107, 12, &I_right_hover);
-        } else {
-            canvas_draw_icon(canvas, 107, 12, &I_right);
-        }
+    if(frame_model->last_input == InputKeyOk) {
+        canvas_draw_icon(canvas, 87, 12, &I_ok_hover);
+    } else {
+        canvas_draw_icon(canvas, 87, 12, &I_ok);
+    }
 
-        if(!(frame_model->last_input == InputKeyUp)) {
-            canvas_draw_icon(canvas, 109, 60, &I_Pin_pointer_5x3);
-        }
+    if(frame_model->last_input == InputKeyRight) {
+        canvas_draw_icon(canvas, 107, 12, &I_right_hover);
+    } else {
+        canvas_draw_icon(canvas, 107, 12, &I_right);
+    }
 
-        canvas_draw_icon(canvas, 67, 34, &I_prev_text_19x5);
-        canvas_draw_icon(canvas, 108, 34, &I_next_text_19x6);
-        //canvas_draw_icon(canvas, 93, 1, &I_BLE_beacon_7x8);
-        canvas_draw_icon(canvas, 90, 53, &I_shuffle);
-        canvas_draw_icon(canvas, 115, 58, &I_off_text_12x5);
-
-        if(http_state == ISSUE && req_sts) {
-            dolphin_sts = DolphinIssue;
-        } else if((resp_state == PROCESSING_BUSY || req_sts) && resp_state != PROCESSING_DONE) {
-            dolphin_sts = DolphinSending;
-        } else if(resp_state == PROCESSING_DONE || (!req_sts && http_state == IDLE)) {
-            dolphin_sts = DolphinIdle;
+    if(!(frame_model->last_input == InputKeyUp)) {
+        canvas_draw_icon(canvas, 109, 60, &I_Pin_pointer_5x3);
+    }
+
+    canvas_draw_icon(canvas, 67, 34, &I_prev_text_19x5);
+    canvas_draw_icon(canvas, 108, 34, &I_next_text_19x6);
+    //canvas_draw_icon(canvas, 93, 1, &I_BLE_beacon_7x8);
+    canvas_draw_icon(canvas, 90, 53, &I_shuffle);
+    canvas_draw_icon(canvas, 115, 58, &I_off_text_12x5);
+
+    if(http_state == ISSUE && req_sts) {
+        dolphin_sts = DolphinIssue;
+    } else if((resp_state == PROCESSING_BUSY || req_sts) && resp_state != PROCESSING_DONE) {
+        dolphin_sts = DolphinSending;
+    } else if(resp_state == PROCESSING_DONE || (!req_sts && http_state == IDLE)) {
+        dolphin_sts = DolphinIdle;
+    }
+
+    switch(dolphin_sts) {
+    case DolphinIssue:
+        canvas_draw_icon(canvas, 0, 16, &I_dolph_cry_49x54);
+        canvas_draw_icon(canvas, 50, 45, &I_box);
+        canvas_draw_str(canvas, 52, 54, cmd);
+        break;
+    case DolphinIdle:
+        canvas_draw_icon(canvas, -1, 16, &I_DolphinCommon);
+        canvas_draw_icon(canvas, 38, 21, &I_box);
+        canvas_draw_str(canvas, 40, 30, cmd);
+        break;
+    case DolphinSending:
+        canvas_draw_icon(canvas, 0, 9, &I_NFC_dolphin_emulation_51x64);
+        break;
+    default:
+        break;
+    }
+    if(locked) {
+        furi_check(furi_mutex_release(frame_model->worker_mutex) == FuriStatusOk);
+    }
+
+    const uint32_t cycles = furi_hal_cortex_timer_get(0).start - start;
+    frame_model->draw_count++;
+    frame_model->draw_cycles_sum += cycles;
+    frame_model->draw_cycles_max = MAX(frame_model->draw_cycles_max, cycles);
+}
+
+/**
+ * @brief      Build the request of a single command, without a skip count.
+ * @param      frame_model  the frame model
+ * @param      cmd          the FrameCmd to send
+ * @return     false if the command has no request
+*/
+static bool frame_set_path(ReqModel* frame_model, FrameCmd cmd) {
+    const char* path;
+    switch(cmd) {
+    case FrameCmdPrev:
+        path = FRAME_PREV_PATH;
+        break;
+    case FrameCmdNext:
+        path = FRAME_NEXT_PATH;
+        break;
+    case FrameCmdRand:
+        path = FRAME_RAND_PATH;
+        break;
+    case FrameCmdShutdown:
+        path = FRAME_SHUTDOWN_PATH;
+        break;
+    default:
+        return false;
+    }
+    furi_string_set(frame_model->req_path, frame_model->url);
+    furi_string_cat_str(frame_model->req_path, path);
+    frame_model->frame_cmd = cmd;
+    return true;
+}
+
+/**
+ * @brief      Merge a press with the ones not sent yet.
+ * @details    A RAND makes the presses before it pointless, NEXT and PREV cancel out.
+ * @param      frame_model  the frame model
+ * @param      cmd          the FrameCmd pressed
+*/
+static void frame_queue_cmd(ReqModel* frame_model, FrameCmd cmd) {
+    frame_model->frame_presses++;
+    switch(cmd) {
+    case FrameCmdRand:
+        frame_model->frame_rand = true;
+        frame_model->frame_skip = 0;
+        break;
+    case FrameCmdNext:
+        if(frame_model->frame_skip < INT8_MAX) {
+            frame_model->frame_skip++;
         }
+        break;
+    case FrameCmdPrev:
+        if(frame_model->frame_skip > INT8_MIN) {
+            frame_model->frame_skip--;
+        }
+        break;
+    default:
+        break;
+    }
+}
 
-        switch(dolphin_sts) {
-        case DolphinIssue:
-            canvas_draw_icon(canvas, 0, 16, &I_dolph_cry_49x54);
-            canvas_draw_icon(canvas, 50, 45, &I_box);
-            canvas_draw_str(canvas, 52, 54, furi_string_get_cstr(cmd));
-            break;
-        case DolphinIdle:
-            canvas_draw_icon(canvas, -1, 16, &I_DolphinCommon);
-            canvas_draw_icon(canvas, 38, 21, &I_box);
-            canvas_draw_str(canvas, 40, 30, furi_string_get_cstr(cmd));
-            break;
-        case DolphinSending:
-            canvas_draw_icon(canvas, 0, 9, &I_NFC_dolphin_emulation_51x64);
-            break;
-        default:
-            break;
+/**
+ * @brief      Send the merged presses, as soon as the previous request is done.
+ * @details    Called by the input callback and at every draw timer tick, both on the view
+ *             dispatcher thread.
+ * @param      app  the App object
+*/
+void frame_send_pending(App* app) {
+    ReqModel* frame_model = view_get_model(app->view_frame);
+    if((!frame_model->frame_rand && frame_model->frame_skip == 0) || !allow_cmd(frame_model)) {
+        return;
+    }
+
+    const bool rand = frame_model->frame_rand;
+    const bool next = frame_model->frame_skip > 0;
+    uint8_t sent = 0;
+    if(rand) {
+        frame_set_path(frame_model, FrameCmdRand);
+    } else {
+        const uint8_t count = next ? frame_model->frame_skip : -frame_model->frame_skip;
+        sent = FRAME_SKIP_COUNT ? count : 1;
+        frame_set_path(frame_model, next ? FrameCmdNext : FrameCmdPrev);
+        if(sent > 1) {
+            furi_string_cat_printf(frame_model->req_path, "?count=%u", sent);
         }
-        furi_string_free(cmd);
-        furi_check(furi_mutex_release(frame_model->worker_mutex) == FuriStatusOk);
     }
+    frame_model->req_sts =
+        flipper_http_get_request(fhttp, furi_string_get_cstr(frame_model->req_path));
+    // A request that didn't go out stays pending, the next draw tick tries it again
+    if(!frame_model->req_sts) {
+        return;
+    }
+    if(rand) {
+        frame_model->frame_rand = false;
+    } else {
+        frame_model->frame_skip += next ? -sent : sent;
+    }
+    frame_model->frame_requests++;
 }
 
 /**
@@ -182,34 +338,39 @@ bool frame_input_callback(InputEvent* event, void* context) {
     // Status used for drawing button presses
     frame_model->last_input = event->key;
 
-    // Ok sends the command selected with left, right or down. Up long press sends a shfhttp->utdown command
+    // Left, right and down send at once with FRAME_DIRECT_ACTION, else they select the command
+    // Ok sends (again) the selected command. Up long press sends a shutdown command
     if(event->type == InputTypeShort) {
         switch(event->key) {
         case InputKeyOk:
-            if(allow_cmd(frame_model)) {
+            // A single step of the selected command, not the merged skip sent last
+            if(allow_cmd(frame_model) && frame_set_path(frame_model, frame_model->frame_cmd)) {
                 frame_model->req_sts =
                     flipper_http_get_request(fhttp, furi_string_get_cstr(frame_model->req_path));
             }
             break;
         case InputKeyLeft:
-            if(allow_cmd(frame_model)) {
-                furi_string_set_str(frame_model->req_path, furi_string_get_cstr(frame_model->url));
-                furi_string_cat_str(frame_model->req_path, FRAME_PREV_PATH);
-                furi_string_set_str(frame_model->curr_cmd, "PREV");
+            if(FRAME_DIRECT_ACTION) {
+                frame_queue_cmd(frame_model, FrameCmdPrev);
+                frame_send_pending(app);
+            } else if(allow_cmd(frame_model)) {
+                frame_set_path(frame_model, FrameCmdPrev);
             }
             break;
         case InputKeyRight:
-            if(allow_cmd(frame_model)) {
-                furi_string_set_str(frame_model->req_path, furi_string_get_cstr(frame_model->url));
-                furi_string_cat_str(frame_model->req_path, FRAME_NEXT_PATH);
-                furi_string_set_str(frame_model->curr_cmd, "NEXT");
+            if(FRAME_DIRECT_ACTION) {
+                frame_queue_cmd(frame_model, FrameCmdNext);
+                frame_send_pending(app);
+            } else if(allow_cmd(frame_model)) {
+                frame_set_path(frame_model, FrameCmdNext);
             }
             break;
         case InputKeyDown:
-            if(allow_cmd(frame_model)) {
-                furi_string_set_str(frame_model->req_path, furi_string_get_cstr(frame_model->url));
-                furi_string_cat_str(frame_model->req_path, FRAME_RAND_PATH);
-                furi_string_set_str(frame_model->curr_cmd, "RAND");
+            if(FRAME_DIRECT_ACTION) {
+                frame_queue_cmd(frame_model, FrameCmdRand);
+                frame_send_pending(app);
+            } else if(allow_cmd(frame_model)) {
+                frame_set_path(frame_model, FrameCmdRand);
             }
             break;
         case InputKeyBack:
@@ -224,9 +385,7 @@ bool frame_input_callback(InputEvent* event, void* context) {
         switch(event->key) {
         case InputKeyUp:
             if(allow_cmd(frame_model)) {
-                furi_string_set_str(frame_model->req_path, furi_string_get_cstr(frame_model->url));
-                furi_string_cat_str(frame_model->req_path, FRAME_SHUTDOWN_PATH);
-                furi_string_set_str(frame_model->curr_cmd, "STDN");
+                frame_set_path(frame_model, FrameCmdShutdown);
                 frame_model->req_sts =
                     flipper_http_get_request(fhttp, furi_string_get_cstr(frame_model->req_path));
             }
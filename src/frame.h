@@ -10,7 +10,25 @@ typedef enum {
     DolphinSending
 } DolphinSts;
 
+typedef enum {
+    FrameCmdNone,
+    FrameCmdPrev,
+    FrameCmdNext,
+    FrameCmdRand,
+    FrameCmdShutdown,
+    FrameCmdCount,
+} FrameCmd;
+
+#define FRAME_CMD_LABEL_SIZE 7
+
+// Left, right and down send at once, presses during a request are merged into the next one
+#define FRAME_DIRECT_ACTION true
+// Merged presses are sent as one /next?count=N or /prev?count=N, else one request each.
+// Needs a frame that accepts count, older ones ignore it and move by one
+#define FRAME_SKIP_COUNT false
+
 void frame_enter_callback(void* context);
 void frame_exit_callback(void* context);
 void frame_draw_callback(Canvas* canvas, void* model);
 bool frame_input_callback(InputEvent* event, void* context);
+void frame_send_pending(App* app);
@@ -1,8 +1,14 @@
 #include "ha.h"
 #include "ha_helpers.h"
+#include "ha_history.h"
+#include "ha_poll.h"
+#include "ha_telemetry.h"
 #include "ble_beacon.h"
 #include "sghz.h"
+#include "cmd_channel.h"
+#include "sghz_link.h"
 #include "src/bt_serial.h"
+#include "wifi_link.h"
 
 static const char HA_HEADER[] = "{\"Content-Type\": \"application/json\"}";
 static const char HA_SENSORS_PAYLOAD[] = "{\"token\": \"%s\"}";
@@ -12,38 +18,248 @@ const char HA_DEHUM_ENTITY[] = "switch.dehumidifier";
 
 extern FlipperHTTP* fhttp;
 
+_Static_assert(
+    sizeof(SGHZ_DEFAULT_STR) - 1 == SGHZ_ASCII_FRAME_SIZE,
+    "The reassembler expects ASCII messages as long as the default one");
+
 /**
  * @brief      Populate the values for the Home Assistant page
  * @param      model the Home Assistant model
  * @return     true if json data was found
 */
 static bool populate_vals(ReqModel* ha_model) {
+    bool populated = false;
+
     switch(ha_model->control_mode) {
     case HaCtrlWifi:
         const char* response = get_last_response(fhttp);
         if(response[0] == '{') {
             FURI_LOG_I(TAG, "Parsing json");
+            const HaSnapshot prev = ha_model->snapshot;
             parse_ha_json(response, ha_model);
-            return true;
+            populated = true;
+            // Only new responses drive the polling period, not a manual refresh
+            if(!ha_model->populated) {
+                const bool changed =
+                    prev.valid != ha_model->snapshot.valid ||
+                    prev.dehum_sts != ha_model->snapshot.dehum_sts ||
+                    prev.dehum_aut_sts != ha_model->snapshot.dehum_aut_sts ||
+                    memcmp(prev.values, ha_model->snapshot.values, sizeof(prev.values)) != 0;
+                ha_poll_on_data(&ha_model->poll, ha_model->polling_rate, changed);
+            }
         } else {
             FURI_LOG_I(TAG, "No json in last_response, skipping");
         }
         break;
 
-    case HaCtrlSghzBtHome:
-        parse_ha_sghz(furi_string_get_cstr(ha_model->sghz->last_message), ha_model);
-        return true;
+    case HaCtrlSghzBtHome: {
+        // The data is used only when the counter changes
+        SghzComm* sghz = ha_model->sghz;
+        const uint8_t prev_counter = sghz->last_counter;
+        if(sghz->frame_ready) {
+            sghz->frame_ready = false;
+            if(sghz->frame_counter != sghz->last_counter) {
+                sghz->last_counter = sghz->frame_counter;
+                ha_snapshot_merge(&ha_model->snapshot, &sghz->frame);
+                ha_snapshot_render(&ha_model->snapshot, ha_model);
+            }
+        } else if(sghz->message_ready) {
+            sghz->message_ready = false;
+            parse_ha_sghz(furi_string_get_cstr(sghz->last_message), ha_model);
+        }
+        populated = sghz->last_counter != prev_counter;
+    } break;
 
-    case HaCtrlBtSerial:
-        parse_ha_bt_serial(&ha_model->bt_serial->data, ha_model);
-        return true;
+    case HaCtrlBtSerial: {
+        // Only new packets, the cached values are kept until then
+        BtSerial* bt_serial = ha_model->bt_serial;
+        bt_serial_page_shown(bt_serial, ha_model->curr_page);
+        if(bt_serial->update_ready) {
+            bt_serial->update_ready = false;
+            if(!bt_serial->update_flags) {
+                bt_serial->update.dehum_sts = ha_model->snapshot.dehum_sts;
+                bt_serial->update.dehum_aut_sts = ha_model->snapshot.dehum_aut_sts;
+            }
+            ha_snapshot_merge(&ha_model->snapshot, &bt_serial->update);
+            ha_snapshot_render(&ha_model->snapshot, ha_model);
+            for(size_t e = 0; e < HaEntityCount; e++) {
+                if(bt_serial->update.valid & (1 << e)) {
+                    bt_serial->value_tick[e] = furi_get_tick();
+                }
+            }
+            populated = true;
+        } else if(bt_serial->data_ready) {
+            bt_serial->data_ready = false;
+            parse_ha_bt_serial(&bt_serial->data, ha_model);
+            for(size_t e = 0; e < HaEntityCount; e++) {
+                bt_serial->value_tick[e] = furi_get_tick();
+            }
+            populated = true;
+        }
+    } break;
 
     default:
         FURI_LOG_E(TAG, "Not implemented");
         break;
     }
 
-    return false;
+    if(populated && ha_model->snapshot.valid) {
+        ha_model->snapshot.timestamp = furi_hal_rtc_get_timestamp();
+        if(ha_model->control_mode == HaCtrlSghzBtHome) {
+            SghzLinkStats link;
+            sghz_link_stats(&ha_model->sghz->link, &link);
+            ha_model->snapshot.rssi = link.rssi_last;
+            ha_model->snapshot.loss_pct = link.loss_pct;
+        } else {
+            ha_model->snapshot.rssi = 0;
+            ha_model->snapshot.loss_pct = HA_LINK_UNKNOWN;
+        }
+        ha_history_push(ha_model->history, &ha_model->snapshot);
+        ha_telemetry_append(
+            ha_model->telemetry, &ha_model->snapshot, ha_model->control_mode, false);
+        ha_model->stale = false;
+        if(!ha_model->fresh_logged) {
+            ha_model->fresh_logged = true;
+            FURI_LOG_I(
+                TAG,
+                "Fresh data after %lums (%s start)",
+                furi_get_tick() - ha_model->enter_tick,
+                ha_model->warm_start ? "warm" : "cold");
+        }
+    }
+
+    return populated;
+}
+
+/**
+ * @brief      Ask the telemetry log for the window shown on the history page
+ * @param      model the Home Assistant model
+*/
+static void request_history_log(ReqModel* ha_model) {
+    if(ha_model->history_back == 0) {
+        return;
+    }
+    const uint32_t span = HA_HISTORY_SAMPLES * ha_model->history->resolution_s;
+    const uint32_t end = furi_hal_rtc_get_timestamp() - (ha_model->history_back - 1) * span;
+    ha_telemetry_request_window(
+        ha_model->telemetry, ha_model->history_entity, end - span, end);
+}
+
+/**
+ * @brief      Draw how old the cached values are, in place of the loading text
+ * @param      canvas  the canvas to draw on
+ * @param      model   the Home Assistant model
+*/
+static void draw_stale_age(Canvas* canvas, ReqModel* ha_model) {
+    char age_str[12];
+    const uint32_t now = furi_hal_rtc_get_timestamp();
+    const uint32_t age_m =
+        now > ha_model->snapshot.timestamp ? (now - ha_model->snapshot.timestamp) / 60 : 0;
+    if(age_m < 60) {
+        snprintf(age_str, sizeof(age_str), "%lum old", age_m);
+    } else if(age_m < 48 * 60) {
+        snprintf(age_str, sizeof(age_str), "%luh old", age_m / 60);
+    } else {
+        snprintf(age_str, sizeof(age_str), "%lud old", age_m / (24 * 60));
+    }
+    canvas_draw_str(canvas, 75, 7, age_str);
+}
+
+/**
+ * @brief      Draw a value, marked with a * if the BT serial sender didn't refresh it
+ * @param      canvas  the canvas to draw on
+ * @param      model   the Home Assistant model
+ * @param      x       the x of the value
+ * @param      y       the y of the value
+ * @param      entity  the HaEntity of the value
+ * @param      value   the printed value
+*/
+static void draw_value(
+    Canvas* canvas,
+    ReqModel* ha_model,
+    int32_t x,
+    int32_t y,
+    HaEntity entity,
+    const FuriString* value) {
+    const char* str = furi_string_get_cstr(value);
+    canvas_draw_str(canvas, x, y, str);
+    if(ha_model->control_mode == HaCtrlBtSerial &&
+       bt_serial_value_stale(ha_model->bt_serial, entity)) {
+        canvas_draw_str(canvas, x + canvas_string_width(canvas, str) + 1, y, "*");
+    }
+}
+
+/**
+ * @brief      Get the acknowledged command channel of the control mode
+ * @param      ha_model  the Home Assistant model
+ * @return     the CmdChannel, NULL if the commands are not acknowledged
+*/
+static const CmdChannel* ha_cmd_channel(ReqModel* ha_model) {
+    switch(ha_model->control_mode) {
+    case HaCtrlSghzBtHome:
+        return SGHZ_CMD_CHANNEL ? &ha_model->sghz->cmd : NULL;
+    case HaCtrlBtSerial:
+        return &ha_model->bt_serial->cmd;
+    default:
+        return NULL;
+    }
+}
+
+/**
+ * @brief      Draw the Sub-GHz link quality page
+ * @param      canvas  the canvas to draw on
+ * @param      model   the Home Assistant model
+*/
+static void draw_link_page(Canvas* canvas, ReqModel* ha_model) {
+    if(ha_model->control_mode != HaCtrlSghzBtHome) {
+        canvas_draw_str_aligned(canvas, 64, 36, AlignCenter, AlignCenter, "Sub-GHz only");
+        return;
+    }
+
+    const SghzComm* sghz = ha_model->sghz;
+    SghzLinkStats stats;
+    sghz_link_stats(&sghz->link, &stats);
+    char line[48];
+
+    snprintf(
+        line,
+        sizeof(line),
+        "Rx %lu Lost %lu Dup %lu",
+        sghz->link.received,
+        sghz->link.lost,
+        sghz->link.duplicates);
+    canvas_draw_str(canvas, 0, 20, line);
+
+    if(stats.loss_pct == HA_LINK_UNKNOWN) {
+        snprintf(line, sizeof(line), "Loss -  CRC err %lu", sghz->rx.crc_errors);
+    } else {
+        snprintf(
+            line, sizeof(line), "Loss %u%%  CRC err %lu", stats.loss_pct, sghz->rx.crc_errors);
+    }
+    canvas_draw_str(canvas, 0, 31, line);
+
+    if(sghz->link.rssi_count > 0) {
+        snprintf(line, sizeof(line), "RSSI %d dBm", stats.rssi_last);
+        canvas_draw_str(canvas, 0, 42, line);
+        snprintf(
+            line,
+            sizeof(line),
+            "min %d avg %d max %d",
+            stats.rssi_min,
+            stats.rssi_avg,
+            stats.rssi_max);
+        canvas_draw_str(canvas, 0, 53, line);
+    } else {
+        canvas_draw_str(canvas, 0, 42, "RSSI -");
+    }
+
+    snprintf(
+        line,
+        sizeof(line),
+        "Period %lums%s",
+        sghz->sched.period_ms,
+        sghz->sched.locked ? " locked" : "");
+    canvas_draw_str(canvas, 0, 63, line);
 }
 
 /**
@@ -65,6 +281,84 @@ static void view_ha_timer_callback(void* context) {
     }
 }
 
+/**
+ * @brief      Connect to the Home Assistant WiFi and start polling the sensors.
+ * @details    Starts the comm. thread and the polling timer, the first update is sent now.
+ * @param      app  The App object.
+*/
+void ha_wifi_start(App* app) {
+    ReqModel* ha_model = view_get_model(app->view_ha);
+
+    char buffer[sizeof(HA_SENSORS_PAYLOAD) + ha_model->token_lenght];
+    snprintf(
+        buffer,
+        sizeof(HA_SENSORS_PAYLOAD) + ha_model->token_lenght,
+        HA_SENSORS_PAYLOAD,
+        furi_string_get_cstr(ha_model->token));
+    furi_string_set_str(ha_model->payload, buffer);
+
+    char buffer2[sizeof(HA_CMD_PAYLOAD) + ha_model->token_lenght + sizeof(HA_DEHUM_ENTITY)];
+    snprintf(
+        buffer2,
+        sizeof(HA_CMD_PAYLOAD) + ha_model->token_lenght + sizeof(HA_DEHUM_ENTITY),
+        HA_CMD_PAYLOAD,
+        furi_string_get_cstr(ha_model->token),
+        HA_DEHUM_ENTITY);
+    furi_string_set_str(ha_model->payload_dehum, buffer2);
+
+    // The worker joins the network, the probe of a previous association may wait
+    app->comm_thread = furi_thread_alloc_ex("Comm_Thread", 2048, ha_http_worker, app);
+    furi_thread_start(app->comm_thread);
+    FURI_LOG_I(TAG, "Comm. thread started with period [%u]ms", ha_model->polling_rate);
+    app->comm_thread_id = furi_thread_get_id(app->comm_thread);
+    // Update one time on start
+    furi_thread_flags_set(app->comm_thread_id, ThreadCommUpdData);
+    ha_poll_reset(&ha_model->poll, ha_model->polling_rate);
+    app->timer_comm_upd =
+        furi_timer_alloc(comm_thread_timer_callback, FuriTimerTypePeriodic, app);
+    furi_timer_start(app->timer_comm_upd, furi_ms_to_ticks(ha_model->polling_rate));
+    ha_model->req_sts = false;
+}
+
+/**
+ * @brief      Stop polling the sensors and wait for the comm. thread to exit.
+ * @param      app  The App object.
+*/
+void ha_wifi_stop(App* app) {
+    ReqModel* ha_model = view_get_model(app->view_ha);
+
+    if(app->timer_comm_upd) {
+        furi_timer_stop(app->timer_comm_upd);
+        furi_timer_free(app->timer_comm_upd);
+        app->timer_comm_upd = NULL;
+    }
+
+    // Stop thread and wait for exit
+    if(app->comm_thread) {
+        furi_thread_flags_set(app->comm_thread_id, ThreadCommStop);
+        furi_thread_join(app->comm_thread);
+        furi_thread_free(app->comm_thread);
+        app->comm_thread = NULL;
+        ha_poll_log(&ha_model->poll);
+    }
+    ha_poll_stop(&ha_model->poll);
+}
+
+/**
+ * @brief      Start the WiFi backend at launch, so the first data is ready when the
+ *             Home Assistant view opens.
+ * @details    The response is parsed by the first draw of the view. Any other view using
+ *             the ESP32 must call ha_wifi_stop first.
+ * @param      app  The App object.
+*/
+void ha_wifi_warm_up(App* app) {
+    ReqModel* ha_model = view_get_model(app->view_ha);
+    if(ha_model->control_mode == HaCtrlWifi && app->comm_thread == NULL) {
+        FURI_LOG_I(TAG, "Warming up WiFi backend");
+        ha_wifi_start(app);
+    }
+}
+
 /**
  * @brief      Callback of the ha screen on enter.
  * @details    Prepare the timer_draw and reset get status.
@@ -75,65 +369,43 @@ void ha_enter_callback(void* context) {
     app->current_view = ViewHa;
     ReqModel* ha_model = view_get_model(app->view_ha);
 
-    switch(ha_model->control_mode) {
-    case HaCtrlWifi: {
-        char buffer[sizeof(HA_SENSORS_PAYLOAD) + ha_model->token_lenght];
-        snprintf(
-            buffer,
-            sizeof(HA_SENSORS_PAYLOAD) + ha_model->token_lenght,
-            HA_SENSORS_PAYLOAD,
-            furi_string_get_cstr(ha_model->token));
-        furi_string_set_str(ha_model->payload, buffer);
+    // The mode may have changed after the warm up, the other backends reuse the comm. thread.
+    // A warm backend on another network, or whose requests fail, starts again and so rejoins
+    if(ha_model->control_mode != HaCtrlWifi || fhttp->state == ISSUE ||
+       !wifi_link_matches(app->wifi_link, app->ha_ssid, app->ha_pass)) {
+        ha_wifi_stop(app);
+    }
 
-        char buffer2[sizeof(HA_CMD_PAYLOAD) + ha_model->token_lenght + sizeof(HA_DEHUM_ENTITY)];
-        snprintf(
-            buffer2,
-            sizeof(HA_CMD_PAYLOAD) + ha_model->token_lenght + sizeof(HA_DEHUM_ENTITY),
-            HA_CMD_PAYLOAD,
-            furi_string_get_cstr(ha_model->token),
-            HA_DEHUM_ENTITY);
-        furi_string_set_str(ha_model->payload_dehum, buffer2);
-
-        if(!flipper_http_save_wifi(
-               fhttp, furi_string_get_cstr(app->ha_ssid), furi_string_get_cstr(app->ha_pass))) {
-            FURI_LOG_E(TAG, "Failed to connect to Home Assistant WiFi");
-        } else {
-            FURI_LOG_I(
-                TAG,
-                "Attempting connection to ssid: %s, pass: %s",
-                furi_string_get_cstr(app->ha_ssid),
-                furi_string_get_cstr(app->ha_pass));
+    switch(ha_model->control_mode) {
+    case HaCtrlWifi:
+        // The worker may be already running since launch, see ha_wifi_warm_up
+        ha_model->warm_start = app->comm_thread != NULL;
+        if(!ha_model->warm_start) {
+            ha_wifi_start(app);
         }
-        app->comm_thread = furi_thread_alloc_ex("Comm_Thread", 2048, ha_http_worker, app);
-        furi_thread_start(app->comm_thread);
-        FURI_LOG_I(TAG, "Comm. thread started with period [%u]ms", ha_model->polling_rate);
-        app->comm_thread_id = furi_thread_get_id(app->comm_thread);
-        // Update one time on enter
-        furi_thread_flags_set(app->comm_thread_id, ThreadCommUpdData);
-        app->timer_comm_upd =
-            furi_timer_alloc(comm_thread_timer_callback, FuriTimerTypePeriodic, context);
-        furi_timer_start(app->timer_comm_upd, furi_ms_to_ticks(ha_model->polling_rate));
-        ha_model->req_sts = false;
-    } break;
+        break;
 
     case HaCtrlSghzBtHome:
         ha_init_ble(app);
+        // Commands fall back to the beacon when the sender doesn't acknowledge them
+        ha_model->sghz->beacon_thread_id = app->comm_thread_id;
         // Subghz Setup
         ha_model->sghz->status = SGHZ_INIT;
         ha_model->sghz->last_message = furi_string_alloc();
         furi_string_set_str(ha_model->sghz->last_message, SGHZ_DEFAULT_STR);
-        furi_hal_power_suppress_charge_enter();
+        ha_model->sghz->message_ready = false;
+        ha_model->sghz->frame_ready = false;
+        ha_model->sghz->charge_suppressed = false;
         subghz_devices_init();
-        uint32_t frequency = 433920000;
+        ha_model->sghz->frequency = 433920000;
         ha_model->sghz->subghz_txrx = subghz_tx_rx_worker_alloc();
         ha_model->sghz->device = subghz_devices_get_by_name(SUBGHZ_DEVICE_CC1101_INT_NAME);
 
-        if(subghz_tx_rx_worker_start(
-               ha_model->sghz->subghz_txrx, ha_model->sghz->device, frequency)) {
-            subghz_tx_rx_worker_set_callback_have_read(
-                ha_model->sghz->subghz_txrx, subghz_worker_update_rx, app);
-        }
-        FURI_LOG_I(TAG, "Listening at frequency: %lu\r\n", frequency);
+        // Also kept for the restarts of the duty cycle
+        subghz_tx_rx_worker_set_callback_have_read(
+            ha_model->sghz->subghz_txrx, subghz_worker_update_rx, app);
+        sghz_radio_set(ha_model->sghz, true);
+        FURI_LOG_I(TAG, "Listening at frequency: %lu\r\n", ha_model->sghz->frequency);
         ha_model->sghz->rx_thread = furi_thread_alloc_ex("rx_sghz", 1024, listen_rx, ha_model);
         furi_thread_start(ha_model->sghz->rx_thread);
         ha_model->sghz->rx_thread_id = furi_thread_get_id(ha_model->sghz->rx_thread);
@@ -157,6 +429,19 @@ void ha_enter_callback(void* context) {
         furi_timer_alloc(view_timer_key_reset_callback, FuriTimerTypeOnce, context);
 
     ha_model->populated = false;
+
+    // Show the last known values, from this session or from the log, until new data arrives
+    ha_model->enter_tick = furi_get_tick();
+    ha_model->first_frame_logged = false;
+    ha_model->fresh_logged = false;
+    if(ha_model->control_mode != HaCtrlWifi) {
+        ha_model->warm_start = false;
+    }
+    if(ha_model->snapshot.valid == 0 &&
+       ha_telemetry_load_last(ha_model->telemetry, &ha_model->snapshot)) {
+        ha_snapshot_render(&ha_model->snapshot, ha_model);
+    }
+    ha_model->stale = ha_model->snapshot.valid != 0;
 }
 
 /**
@@ -176,47 +461,40 @@ void ha_exit_callback(void* context) {
     furi_timer_free(app->timer_reset_key);
     app->timer_reset_key = NULL;
 
+    // Make sure the last values are in the log for the next start
+    if(ha_model->snapshot.valid && !ha_model->stale) {
+        ha_telemetry_append(
+            ha_model->telemetry, &ha_model->snapshot, ha_model->control_mode, true);
+    }
+
     switch(ha_model->control_mode) {
     case HaCtrlWifi:
-        furi_timer_stop(app->timer_comm_upd);
-        furi_timer_free(app->timer_comm_upd);
-        app->timer_comm_upd = NULL;
         // Prepare textbox
         futils_text_box_format_msg(
             app->formatted_message, get_last_response(fhttp), app->text_box_resp);
 
-        // Stop thread and wait for exit
-        if(app->comm_thread) {
-            furi_thread_flags_set(app->comm_thread_id, ThreadCommStop);
-            furi_thread_join(app->comm_thread);
-            furi_thread_free(app->comm_thread);
-        }
+        ha_wifi_stop(app);
         break;
 
     case HaCtrlSghzBtHome:
-        ha_deinit_ble(app);
         // Subghz Cleanup
-        // Stop thread and wait for exit
+        // Stop thread and wait for exit, before the beacon it may fall back to
         if(ha_model->sghz->rx_thread) {
             furi_thread_flags_set(ha_model->sghz->rx_thread_id, ThreadCommStop);
             furi_thread_join(ha_model->sghz->rx_thread);
             furi_thread_free(ha_model->sghz->rx_thread);
         }
+        ha_deinit_ble(app);
 
-        // Shutdown radio
+        // Shutdown radio, giving back the charge suppression if the receiver is running
+        sghz_radio_set(ha_model->sghz, false);
         subghz_devices_sleep(ha_model->sghz->device);
         subghz_devices_end(ha_model->sghz->device);
         subghz_devices_deinit();
 
         // Cleanup
         furi_string_free(ha_model->sghz->last_message);
-        if(subghz_tx_rx_worker_is_running(ha_model->sghz->subghz_txrx)) {
-            subghz_tx_rx_worker_stop(ha_model->sghz->subghz_txrx);
-        }
-
         subghz_tx_rx_worker_free(ha_model->sghz->subghz_txrx);
-
-        furi_hal_power_suppress_charge_exit();
         // Subghz Cleanup End
         break;
 
@@ -256,6 +534,23 @@ void ha_draw_callback(Canvas* canvas, void* model) {
             (http_state != IDLE || resp_state == PROCESSING_BUSY)) ||
            (ha_model->control_mode == HaCtrlSghzBtHome && ha_model->sghz->status == SGHZ_BUSY)) {
             canvas_draw_str(canvas, 75, 7, "Loading");
+        } else if(ha_model->control_mode == HaCtrlBtSerial &&
+                  ha_model->bt_serial->bt_state == BtStateLost) {
+            canvas_draw_str(canvas, 75, 7, "Lost");
+        } else if(ha_model->control_mode == HaCtrlBtSerial &&
+                  ha_model->bt_serial->bt_state == BtStateNoData) {
+            canvas_draw_str(canvas, 75, 7, "No data");
+        } else if(ha_model->stale) {
+            draw_stale_age(canvas, ha_model);
+        }
+
+        if(!ha_model->first_frame_logged && ha_model->snapshot.valid) {
+            ha_model->first_frame_logged = true;
+            FURI_LOG_I(
+                TAG,
+                "First values shown after %lums (%s)",
+                furi_get_tick() - ha_model->enter_tick,
+                ha_model->stale ? "cached" : "fresh");
         }
 
         switch(ha_model->curr_page) {
@@ -268,8 +563,9 @@ void ha_draw_callback(Canvas* canvas, void* model) {
             canvas_draw_icon(canvas, 76, 11, &I_weather_humidity);
             canvas_draw_icon(canvas, 90, 12, &I_rounded_box);
 
-            canvas_draw_str(canvas, 26, 22, furi_string_get_cstr(ha_model->print_bedroom_temp));
-            canvas_draw_str(canvas, 96, 22, furi_string_get_cstr(ha_model->print_bedroom_hum));
+            draw_value(
+                canvas, ha_model, 26, 22, HaEntityBedroomTemp, ha_model->print_bedroom_temp);
+            draw_value(canvas, ha_model, 96, 22, HaEntityBedroomHum, ha_model->print_bedroom_hum);
 
             futils_draw_header(canvas, "Kitchen", NO_PAGE_NUM, 40);
 
@@ -278,8 +574,9 @@ void ha_draw_callback(Canvas* canvas, void* model) {
             canvas_draw_icon(canvas, 76, 44, &I_weather_humidity);
             canvas_draw_icon(canvas, 90, 46, &I_rounded_box);
 
-            canvas_draw_str(canvas, 26, 56, furi_string_get_cstr(ha_model->print_kitchen_temp));
-            canvas_draw_str(canvas, 96, 56, furi_string_get_cstr(ha_model->print_kitchen_hum));
+            draw_value(
+                canvas, ha_model, 26, 56, HaEntityKitchenTemp, ha_model->print_kitchen_temp);
+            draw_value(canvas, ha_model, 96, 56, HaEntityKitchenHum, ha_model->print_kitchen_hum);
 
             break;
 
@@ -293,10 +590,15 @@ void ha_draw_callback(Canvas* canvas, void* model) {
             canvas_draw_icon(canvas, 76, 11, &I_weather_humidity);
             canvas_draw_icon(canvas, 90, 12, &I_rounded_box);
 
-            canvas_draw_str(canvas, 26, 22, furi_string_get_cstr(ha_model->print_outside_temp));
-            canvas_draw_str(canvas, 96, 22, furi_string_get_cstr(ha_model->print_outside_hum));
+            draw_value(
+                canvas, ha_model, 26, 22, HaEntityOutsideTemp, ha_model->print_outside_temp);
+            draw_value(canvas, ha_model, 96, 22, HaEntityOutsideHum, ha_model->print_outside_hum);
 
             futils_draw_header(canvas, "Dehum.", NO_PAGE_NUM, 40);
+            const CmdChannel* cmd = ha_cmd_channel(ha_model);
+            if(cmd != NULL && cmd_channel_failed_recently(cmd, furi_get_tick())) {
+                canvas_draw_str(canvas, 75, 39, "Cmd lost");
+            }
 
             canvas_draw_icon(canvas, 2, 51, &I_power_text_24x5);
             canvas_draw_icon(canvas, 32, 46, &I_rounded_box);
@@ -317,16 +619,76 @@ void ha_draw_callback(Canvas* canvas, void* model) {
             futils_draw_header(canvas, "Air", ha_model->curr_page, 8);
 
             canvas_draw_icon(canvas, 111, 2, &I_ButtonLeftSmall_3x5);
+            canvas_draw_icon(canvas, 123, 2, &I_ButtonRightSmall_3x5);
 
             canvas_draw_str(canvas, 0, 22, "CO2");
             canvas_draw_icon(canvas, 20, 12, &I_rounded_box);
             canvas_draw_str(canvas, 57, 22, "PM 2.5");
             canvas_draw_icon(canvas, 90, 12, &I_rounded_box);
 
-            canvas_draw_str(canvas, 26, 22, furi_string_get_cstr(ha_model->print_co2));
-            canvas_draw_str(canvas, 96, 22, furi_string_get_cstr(ha_model->print_pm2_5));
+            draw_value(canvas, ha_model, 26, 22, HaEntityCo2, ha_model->print_co2);
+            draw_value(canvas, ha_model, 96, 22, HaEntityPm2_5, ha_model->print_pm2_5);
 
             break;
+
+        case PageHistory: {
+            char title[16];
+            if(ha_model->history_back == 0) {
+                snprintf(title, sizeof(title), "History");
+            } else {
+                const uint32_t back_s = ha_model->history_back * HA_HISTORY_SAMPLES *
+                                        ha_model->history->resolution_s;
+                if(back_s >= 2 * 60 * 60) {
+                    snprintf(title, sizeof(title), "Log -%luh", back_s / (60 * 60));
+                } else {
+                    snprintf(title, sizeof(title), "Log -%lum", back_s / 60);
+                }
+            }
+            futils_draw_header(canvas, title, ha_model->curr_page, 8);
+            canvas_draw_icon(canvas, 111, 2, &I_ButtonLeftSmall_3x5);
+            canvas_draw_icon(canvas, 123, 2, &I_ButtonRightSmall_3x5);
+
+            const HaEntity entity = ha_model->history_entity;
+            canvas_draw_str(canvas, 0, 18, ha_entity_names[entity]);
+            canvas_draw_icon(canvas, 48, 11, &I_ButtonUp_7x4);
+            canvas_draw_icon(canvas, 48, 16, &I_ButtonDown_7x4);
+
+            HaHistoryStats stats = {0};
+            HaTelemetryWindow window;
+            bool window_ready = false;
+            if(ha_model->history_back == 0) {
+                if(ha_history_stats(ha_model->history, entity, &stats)) {
+                    ha_history_draw_sparkline(
+                        canvas, ha_model->history, entity, &stats, 1, 22, 126, 41);
+                }
+            } else if(ha_telemetry_get_window(ha_model->telemetry, &window)) {
+                window_ready = true;
+                ha_history_draw_points(
+                    canvas, window.points, window.count, &stats, 1, 22, 126, 41);
+            }
+
+            if(stats.count > 0) {
+                char min_str[8];
+                char max_str[8];
+                char line[24];
+                ha_entity_format(min_str, sizeof(min_str), entity, stats.min);
+                ha_entity_format(max_str, sizeof(max_str), entity, stats.max);
+                snprintf(line, sizeof(line), "%s-%s", min_str, max_str);
+                canvas_draw_str_aligned(canvas, 127, 18, AlignRight, AlignBottom, line);
+                canvas_draw_frame(canvas, 0, 21, 128, 43);
+            } else if(ha_model->history_back > 0 && !window_ready) {
+                canvas_draw_str_aligned(canvas, 64, 42, AlignCenter, AlignCenter, "Loading log");
+            } else {
+                canvas_draw_str_aligned(canvas, 64, 42, AlignCenter, AlignCenter, "No data");
+            }
+        } break;
+
+        case PageLink:
+            futils_draw_header(canvas, "Link", ha_model->curr_page, 8);
+            canvas_draw_icon(canvas, 111, 2, &I_ButtonLeftSmall_3x5);
+            draw_link_page(canvas, ha_model);
+            break;
+
         default:
             break;
         }
@@ -335,6 +697,28 @@ void ha_draw_callback(Canvas* canvas, void* model) {
     }
 }
 
+/**
+ * @brief      Send a command in Sub-GHz mode, acknowledged over Sub-GHz or as a BTHome beacon
+ * @param      app       the App object
+ * @param      model     the Home Assistant model
+ * @param      command   the SghzCommand
+ * @param      control   the same command for the beacon, without the Sub-GHz command channel
+*/
+static void sghz_send_cmd(
+    App* app,
+    ReqModel* ha_model,
+    SghzCommand command,
+    BeaconControl control) {
+    if(SGHZ_CMD_CHANNEL) {
+        __atomic_fetch_or(&ha_model->sghz->cmd_request, SGHZ_CMD_BIT(command), __ATOMIC_RELEASE);
+        furi_thread_flags_set(ha_model->sghz->rx_thread_id, ThreadCommSendCmd);
+    } else {
+        if(beacon_event_push(ha_model->ble, control)) {
+            furi_thread_flags_set(app->comm_thread_id, ThreadCommSendCmd);
+        }
+    }
+}
+
 /**
  * @brief      Callback for ha screen input.
  * @details    This function is called when the user presses a button while on the ha screen.
@@ -356,6 +740,9 @@ bool ha_input_callback(InputEvent* event, void* context) {
     }
     // Status used for drawing button presses
     ha_model->last_input = event->key;
+    if(ha_model->control_mode == HaCtrlBtSerial) {
+        bt_serial_activity(app);
+    }
     int8_t p_index;
     if(event->type == InputTypeShort) {
         switch(event->key) {
@@ -371,13 +758,22 @@ bool ha_input_callback(InputEvent* event, void* context) {
                 ha_model->curr_page = p_index;
             }
             break;
+        case InputKeyUp:
+            if(ha_model->curr_page == PageHistory) {
+                ha_model->history_entity =
+                    (ha_model->history_entity + HaEntityCount - 1) % HaEntityCount;
+                request_history_log(ha_model);
+            }
+            break;
         case InputKeyDown:
-            if(ha_model->curr_page == PageSecond) {
+            if(ha_model->curr_page == PageHistory) {
+                ha_model->history_entity = (ha_model->history_entity + 1) % HaEntityCount;
+                request_history_log(ha_model);
+            } else if(ha_model->curr_page == PageSecond) {
                 if(ha_model->control_mode == HaCtrlWifi) {
                     furi_thread_flags_set(app->comm_thread_id, ThreadCommSendCmd);
                 } else if(ha_model->control_mode == HaCtrlSghzBtHome) {
-                    ha_model->ble->event_type = BTHomeShortPress;
-                    furi_thread_flags_set(app->comm_thread_id, ThreadCommSendCmd);
+                    sghz_send_cmd(app, ha_model, SghzCommandDehum, BeaconControlDehum);
                 } else if(ha_model->control_mode == HaCtrlBtSerial) {
                     char entity[3] = "dh";
                     bt_serial_write(app, BtSerialCmdToggle, entity);
@@ -397,13 +793,24 @@ bool ha_input_callback(InputEvent* event, void* context) {
         return true;
     } else if(event->type == InputTypeLong) {
         switch(event->key) {
+        // Scroll the history page back and forth through the telemetry log
+        case InputKeyUp:
+            if(ha_model->curr_page == PageHistory && ha_model->history_back < HISTORY_BACK_MAX) {
+                ha_model->history_back++;
+                request_history_log(ha_model);
+            }
+            break;
         case InputKeyDown:
-            if(ha_model->curr_page == PageSecond) {
+            if(ha_model->curr_page == PageHistory) {
+                if(ha_model->history_back > 0) {
+                    ha_model->history_back--;
+                    request_history_log(ha_model);
+                }
+            } else if(ha_model->curr_page == PageSecond) {
                 if(ha_model->control_mode == HaCtrlWifi) {
                     furi_thread_flags_set(app->comm_thread_id, ThreadCommSendCmd);
                 } else if(ha_model->control_mode == HaCtrlSghzBtHome) {
-                    ha_model->ble->event_type = BTHomeLongPress;
-                    furi_thread_flags_set(app->comm_thread_id, ThreadCommSendCmd);
+                    sghz_send_cmd(app, ha_model, SghzCommandDehumAut, BeaconControlDehumAut);
                 } else if(ha_model->control_mode == HaCtrlBtSerial) {
                     char entity[3] = "ad";
                     bt_serial_write(app, BtSerialCmdToggle, entity);
@@ -427,6 +834,10 @@ int32_t ha_http_worker(void* context) {
     App* app = context;
     ReqModel* ha_model = view_get_model(app->view_ha);
 
+    if(!wifi_link_join(app->wifi_link, fhttp, app->ha_ssid, app->ha_pass)) {
+        FURI_LOG_E(TAG, "Failed to connect to Home Assistant WiFi");
+    }
+
     bool run = true;
 
     while(run) {
@@ -452,6 +863,7 @@ int32_t ha_http_worker(void* context) {
                 furi_string_get_cstr(ha_model->payload_dehum));
             if(ha_model->req_sts) {
                 FURI_LOG_I(TAG, "Thread event: Command sent");
+                ha_poll_kick(&ha_model->poll, ha_model->polling_rate);
             } else {
                 FURI_LOG_E(TAG, "Thread event: Command send failed");
             }
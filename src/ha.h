@@ -4,8 +4,13 @@
 #include <gui/canvas.h>
 #include <input/input.h>
 
+#define HISTORY_BACK_MAX 30U
+
 #define SGHZ_DEFAULT_STR "00bt0000bh0000kt0000kh0000ot0000oh0000dhxoffadxoffco0000pm0000"
 
+void ha_wifi_start(App* app);
+void ha_wifi_stop(App* app);
+void ha_wifi_warm_up(App* app);
 void ha_enter_callback(void* context);
 void ha_exit_callback(void* context);
 void ha_draw_callback(Canvas* canvas, void* model);
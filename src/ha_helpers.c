@@ -1,5 +1,6 @@
 #include "ha_helpers.h"
 #include "ble_beacon.h"
+#include "sghz_ascii.h"
 
 static const char HA_BEDROOM_TEMP_KEY[] = "bt";
 static const char HA_BEDROOM_HUM_KEY[] = "bh";
@@ -12,6 +13,61 @@ static const char HA_DEHUM_AUTOMATION_KEY[] = "ad";
 static const char HA_CO2_KEY[] = "co";
 static const char HA_PM2_5_KEY[] = "pm";
 
+const char* ha_entity_names[HaEntityCount] = {
+    "Bedroom T",
+    "Bedroom H",
+    "Kitchen T",
+    "Kitchen H",
+    "Outside T",
+    "Outside H",
+    "CO2",
+    "PM 2.5",
+};
+
+/**
+ * @brief      The string shown on screen for an entity.
+*/
+static FuriString* ha_entity_print(ReqModel* ha_model, HaEntity entity) {
+    switch(entity) {
+    case HaEntityBedroomTemp:
+        return ha_model->print_bedroom_temp;
+    case HaEntityBedroomHum:
+        return ha_model->print_bedroom_hum;
+    case HaEntityKitchenTemp:
+        return ha_model->print_kitchen_temp;
+    case HaEntityKitchenHum:
+        return ha_model->print_kitchen_hum;
+    case HaEntityOutsideTemp:
+        return ha_model->print_outside_temp;
+    case HaEntityOutsideHum:
+        return ha_model->print_outside_hum;
+    case HaEntityCo2:
+        return ha_model->print_co2;
+    default:
+        return ha_model->print_pm2_5;
+    }
+}
+
+/**
+ * @brief      Update the printed strings from the fixed point values of a snapshot.
+ * @param      snapshot  the values to show
+ * @param      ha_model  the Home Assistant model
+*/
+void ha_snapshot_render(const HaSnapshot* snapshot, ReqModel* ha_model) {
+    char temp_str[8];
+    for(size_t e = 0; e < HaEntityCount; e++) {
+        if(snapshot->valid & (1 << e)) {
+            ha_entity_format(temp_str, sizeof(temp_str), e, snapshot->values[e]);
+            furi_string_set_str(ha_entity_print(ha_model, e), temp_str);
+        }
+    }
+    furi_string_printf(
+        ha_model->print_dehum_sts,
+        "%s-%s",
+        snapshot->dehum_sts ? "on" : "off",
+        snapshot->dehum_aut_sts ? "A" : "M");
+}
+
 void parse_ha_json(const char* response, ReqModel* ha_model) {
     const uint16_t max_tokens = 128;
     // Must free the return value memory
@@ -19,144 +75,91 @@ void parse_ha_json(const char* response, ReqModel* ha_model) {
     value = get_json_value(HA_BEDROOM_TEMP_KEY, response, max_tokens);
     if(value) {
         furi_string_set_str(ha_model->print_bedroom_temp, value);
+        ha_snapshot_set_str(&ha_model->snapshot, HaEntityBedroomTemp, value);
         free(value);
     }
     value = get_json_value(HA_BEDROOM_HUM_KEY, response, max_tokens);
     if(value) {
         furi_string_set_str(ha_model->print_bedroom_hum, value);
+        ha_snapshot_set_str(&ha_model->snapshot, HaEntityBedroomHum, value);
         free(value);
     }
 
     value = get_json_value(HA_KITCHEN_TEMP_KEY, response, max_tokens);
     if(value) {
         furi_string_set_str(ha_model->print_kitchen_temp, value);
+        ha_snapshot_set_str(&ha_model->snapshot, HaEntityKitchenTemp, value);
         free(value);
     }
     value = get_json_value(HA_KITCHEN_HUM_KEY, response, max_tokens);
     if(value) {
         furi_string_set_str(ha_model->print_kitchen_hum, value);
+        ha_snapshot_set_str(&ha_model->snapshot, HaEntityKitchenHum, value);
         free(value);
     }
 
     value = get_json_value(HA_OUTSIDE_TEMP_KEY, response, max_tokens);
     if(value) {
         furi_string_set_str(ha_model->print_outside_temp, value);
+        ha_snapshot_set_str(&ha_model->snapshot, HaEntityOutsideTemp, value);
         free(value);
     }
     value = get_json_value(HA_OUTSIDE_HUM_KEY, response, max_tokens);
     if(value) {
         furi_string_set_str(ha_model->print_outside_hum, value);
+        ha_snapshot_set_str(&ha_model->snapshot, HaEntityOutsideHum, value);
         free(value);
     }
 
     value = get_json_value(HA_DEHUM_KEY, response, max_tokens);
     if(value) {
         furi_string_set_str(ha_model->print_dehum_sts, value);
+        ha_model->snapshot.dehum_sts = strstr(value, "on") != NULL;
         free(value);
     }
 
     value = get_json_value(HA_DEHUM_AUTOMATION_KEY, response, max_tokens);
     if(value) {
-        if(strstr(value, "on")) {
+        ha_model->snapshot.dehum_aut_sts = strstr(value, "on") != NULL;
+        if(ha_model->snapshot.dehum_aut_sts) {
             furi_string_cat_str(ha_model->print_dehum_sts, "-A");
         } else {
             furi_string_cat_str(ha_model->print_dehum_sts, "-M");
         }
+        free(value);
     }
 
     value = get_json_value(HA_CO2_KEY, response, max_tokens);
     if(value) {
         furi_string_set_str(ha_model->print_co2, value);
+        ha_snapshot_set_str(&ha_model->snapshot, HaEntityCo2, value);
         free(value);
     }
 
     value = get_json_value(HA_PM2_5_KEY, response, max_tokens);
     if(value) {
         furi_string_set_str(ha_model->print_pm2_5, value);
+        ha_snapshot_set_str(&ha_model->snapshot, HaEntityPm2_5, value);
         free(value);
     }
 }
 
+/**
+ * @brief      Parse the Sub-GHz ASCII message into the model, see sghz_ascii_parse.
+ * @param      string    the message
+ * @param      ha_model  the Home Assistant model
+*/
 void parse_ha_sghz(const char* string, ReqModel* ha_model) {
-    const size_t FIELD_SIZE = 4;
-    char counter[] = "00";
-    memcpy(counter, string, 2);
-    counter[sizeof(counter) - 1] = '\0';
-    uint8_t counter_u = strtoul(counter, NULL, 0);
-
-    if(counter_u != ha_model->sghz->last_counter &&
-       furi_string_size(ha_model->sghz->last_message) > 0) {
-        ha_model->sghz->last_counter = counter_u;
-        char temp_str[5];
-        size_t pos = 0;
-        pos = furi_string_search_str(ha_model->sghz->last_message, HA_BEDROOM_TEMP_KEY, 0);
-        if(pos != FURI_STRING_FAILURE) {
-            memcpy(temp_str, &string[pos + 2], FIELD_SIZE);
-            temp_str[sizeof(temp_str) - 1] = '\0';
-            furi_string_set_str(ha_model->print_bedroom_temp, temp_str);
-        }
-        pos = furi_string_search_str(ha_model->sghz->last_message, HA_BEDROOM_HUM_KEY, 0);
-        if(pos != FURI_STRING_FAILURE) {
-            memcpy(temp_str, &string[pos + 2], FIELD_SIZE);
-            temp_str[sizeof(temp_str) - 1] = '\0';
-            furi_string_set_str(ha_model->print_bedroom_hum, temp_str);
-        }
-        pos = furi_string_search_str(ha_model->sghz->last_message, HA_KITCHEN_TEMP_KEY, 0);
-        if(pos != FURI_STRING_FAILURE) {
-            memcpy(temp_str, &string[pos + 2], FIELD_SIZE);
-            temp_str[sizeof(temp_str) - 1] = '\0';
-            furi_string_set_str(ha_model->print_kitchen_temp, temp_str);
-        }
-        pos = furi_string_search_str(ha_model->sghz->last_message, HA_KITCHEN_HUM_KEY, 0);
-        if(pos != FURI_STRING_FAILURE) {
-            memcpy(temp_str, &string[pos + 2], FIELD_SIZE);
-            temp_str[sizeof(temp_str) - 1] = '\0';
-            furi_string_set_str(ha_model->print_kitchen_hum, temp_str);
-        }
-        pos = furi_string_search_str(ha_model->sghz->last_message, HA_OUTSIDE_TEMP_KEY, 0);
-        if(pos != FURI_STRING_FAILURE) {
-            memcpy(temp_str, &string[pos + 2], FIELD_SIZE);
-            temp_str[sizeof(temp_str) - 1] = '\0';
-            furi_string_set_str(ha_model->print_outside_temp, temp_str);
-        }
-        pos = furi_string_search_str(ha_model->sghz->last_message, HA_OUTSIDE_HUM_KEY, 0);
-        if(pos != FURI_STRING_FAILURE) {
-            memcpy(temp_str, &string[pos + 2], FIELD_SIZE);
-            temp_str[sizeof(temp_str) - 1] = '\0';
-            furi_string_set_str(ha_model->print_outside_hum, temp_str);
-        }
-        pos = furi_string_search_str(ha_model->sghz->last_message, HA_CO2_KEY, 0);
-        if(pos != FURI_STRING_FAILURE) {
-            memcpy(temp_str, &string[pos + 2], FIELD_SIZE);
-            temp_str[sizeof(temp_str) - 1] = '\0';
-            furi_string_set_str(ha_model->print_co2, temp_str);
-        }
-        pos = furi_string_search_str(ha_model->sghz->last_message, HA_PM2_5_KEY, 0);
-        if(pos != FURI_STRING_FAILURE) {
-            memcpy(temp_str, &string[pos + 2], FIELD_SIZE);
-            temp_str[sizeof(temp_str) - 1] = '\0';
-            furi_string_set_str(ha_model->print_pm2_5, temp_str);
-        }
-        pos = furi_string_search_str(ha_model->sghz->last_message, HA_DEHUM_KEY, 0);
-        if(pos != FURI_STRING_FAILURE) {
-            memcpy(temp_str, &string[pos + 2], FIELD_SIZE);
-            temp_str[sizeof(temp_str) - 1] = '\0';
-            if(strstr(temp_str, "on")) {
-                furi_string_set_str(ha_model->print_dehum_sts, "on");
-            } else {
-                furi_string_set_str(ha_model->print_dehum_sts, "off");
-            }
-        }
-        pos = furi_string_search_str(ha_model->sghz->last_message, HA_DEHUM_AUTOMATION_KEY, 0);
-        if(pos != FURI_STRING_FAILURE) {
-            memcpy(temp_str, &string[pos + 2], FIELD_SIZE);
-            temp_str[sizeof(temp_str) - 1] = '\0';
-            if(strstr(temp_str, "on")) {
-                furi_string_cat_str(ha_model->print_dehum_sts, "-A");
-            } else {
-                furi_string_cat_str(ha_model->print_dehum_sts, "-M");
-            }
-        }
+    SghzAsciiPrints prints = {.dehum_sts = ha_model->print_dehum_sts};
+    for(size_t e = 0; e < HaEntityCount; e++) {
+        prints.values[e] = ha_entity_print(ha_model, e);
+    }
+    const SghzAsciiResult result = sghz_ascii_parse(
+        string, &ha_model->sghz->last_counter, &ha_model->snapshot, &prints);
+    if(result == SghzAsciiNoCounter) {
+        FURI_LOG_E(TAG, "Sub-GHz message without counter, skipping");
+    } else if(result == SghzAsciiTruncated) {
+        FURI_LOG_E(TAG, "Sub-GHz message truncated, %u bytes", strlen(string));
     }
 }
 
@@ -164,19 +167,27 @@ void parse_ha_bt_serial(DataStruct* data, ReqModel* ha_model) {
     char temp_str[6];
     snprintf(temp_str, sizeof(temp_str) - 1, "%2.2f", (double_t)data->bedroom_temp);
     furi_string_set_str(ha_model->print_bedroom_temp, temp_str);
+    ha_snapshot_set_float(&ha_model->snapshot, HaEntityBedroomTemp, data->bedroom_temp);
     snprintf(temp_str, sizeof(temp_str) - 1, "%2.2f", (double_t)data->bedroom_hum);
     furi_string_set_str(ha_model->print_bedroom_hum, temp_str);
+    ha_snapshot_set_float(&ha_model->snapshot, HaEntityBedroomHum, data->bedroom_hum);
 
     snprintf(temp_str, sizeof(temp_str) - 1, "%2.2f", (double_t)data->kitchen_temp);
     furi_string_set_str(ha_model->print_kitchen_temp, temp_str);
+    ha_snapshot_set_float(&ha_model->snapshot, HaEntityKitchenTemp, data->kitchen_temp);
     snprintf(temp_str, sizeof(temp_str) - 1, "%2.2f", (double_t)data->kitchen_hum);
     furi_string_set_str(ha_model->print_kitchen_hum, temp_str);
+    ha_snapshot_set_float(&ha_model->snapshot, HaEntityKitchenHum, data->kitchen_hum);
 
     snprintf(temp_str, sizeof(temp_str) - 1, "%2.2f", (double_t)data->outside_temp);
     furi_string_set_str(ha_model->print_outside_temp, temp_str);
+    ha_snapshot_set_float(&ha_model->snapshot, HaEntityOutsideTemp, data->outside_temp);
     snprintf(temp_str, sizeof(temp_str) - 1, "%2.2f", (double_t)data->outside_hum);
     furi_string_set_str(ha_model->print_outside_hum, temp_str);
+    ha_snapshot_set_float(&ha_model->snapshot, HaEntityOutsideHum, data->outside_hum);
 
+    ha_model->snapshot.dehum_sts = data->dehum_sts;
+    ha_model->snapshot.dehum_aut_sts = data->dehum_aut_sts;
     if(data->dehum_sts) {
         furi_string_set_str(ha_model->print_dehum_sts, "on");
     } else {
@@ -190,8 +201,10 @@ void parse_ha_bt_serial(DataStruct* data, ReqModel* ha_model) {
 
     snprintf(temp_str, sizeof(temp_str), "%u", data->co2);
     furi_string_set_str(ha_model->print_co2, temp_str);
+    ha_snapshot_set_float(&ha_model->snapshot, HaEntityCo2, data->co2);
     snprintf(temp_str, sizeof(temp_str), "%u", data->pm2_5);
     furi_string_set_str(ha_model->print_pm2_5, temp_str);
+    ha_snapshot_set_float(&ha_model->snapshot, HaEntityPm2_5, data->pm2_5);
 }
 
 void ha_init_ble(App* app) {
@@ -210,6 +223,10 @@ void ha_init_ble(App* app) {
     }
 
     pretty_print_mac(ha_model->ble->mac_address_str, ha_model->ble->config.address);
+    beacon_packet_build(ha_model->ble);
+    // Events left from the previous visit are stale, the worker isn't running yet
+    spsc_queue_reset(ha_model->ble->events);
+    ha_model->ble->status = BEACON_INACTIVE;
     // The beacon expects the MAC address in reverse order
     futils_reverse_array_uint8(ha_model->ble->config.address, EXTRA_BEACON_MAC_ADDR_SIZE);
     ha_model->ble->timer_reset_beacon =
@@ -229,5 +246,6 @@ void ha_deinit_ble(App* app) {
         furi_thread_flags_set(app->comm_thread_id, ThreadCommStop);
         furi_thread_join(app->comm_thread);
         furi_thread_free(app->comm_thread);
+        app->comm_thread = NULL;
     }
 }
@@ -0,0 +1,317 @@
+#include "ha_history.h"
+
+/**
+ * @brief      Store a sample at idx as the difference from the previous one.
+ * @details    Jumps too big for a delta are stored whole in the escapes table. If that is
+ *             full they are clamped and spread over the next samples, the encoder tracks the
+ *             reconstructed value so the error never accumulates.
+ * @return     the value that will be read back
+*/
+static int16_t ha_history_encode(
+    HaHistory* history,
+    HaEntity entity,
+    size_t idx,
+    int16_t prev,
+    int16_t value) {
+    int32_t delta = (int32_t)value - prev;
+    if(delta >= -HA_HISTORY_DELTA_MAX && delta <= HA_HISTORY_DELTA_MAX) {
+        history->deltas[entity][idx] = delta;
+        return value;
+    }
+    if(history->escape_count[entity] < HA_HISTORY_ESCAPES) {
+        const size_t pos = (history->escape_head[entity] + history->escape_count[entity]) %
+                           HA_HISTORY_ESCAPES;
+        history->escapes[entity][pos] = value;
+        history->escape_count[entity]++;
+        history->deltas[entity][idx] = HA_HISTORY_ESCAPE;
+        return value;
+    }
+    history->clamped++;
+    delta = delta > 0 ? HA_HISTORY_DELTA_MAX : -HA_HISTORY_DELTA_MAX;
+    history->deltas[entity][idx] = delta;
+    return prev + delta;
+}
+
+/**
+ * @brief      Value of the sample after one, reading the escapes table in order.
+ * @param      escape  escapes read so far in this scan, starts at 0 from the tail
+*/
+static int16_t ha_history_decode(
+    const HaHistory* history,
+    HaEntity entity,
+    size_t idx,
+    int16_t prev,
+    uint8_t* escape) {
+    const int8_t delta = history->deltas[entity][idx];
+    if(delta != HA_HISTORY_ESCAPE) {
+        return prev + delta;
+    }
+    const size_t pos = (history->escape_head[entity] + (*escape)++) % HA_HISTORY_ESCAPES;
+    return history->escapes[entity][pos];
+}
+
+/**
+ * @brief      Index of the i-th oldest sample of an entity in the ring.
+*/
+static size_t ha_history_index(const HaHistory* history, HaEntity entity, size_t i) {
+    return (history->head_idx + HA_HISTORY_SAMPLES - (history->count[entity] - 1) + i) %
+           HA_HISTORY_SAMPLES;
+}
+
+/**
+ * @brief      Append a sample at head_idx, evicting the oldest one if the ring is full.
+*/
+static void ha_history_append(HaHistory* history, HaEntity entity, int16_t value) {
+    if(history->count[entity] == 0) {
+        history->head[entity] = value;
+        history->tail[entity] = value;
+        history->deltas[entity][history->head_idx] = 0;
+        history->count[entity] = 1;
+        return;
+    }
+
+    if(history->count[entity] == HA_HISTORY_SAMPLES) {
+        // head_idx now points to the oldest sample, the next one becomes the tail
+        const size_t next = (history->head_idx + 1) % HA_HISTORY_SAMPLES;
+        uint8_t escape = 0;
+        history->tail[entity] =
+            ha_history_decode(history, entity, next, history->tail[entity], &escape);
+        // The tail is kept whole, its escape isn't needed anymore
+        if(escape > 0) {
+            history->escape_head[entity] =
+                (history->escape_head[entity] + 1) % HA_HISTORY_ESCAPES;
+            history->escape_count[entity]--;
+        }
+    } else {
+        history->count[entity]++;
+    }
+    history->prev[entity] = history->head[entity];
+    history->head[entity] =
+        ha_history_encode(history, entity, history->head_idx, history->head[entity], value);
+}
+
+/**
+ * @brief      Overwrite the newest sample, used when more updates land in the same slot.
+*/
+static void ha_history_replace(HaHistory* history, HaEntity entity, int16_t value) {
+    if(history->count[entity] == 0) {
+        ha_history_append(history, entity, value);
+    } else if(history->count[entity] == 1) {
+        history->head[entity] = value;
+        history->tail[entity] = value;
+    } else {
+        // The newest sample is the last escape, if it is one
+        const int8_t delta = history->deltas[entity][history->head_idx];
+        if(delta == HA_HISTORY_ESCAPE) {
+            history->escape_count[entity]--;
+        }
+        history->head[entity] = ha_history_encode(
+            history, entity, history->head_idx, history->prev[entity], value);
+    }
+}
+
+/**
+ * @brief      Allocate the sensor history.
+ * @param      resolution_s  seconds covered by each sample
+ * @return     HaHistory object.
+*/
+HaHistory* ha_history_alloc(uint16_t resolution_s) {
+    HaHistory* history = malloc(sizeof(HaHistory));
+    ha_history_reset(history, resolution_s);
+    return history;
+}
+
+void ha_history_free(HaHistory* history) {
+    free(history);
+}
+
+/**
+ * @brief      Drop all the samples and set a new resolution.
+ * @param      history       the HaHistory object
+ * @param      resolution_s  seconds covered by each sample
+*/
+void ha_history_reset(HaHistory* history, uint16_t resolution_s) {
+    memset(history, 0, sizeof(HaHistory));
+    history->resolution_s = resolution_s > 0 ? resolution_s : 1;
+}
+
+/**
+ * @brief      Add the values of a snapshot to the history.
+ * @details    Updates landing in the same slot overwrite the newest sample, skipped slots
+ *             repeat the last known value so the time axis stays consistent.
+ * @param      history   the HaHistory object
+ * @param      snapshot  the last decoded values
+*/
+void ha_history_push(HaHistory* history, const HaSnapshot* snapshot) {
+    uint32_t slot = snapshot->timestamp / history->resolution_s;
+    // last_slot is zero only before the first sample
+    uint32_t steps = 1;
+    if(history->last_slot != 0) {
+        if(slot == history->last_slot) {
+            steps = 0;
+        } else if(slot > history->last_slot) {
+            steps = slot - history->last_slot;
+        }
+    }
+
+    if(steps == 0) {
+        for(size_t e = 0; e < HaEntityCount; e++) {
+            if(snapshot->valid & (1 << e)) {
+                ha_history_replace(history, e, snapshot->values[e]);
+            }
+        }
+        return;
+    }
+
+    if(steps > HA_HISTORY_SAMPLES) {
+        steps = HA_HISTORY_SAMPLES;
+    }
+
+    for(size_t s = 0; s < steps; s++) {
+        // The very first sample goes at index 0
+        if(history->last_slot != 0 || s > 0) {
+            history->head_idx = (history->head_idx + 1) % HA_HISTORY_SAMPLES;
+        }
+        const bool last_step = (s == steps - 1);
+        for(size_t e = 0; e < HaEntityCount; e++) {
+            if(last_step && (snapshot->valid & (1 << e))) {
+                ha_history_append(history, e, snapshot->values[e]);
+            } else if(history->count[e] > 0) {
+                ha_history_append(history, e, history->head[e]);
+            }
+        }
+    }
+    history->last_slot = slot;
+}
+
+/**
+ * @brief      Scan the samples of an entity for min, max and last value.
+ * @param      history   the HaHistory object
+ * @param      entity    the entity to scan
+ * @param      stats     filled with the result
+ * @return     false if there are no samples for the entity
+*/
+bool ha_history_stats(const HaHistory* history, HaEntity entity, HaHistoryStats* stats) {
+    stats->count = history->count[entity];
+    if(stats->count == 0) {
+        return false;
+    }
+
+    int16_t value = history->tail[entity];
+    uint8_t escape = 0;
+    stats->min = value;
+    stats->max = value;
+    for(size_t i = 1; i < stats->count; i++) {
+        value = ha_history_decode(
+            history, entity, ha_history_index(history, entity, i), value, &escape);
+        if(value < stats->min) {
+            stats->min = value;
+        } else if(value > stats->max) {
+            stats->max = value;
+        }
+    }
+    stats->last = value;
+
+    return true;
+}
+
+/**
+ * @brief      Draw the samples of an entity as a line scaled to the min/max range.
+ * @param      canvas   the Canvas to draw on
+ * @param      history  the HaHistory object
+ * @param      entity   the entity to draw
+ * @param      stats    the result of ha_history_stats for the same entity
+ * @param      x, y     top left corner of the drawing area
+ * @param      width, height  size of the drawing area
+*/
+void ha_history_draw_sparkline(
+    Canvas* canvas,
+    const HaHistory* history,
+    HaEntity entity,
+    const HaHistoryStats* stats,
+    int32_t x,
+    int32_t y,
+    size_t width,
+    size_t height) {
+    if(stats->count == 0 || width < 2 || height < 2) {
+        return;
+    }
+
+    const int32_t range = stats->max - stats->min;
+    const int32_t samples = stats->count > 1 ? stats->count - 1 : 1;
+    int16_t value = history->tail[entity];
+    uint8_t escape = 0;
+    int32_t prev_x = x;
+    int32_t prev_y = range ? y + (int32_t)(height - 1) -
+                                 (value - stats->min) * (int32_t)(height - 1) / range :
+                             y + (int32_t)height / 2;
+
+    for(size_t i = 1; i < stats->count; i++) {
+        value = ha_history_decode(
+            history, entity, ha_history_index(history, entity, i), value, &escape);
+        int32_t curr_x = x + (int32_t)i * (int32_t)(width - 1) / samples;
+        int32_t curr_y = range ? y + (int32_t)(height - 1) -
+                                     (value - stats->min) * (int32_t)(height - 1) / range :
+                                 y + (int32_t)height / 2;
+        canvas_draw_line(canvas, prev_x, prev_y, curr_x, curr_y);
+        prev_x = curr_x;
+        prev_y = curr_y;
+    }
+
+    if(stats->count == 1) {
+        canvas_draw_dot(canvas, prev_x, prev_y);
+    }
+}
+
+/**
+ * @brief      Draw an array of values as a line scaled to their min/max range.
+ * @param      canvas   the Canvas to draw on
+ * @param      points   the values to draw
+ * @param      count    the number of values
+ * @param      stats    filled with min, max and last value of the points
+ * @param      x, y     top left corner of the drawing area
+ * @param      width, height  size of the drawing area
+*/
+void ha_history_draw_points(
+    Canvas* canvas,
+    const int16_t* points,
+    size_t count,
+    HaHistoryStats* stats,
+    int32_t x,
+    int32_t y,
+    size_t width,
+    size_t height) {
+    stats->count = count;
+    if(count == 0 || width < 2 || height < 2) {
+        return;
+    }
+
+    stats->min = points[0];
+    stats->max = points[0];
+    for(size_t i = 1; i < count; i++) {
+        if(points[i] < stats->min) {
+            stats->min = points[i];
+        } else if(points[i] > stats->max) {
+            stats->max = points[i];
+        }
+    }
+    stats->last = points[count - 1];
+
+    const int32_t range = stats->max - stats->min;
+    const int32_t samples = count > 1 ? count - 1 : 1;
+    int32_t prev_x = x;
+    int32_t prev_y = 0;
+    for(size_t i = 0; i < count; i++) {
+        int32_t curr_x = x + (int32_t)i * (int32_t)(width - 1) / samples;
+        int32_t curr_y = range ? y + (int32_t)(height - 1) -
+                                     (points[i] - stats->min) * (int32_t)(height - 1) / range :
+                                 y + (int32_t)height / 2;
+        if(i == 0) {
+            canvas_draw_dot(canvas, curr_x, curr_y);
+        } else {
+            canvas_draw_line(canvas, prev_x, prev_y, curr_x, curr_y);
+        }
+        prev_x = curr_x;
+        prev_y = curr_y;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "app.h"
+
+#define HA_HISTORY_SAMPLES   288U
+#define HA_HISTORY_DELTA_MAX 127
+// A delta with this value means the sample is the next one in the escapes table
+#define HA_HISTORY_ESCAPE  INT8_MIN
+#define HA_HISTORY_ESCAPES 16U
+
+struct HaHistory {
+    // Absolute value of the newest and oldest sample of each entity
+    int16_t head[HaEntityCount];
+    int16_t tail[HaEntityCount];
+    // Sample before the newest, the base of its delta when more updates land in its slot
+    int16_t prev[HaEntityCount];
+    // Number of samples held for each entity, an entity can start later than the ring
+    uint16_t count[HaEntityCount];
+    // Each sample is stored as the difference from the previous one
+    int8_t deltas[HaEntityCount][HA_HISTORY_SAMPLES];
+    // Absolute value of the samples too far from the previous one, oldest first
+    int16_t escapes[HaEntityCount][HA_HISTORY_ESCAPES];
+    uint8_t escape_head[HaEntityCount];
+    uint8_t escape_count[HaEntityCount];
+    uint32_t clamped; // Jumps smeared over the next samples, the escapes table was full
+    uint16_t head_idx;
+    uint32_t last_slot;
+    uint16_t resolution_s;
+};
+
+typedef struct {
+    int16_t min;
+    int16_t max;
+    int16_t last;
+    uint16_t count;
+} HaHistoryStats;
+
+HaHistory* ha_history_alloc(uint16_t resolution_s);
+void ha_history_free(HaHistory* history);
+void ha_history_reset(HaHistory* history, uint16_t resolution_s);
+void ha_history_push(HaHistory* history, const HaSnapshot* snapshot);
+bool ha_history_stats(const HaHistory* history, HaEntity entity, HaHistoryStats* stats);
+void ha_history_draw_sparkline(
+    Canvas* canvas,
+    const HaHistory* history,
+    HaEntity entity,
+    const HaHistoryStats* stats,
+    int32_t x,
+    int32_t y,
+    size_t width,
+    size_t height);
+void ha_history_draw_points(
+    Canvas* canvas,
+    const int16_t* points,
+    size_t count,
+    HaHistoryStats* stats,
+    int32_t x,
+    int32_t y,
+    size_t width,
+    size_t height);
@@ -0,0 +1,161 @@
+#include "ha_poll.h"
+#include <input/input.h>
+
+/**
+ * @brief      Longest period the scheduler backs off to.
+*/
+static uint32_t ha_poll_max_period(uint32_t min_period_ms) {
+    uint32_t max_period_ms = min_period_ms << HA_POLL_BACKOFF_MAX_SHIFT;
+    if(max_period_ms > HA_POLL_MAX_PERIOD_MS) {
+        max_period_ms = HA_POLL_MAX_PERIOD_MS;
+    }
+    return max_period_ms > min_period_ms ? max_period_ms : min_period_ms;
+}
+
+/**
+ * @brief      Go back to the configured rate for a few requests.
+*/
+static void ha_poll_set_fast(HaPoll* poll, uint32_t min_period_ms) {
+    poll->mode = HaPollFast;
+    poll->period_ms = min_period_ms;
+    poll->fast_left = HA_POLL_FAST_COUNT;
+}
+
+/**
+ * @brief      Note the time of every key press, called by the input service.
+*/
+static void ha_poll_input_callback(const void* message, void* context) {
+    UNUSED(message);
+    HaPoll* poll = context;
+    poll->input_tick = furi_get_tick();
+}
+
+/**
+ * @brief      Start the scheduler, the first request is sent by the caller right away.
+ * @details    Watches the key presses until ha_poll_stop, to pause while the screen is off.
+ * @param      poll           the HaPoll object
+ * @param      min_period_ms  the configured polling rate
+*/
+void ha_poll_reset(HaPoll* poll, uint32_t min_period_ms) {
+    FuriPubSub* input_events = poll->input_events;
+    FuriPubSubSubscription* input_sub = poll->input_sub;
+    memset(poll, 0, sizeof(HaPoll));
+    if(input_sub == NULL) {
+        input_events = furi_record_open(RECORD_INPUT_EVENTS);
+        input_sub = furi_pubsub_subscribe(input_events, ha_poll_input_callback, poll);
+    }
+    poll->input_events = input_events;
+    poll->input_sub = input_sub;
+    ha_poll_set_fast(poll, min_period_ms);
+    poll->last_req_tick = furi_get_tick();
+    poll->input_tick = poll->last_req_tick;
+    poll->hour_start_tick = poll->last_req_tick;
+    poll->fast_left--;
+    poll->requests[HaPollFast] = 1;
+    poll->ticks = 1;
+}
+
+/**
+ * @brief      Called at the configured rate, decides if a request is due.
+ * @details    The period is always a multiple of the configured one, half a period of
+ *             tolerance absorbs the timer jitter. Turning the screen back on sends a
+ *             request right away.
+ * @param      poll           the HaPoll object
+ * @param      min_period_ms  the configured polling rate
+ * @param      screen_on      false when the backlight is off
+ * @return     true if a request must be sent
+*/
+bool ha_poll_tick(HaPoll* poll, uint32_t min_period_ms, bool screen_on) {
+    const uint32_t now = furi_get_tick();
+    poll->ticks++;
+    if(now - poll->hour_start_tick >= furi_ms_to_ticks(HA_POLL_STATS_PERIOD_MS)) {
+        ha_poll_log(poll);
+        memset(poll->requests, 0, sizeof(poll->requests));
+        poll->ticks = 0;
+        poll->hour_start_tick = now;
+    }
+
+    if(!screen_on) {
+        poll->mode = HaPollPaused;
+        return false;
+    }
+    if(poll->mode == HaPollPaused) {
+        ha_poll_set_fast(poll, min_period_ms);
+    } else if(
+        now - poll->last_req_tick + furi_ms_to_ticks(min_period_ms) / 2 <
+        furi_ms_to_ticks(poll->period_ms)) {
+        return false;
+    }
+
+    poll->last_req_tick = now;
+    poll->requests[poll->mode]++;
+    if(poll->fast_left > 0) {
+        poll->fast_left--;
+    }
+    return true;
+}
+
+/**
+ * @brief      Adapt the period to the last response.
+ * @param      poll           the HaPoll object
+ * @param      min_period_ms  the configured polling rate
+ * @param      changed        true if any value differs from the previous response
+*/
+void ha_poll_on_data(HaPoll* poll, uint32_t min_period_ms, bool changed) {
+    if(poll->mode == HaPollPaused) {
+        return;
+    }
+    if(changed) {
+        ha_poll_set_fast(poll, min_period_ms);
+    } else if(poll->fast_left == 0) {
+        const uint32_t max_period_ms = ha_poll_max_period(min_period_ms);
+        poll->mode = HaPollBackoff;
+        poll->period_ms = poll->period_ms * 2 < max_period_ms ? poll->period_ms * 2 :
+                                                                 max_period_ms;
+    }
+}
+
+/**
+ * @brief      Poll at the configured rate after a command, to show its effect quickly.
+ * @param      poll           the HaPoll object
+ * @param      min_period_ms  the configured polling rate
+*/
+void ha_poll_kick(HaPoll* poll, uint32_t min_period_ms) {
+    if(poll->mode != HaPollPaused) {
+        ha_poll_set_fast(poll, min_period_ms);
+    }
+}
+
+/**
+ * @brief      Stop watching the key presses.
+ * @param      poll  the HaPoll object
+*/
+void ha_poll_stop(HaPoll* poll) {
+    if(poll->input_sub) {
+        furi_pubsub_unsubscribe(poll->input_events, poll->input_sub);
+        furi_record_close(RECORD_INPUT_EVENTS);
+        poll->input_sub = NULL;
+        poll->input_events = NULL;
+    }
+}
+
+void ha_poll_log(HaPoll* poll) {
+    FURI_LOG_I(
+        POLL_TAG,
+        "Requests in %lus: fast %lu, backoff %lu, fixed period would be %lu",
+        (furi_get_tick() - poll->hour_start_tick) / furi_kernel_get_tick_frequency(),
+        poll->requests[HaPollFast],
+        poll->requests[HaPollBackoff],
+        poll->ticks);
+}
+
+/**
+ * @brief      Guess the backlight from the last key press.
+ * @details    The backlight state isn't public, a longer backlight time set by the user
+ *             pauses the polling while the screen is still on, until the next key press.
+ * @param      poll  the HaPoll object
+ * @return     true if the screen is likely on
+*/
+bool ha_poll_screen_on(const HaPoll* poll) {
+    return furi_get_tick() - poll->input_tick < furi_ms_to_ticks(HA_POLL_SCREEN_TIMEOUT_MS);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "app.h"
+
+#define POLL_TAG "HA_POLL"
+
+#define HA_POLL_FAST_COUNT         3U
+#define HA_POLL_BACKOFF_MAX_SHIFT  5U
+#define HA_POLL_MAX_PERIOD_MS      60000U
+#define HA_POLL_STATS_PERIOD_MS    (60U * 60U * 1000U)
+// Default backlight time of the firmware, the screen is taken as off after it
+#define HA_POLL_SCREEN_TIMEOUT_MS  30000U
+
+void ha_poll_reset(HaPoll* poll, uint32_t min_period_ms);
+bool ha_poll_tick(HaPoll* poll, uint32_t min_period_ms, bool screen_on);
+void ha_poll_on_data(HaPoll* poll, uint32_t min_period_ms, bool changed);
+void ha_poll_kick(HaPoll* poll, uint32_t min_period_ms);
+void ha_poll_stop(HaPoll* poll);
+void ha_poll_log(HaPoll* poll);
+bool ha_poll_screen_on(const HaPoll* poll);
@@ -0,0 +1,76 @@
+#include "ha_snapshot.h"
+#include <math.h>
+
+// Fixed point multiplier used to store each entity value in a HaSnapshot
+const uint8_t ha_entity_scale[HaEntityCount] = {10, 10, 10, 10, 10, 10, 1, 1};
+
+/**
+ * @brief      Store a float value in the snapshot as fixed point.
+ * @param      snapshot  the HaSnapshot to update
+ * @param      entity    the entity the value belongs to
+ * @param      value     the value to store
+*/
+void ha_snapshot_set_float(HaSnapshot* snapshot, HaEntity entity, float_t value) {
+    float_t scaled = value * ha_entity_scale[entity];
+    if(scaled > INT16_MAX) {
+        scaled = INT16_MAX;
+    } else if(scaled < INT16_MIN) {
+        scaled = INT16_MIN;
+    }
+    snapshot->values[entity] = (int16_t)lroundf(scaled);
+    snapshot->valid |= 1 << entity;
+}
+
+/**
+ * @brief      Parse a value string and store it in the snapshot as fixed point.
+ * @details    Strings that don't start with a number are ignored.
+ * @param      snapshot  the HaSnapshot to update
+ * @param      entity    the entity the value belongs to
+ * @param      value     the value string
+*/
+void ha_snapshot_set_str(HaSnapshot* snapshot, HaEntity entity, const char* value) {
+    char* end;
+    float_t parsed = strtof(value, &end);
+    if(end != value) {
+        ha_snapshot_set_float(snapshot, entity, parsed);
+    }
+}
+
+/**
+ * @brief      Format a fixed point value of an entity.
+ * @param      buffer  the output buffer
+ * @param      size    the output buffer size
+ * @param      entity  the entity the value belongs to
+ * @param      value   the fixed point value
+*/
+void ha_entity_format(char* buffer, size_t size, HaEntity entity, int16_t value) {
+    const uint8_t scale = ha_entity_scale[entity];
+    if(scale == 1) {
+        snprintf(buffer, size, "%d", value);
+    } else {
+        int32_t abs_value = value < 0 ? -(int32_t)value : value;
+        snprintf(
+            buffer,
+            size,
+            "%s%ld.%ld",
+            value < 0 ? "-" : "",
+            abs_value / scale,
+            abs_value % scale);
+    }
+}
+
+/**
+ * @brief      Copy the valid values of an update over a snapshot.
+ * @param      snapshot  the HaSnapshot to update
+ * @param      update    the new values, only the ones flagged in valid are copied
+*/
+void ha_snapshot_merge(HaSnapshot* snapshot, const HaSnapshot* update) {
+    for(size_t e = 0; e < HaEntityCount; e++) {
+        if(update->valid & (1 << e)) {
+            snapshot->values[e] = update->values[e];
+        }
+    }
+    snapshot->valid |= update->valid;
+    snapshot->dehum_sts = update->dehum_sts;
+    snapshot->dehum_aut_sts = update->dehum_aut_sts;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include "app.h"
+
+extern const uint8_t ha_entity_scale[HaEntityCount];
+
+void ha_snapshot_set_str(HaSnapshot* snapshot, HaEntity entity, const char* value);
+void ha_snapshot_set_float(HaSnapshot* snapshot, HaEntity entity, float_t value);
+void ha_entity_format(char* buffer, size_t size, HaEntity entity, int16_t value);
+void ha_snapshot_merge(HaSnapshot* snapshot, const HaSnapshot* update);
@@ -0,0 +1,491 @@
+#include "ha_telemetry.h"
+
+/**
+ * @brief      Number of records in the log, both on SD and still buffered.
+*/
+static uint32_t ha_telemetry_records(HaTelemetry* telemetry) {
+    return telemetry->sector_first + telemetry->sector_len;
+}
+
+/**
+ * @brief      Read a record from the sector buffer or from the log file.
+ * @details    Must be called with the mutex held.
+*/
+static bool
+    ha_telemetry_read_locked(HaTelemetry* telemetry, uint32_t record, HaTelemetryRecord* out) {
+    if(record >= ha_telemetry_records(telemetry)) {
+        return false;
+    }
+    if(record >= telemetry->sector_first) {
+        memcpy(out, &telemetry->sector[record - telemetry->sector_first], sizeof(*out));
+        return true;
+    }
+
+    return storage_file_seek(telemetry->log_file, record * sizeof(*out), true) &&
+           storage_file_read(telemetry->log_file, out, sizeof(*out)) == sizeof(*out);
+}
+
+/**
+ * @brief      Read an index entry, the sector being filled counts as the last one.
+ * @details    Must be called with the mutex held.
+*/
+static bool ha_telemetry_index_get(
+    HaTelemetry* telemetry,
+    uint32_t entry_no,
+    HaTelemetryIndexEntry* entry) {
+    if(entry_no < telemetry->index_len) {
+        return storage_file_seek(telemetry->idx_file, entry_no * sizeof(*entry), true) &&
+               storage_file_read(telemetry->idx_file, entry, sizeof(*entry)) == sizeof(*entry);
+    }
+    if(entry_no == telemetry->index_len && telemetry->sector_len > 0 &&
+       telemetry->sector_first / HA_TELEMETRY_RECORDS_PER_SECTOR == entry_no) {
+        entry->timestamp = telemetry->sector[0].timestamp;
+        entry->record = telemetry->sector_first;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief      Append the index entry of a sector if it's not there yet.
+ * @details    Must be called with the mutex held.
+*/
+static void ha_telemetry_index_add(HaTelemetry* telemetry, uint32_t record, uint32_t timestamp) {
+    if(record / HA_TELEMETRY_RECORDS_PER_SECTOR != telemetry->index_len) {
+        return;
+    }
+    HaTelemetryIndexEntry entry = {.timestamp = timestamp, .record = record};
+    if(storage_file_seek(telemetry->idx_file, telemetry->index_len * sizeof(entry), true) &&
+       storage_file_write(telemetry->idx_file, &entry, sizeof(entry)) == sizeof(entry)) {
+        telemetry->index_len++;
+    } else {
+        FURI_LOG_E(TELEMETRY_TAG, "Failed to write index entry %lu", telemetry->index_len);
+    }
+}
+
+/**
+ * @brief      Write the sector buffer to the log, starting a new one when it's full.
+ * @details    Must be called with the mutex held. The sector is always written from its
+ *             start, so a partial sector flushed on exit is completed on the next run.
+*/
+static void ha_telemetry_flush_locked(HaTelemetry* telemetry) {
+    if(telemetry->sector_len == 0) {
+        return;
+    }
+
+    const uint32_t start = furi_get_tick();
+    const size_t size = telemetry->sector_len * sizeof(HaTelemetryRecord);
+    if(storage_file_seek(
+           telemetry->log_file, telemetry->sector_first * sizeof(HaTelemetryRecord), true) &&
+       storage_file_write(telemetry->log_file, telemetry->sector, size) == size) {
+        ha_telemetry_index_add(
+            telemetry, telemetry->sector_first, telemetry->sector[0].timestamp);
+        telemetry->bytes_written += size;
+    } else {
+        FURI_LOG_E(TELEMETRY_TAG, "Failed to write sector at %lu", telemetry->sector_first);
+    }
+    telemetry->write_ticks += furi_get_tick() - start;
+
+    if(telemetry->sector_len == HA_TELEMETRY_RECORDS_PER_SECTOR) {
+        telemetry->sector_first += telemetry->sector_len;
+        telemetry->sector_len = 0;
+    }
+}
+
+/**
+ * @brief      Open the log and index, reload the last partial sector and rebuild
+ *             missing index entries after an unclean exit.
+*/
+static void ha_telemetry_open(HaTelemetry* telemetry) {
+    furi_check(furi_mutex_acquire(telemetry->mutex, FuriWaitForever) == FuriStatusOk);
+    telemetry->storage = furi_record_open(RECORD_STORAGE);
+    telemetry->log_file = storage_file_alloc(telemetry->storage);
+    telemetry->idx_file = storage_file_alloc(telemetry->storage);
+
+    if(!storage_file_open(
+           telemetry->log_file, HA_TELEMETRY_LOG_PATH, FSAM_READ_WRITE, FSOM_OPEN_ALWAYS) ||
+       !storage_file_open(
+           telemetry->idx_file, HA_TELEMETRY_IDX_PATH, FSAM_READ_WRITE, FSOM_OPEN_ALWAYS)) {
+        FURI_LOG_E(TELEMETRY_TAG, "Failed to open telemetry log");
+    }
+
+    const uint32_t records = storage_file_size(telemetry->log_file) / sizeof(HaTelemetryRecord);
+    telemetry->sector_len = records % HA_TELEMETRY_RECORDS_PER_SECTOR;
+    telemetry->sector_first = records - telemetry->sector_len;
+    if(telemetry->sector_len > 0) {
+        const size_t size = telemetry->sector_len * sizeof(HaTelemetryRecord);
+        if(!storage_file_seek(
+               telemetry->log_file, telemetry->sector_first * sizeof(HaTelemetryRecord), true) ||
+           storage_file_read(telemetry->log_file, telemetry->sector, size) != size) {
+            FURI_LOG_E(TELEMETRY_TAG, "Failed to reload last sector, dropping it");
+            telemetry->sector_len = 0;
+        }
+    }
+
+    const uint32_t sectors =
+        (ha_telemetry_records(telemetry) + HA_TELEMETRY_RECORDS_PER_SECTOR - 1) /
+        HA_TELEMETRY_RECORDS_PER_SECTOR;
+    telemetry->index_len = storage_file_size(telemetry->idx_file) / sizeof(HaTelemetryIndexEntry);
+    if(telemetry->index_len > sectors) {
+        telemetry->index_len = sectors;
+        storage_file_seek(
+            telemetry->idx_file, telemetry->index_len * sizeof(HaTelemetryIndexEntry), true);
+        storage_file_truncate(telemetry->idx_file);
+    }
+    HaTelemetryRecord record;
+    while(telemetry->index_len < sectors) {
+        const uint32_t first = telemetry->index_len * HA_TELEMETRY_RECORDS_PER_SECTOR;
+        if(!ha_telemetry_read_locked(telemetry, first, &record)) {
+            break;
+        }
+        ha_telemetry_index_add(telemetry, first, record.timestamp);
+    }
+
+    if(ha_telemetry_records(telemetry) > 0 &&
+       ha_telemetry_read_locked(telemetry, ha_telemetry_records(telemetry) - 1, &record)) {
+        // Unless a record was queued meanwhile, it's newer than the log
+        uint32_t expected = 0;
+        __atomic_compare_exchange_n(
+            &telemetry->last_timestamp,
+            &expected,
+            record.timestamp,
+            false,
+            __ATOMIC_RELAXED,
+            __ATOMIC_RELAXED);
+    }
+    FURI_LOG_I(
+        TELEMETRY_TAG,
+        "Log opened: %lu records, %lu index entries",
+        ha_telemetry_records(telemetry),
+        telemetry->index_len);
+    furi_check(furi_mutex_release(telemetry->mutex) == FuriStatusOk);
+    furi_event_flag_set(telemetry->opened, HA_TELEMETRY_OPENED);
+}
+
+static void ha_telemetry_close(HaTelemetry* telemetry) {
+    furi_check(furi_mutex_acquire(telemetry->mutex, FuriWaitForever) == FuriStatusOk);
+    ha_telemetry_flush_locked(telemetry);
+    storage_file_close(telemetry->log_file);
+    storage_file_close(telemetry->idx_file);
+    storage_file_free(telemetry->log_file);
+    storage_file_free(telemetry->idx_file);
+    furi_record_close(RECORD_STORAGE);
+    FURI_LOG_I(
+        TELEMETRY_TAG,
+        "Log closed: %lu bytes written in %lu ms, %lu records dropped",
+        telemetry->bytes_written,
+        telemetry->write_ticks,
+        telemetry->dropped);
+    furi_check(furi_mutex_release(telemetry->mutex) == FuriStatusOk);
+}
+
+/**
+ * @brief      First record with a timestamp equal or after the given one.
+ * @details    Must be called with the mutex held. Binary search on the sparse index,
+ *             then on the records of a single sector.
+*/
+static uint32_t ha_telemetry_seek_locked(HaTelemetry* telemetry, uint32_t timestamp) {
+    HaTelemetryIndexEntry entry;
+    uint32_t entries = telemetry->index_len;
+    if(ha_telemetry_index_get(telemetry, entries, &entry)) {
+        entries++;
+    }
+
+    // First sector starting after the timestamp
+    uint32_t lo = 0;
+    uint32_t hi = entries;
+    while(lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if(!ha_telemetry_index_get(telemetry, mid, &entry)) {
+            break;
+        }
+        if(entry.timestamp <= timestamp) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if(lo == 0) {
+        return 0;
+    }
+
+    // The record is in the previous sector or is the first one of the next
+    HaTelemetryRecord record;
+    uint32_t first = (lo - 1) * HA_TELEMETRY_RECORDS_PER_SECTOR;
+    uint32_t last = first + HA_TELEMETRY_RECORDS_PER_SECTOR;
+    if(last > ha_telemetry_records(telemetry)) {
+        last = ha_telemetry_records(telemetry);
+    }
+    while(first < last) {
+        uint32_t mid = first + (last - first) / 2;
+        if(!ha_telemetry_read_locked(telemetry, mid, &record)) {
+            break;
+        }
+        if(record.timestamp < timestamp) {
+            first = mid + 1;
+        } else {
+            last = mid;
+        }
+    }
+
+    return first;
+}
+
+/**
+ * @brief      Sample the values of an entity between two timestamps.
+ * @details    Records have a fixed size, so after seeking the two ends every point is a
+ *             direct read.
+*/
+static void ha_telemetry_load_window(HaTelemetry* telemetry) {
+    const uint32_t start_tick = furi_get_tick();
+    furi_check(furi_mutex_acquire(telemetry->mutex, FuriWaitForever) == FuriStatusOk);
+    HaTelemetryWindow* window = &telemetry->window;
+    const uint32_t first = ha_telemetry_seek_locked(telemetry, window->start);
+    const uint32_t last = ha_telemetry_seek_locked(telemetry, window->end);
+    const uint32_t records = last > first ? last - first : 0;
+    const uint32_t points = records < HA_TELEMETRY_WINDOW_POINTS ? records :
+                                                                   HA_TELEMETRY_WINDOW_POINTS;
+
+    HaTelemetryRecord record;
+    window->count = 0;
+    for(uint32_t i = 0; i < points; i++) {
+        if(ha_telemetry_read_locked(telemetry, first + i * records / points, &record) &&
+           (record.valid & (1 << window->entity))) {
+            window->points[window->count++] = record.values[window->entity];
+        }
+    }
+    window->ready = true;
+    furi_check(furi_mutex_release(telemetry->mutex) == FuriStatusOk);
+    FURI_LOG_I(
+        TELEMETRY_TAG,
+        "Window loaded: %u points from %lu records in %lu ms",
+        window->count,
+        records,
+        furi_get_tick() - start_tick);
+}
+
+/**
+ * @brief      Add the queued records to the sector buffer, writing each full sector.
+*/
+static void ha_telemetry_drain(HaTelemetry* telemetry) {
+    HaTelemetryRecord record;
+    while(furi_message_queue_get(telemetry->queue, &record, 0) == FuriStatusOk) {
+        furi_check(furi_mutex_acquire(telemetry->mutex, FuriWaitForever) == FuriStatusOk);
+        memcpy(&telemetry->sector[telemetry->sector_len++], &record, sizeof(record));
+        if(telemetry->sector_len == HA_TELEMETRY_RECORDS_PER_SECTOR) {
+            ha_telemetry_flush_locked(telemetry);
+        }
+        furi_check(furi_mutex_release(telemetry->mutex) == FuriStatusOk);
+    }
+}
+
+/**
+ * @brief      Telemetry writer thread
+ * @param      context HaTelemetry pointer
+*/
+static int32_t ha_telemetry_worker(void* context) {
+    HaTelemetry* telemetry = context;
+    ha_telemetry_open(telemetry);
+
+    bool run = true;
+    while(run) {
+        uint32_t events = furi_thread_flags_wait(
+            ThreadCommStop | ThreadCommUpdData | ThreadCommLoadLog,
+            FuriFlagWaitAny,
+            FuriWaitForever);
+        if(events & ThreadCommUpdData) {
+            ha_telemetry_drain(telemetry);
+        }
+        if(events & ThreadCommLoadLog) {
+            ha_telemetry_load_window(telemetry);
+        }
+        if(events & ThreadCommStop) {
+            ha_telemetry_drain(telemetry);
+            run = false;
+        }
+    }
+
+    ha_telemetry_close(telemetry);
+    return 0;
+}
+
+/**
+ * @brief      Allocate the telemetry log and start the writer thread.
+ * @return     HaTelemetry object.
+*/
+HaTelemetry* ha_telemetry_alloc() {
+    HaTelemetry* telemetry = malloc(sizeof(HaTelemetry));
+    memset(telemetry, 0, sizeof(HaTelemetry));
+    telemetry->queue =
+        furi_message_queue_alloc(HA_TELEMETRY_QUEUE_SIZE, sizeof(HaTelemetryRecord));
+    telemetry->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    telemetry->opened = furi_event_flag_alloc();
+    telemetry->thread =
+        furi_thread_alloc_ex("telemetry", 2048, ha_telemetry_worker, telemetry);
+    furi_thread_start(telemetry->thread);
+    telemetry->thread_id = furi_thread_get_id(telemetry->thread);
+
+    return telemetry;
+}
+
+/**
+ * @brief      Flush the pending records, stop the writer thread and free the log.
+ * @param      telemetry  the HaTelemetry object
+*/
+void ha_telemetry_free(HaTelemetry* telemetry) {
+    furi_thread_flags_set(telemetry->thread_id, ThreadCommStop);
+    furi_thread_join(telemetry->thread);
+    furi_thread_free(telemetry->thread);
+    furi_message_queue_free(telemetry->queue);
+    furi_mutex_free(telemetry->mutex);
+    furi_event_flag_free(telemetry->opened);
+    free(telemetry);
+}
+
+/**
+ * @brief      Queue a snapshot to be written to the log.
+ * @details    Never waits for the writer, if it's behind the record is dropped. Unless forced,
+ *             snapshots closer than HA_TELEMETRY_MIN_PERIOD_S to the previous one are skipped.
+ * @param      telemetry  the HaTelemetry object
+ * @param      snapshot   the values to log
+ * @param      source     the HaCtrlMode the values came from
+ * @param      force      log the snapshot even if it's too close to the previous one
+*/
+void ha_telemetry_append(
+    HaTelemetry* telemetry,
+    const HaSnapshot* snapshot,
+    uint8_t source,
+    bool force) {
+    // No mutex, the worker holds it during SD accesses. It only seeds last_timestamp
+    // from the log when it opens it
+    const uint32_t last = __atomic_load_n(&telemetry->last_timestamp, __ATOMIC_RELAXED);
+    if(snapshot->timestamp == last ||
+       (!force && snapshot->timestamp < last + HA_TELEMETRY_MIN_PERIOD_S)) {
+        return;
+    }
+
+    HaTelemetryRecord record = {
+        .timestamp = snapshot->timestamp,
+        .version = HA_TELEMETRY_VERSION,
+        .source = source,
+        .valid = snapshot->valid,
+        .flags = (snapshot->dehum_sts ? HA_TELEMETRY_FLAG_DEHUM : 0) |
+                 (snapshot->dehum_aut_sts ? HA_TELEMETRY_FLAG_DEHUM_AUT : 0),
+        .rssi = snapshot->rssi,
+        .loss_pct = snapshot->loss_pct,
+    };
+    memcpy(record.values, snapshot->values, sizeof(record.values));
+
+    if(furi_message_queue_put(telemetry->queue, &record, 0) == FuriStatusOk) {
+        // A dropped record doesn't count, the next snapshot may take its place
+        __atomic_store_n(&telemetry->last_timestamp, snapshot->timestamp, __ATOMIC_RELAXED);
+        furi_thread_flags_set(telemetry->thread_id, ThreadCommUpdData);
+    } else {
+        telemetry->dropped++;
+    }
+}
+
+/**
+ * @brief      Load the newest record of the log, used to show something before new data.
+ * @details    Waits up to HA_TELEMETRY_OPEN_TIMEOUT_MS for the worker to open the log.
+ * @param      telemetry  the HaTelemetry object
+ * @param      snapshot   filled with the values of the record
+ * @return     true if the log is not empty
+*/
+bool ha_telemetry_load_last(HaTelemetry* telemetry, HaSnapshot* snapshot) {
+    HaTelemetryRecord record;
+    bool ret = false;
+    const uint32_t opened = furi_event_flag_wait(
+        telemetry->opened,
+        HA_TELEMETRY_OPENED,
+        FuriFlagWaitAny | FuriFlagNoClear,
+        furi_ms_to_ticks(HA_TELEMETRY_OPEN_TIMEOUT_MS));
+    if(opened & FuriFlagError) {
+        FURI_LOG_W(TELEMETRY_TAG, "Log not open yet, no cached values");
+        return false;
+    }
+    furi_check(furi_mutex_acquire(telemetry->mutex, FuriWaitForever) == FuriStatusOk);
+    const uint32_t records = ha_telemetry_records(telemetry);
+    if(records > 0 && ha_telemetry_read_locked(telemetry, records - 1, &record)) {
+        snapshot->timestamp = record.timestamp;
+        snapshot->valid = record.valid;
+        memcpy(snapshot->values, record.values, sizeof(snapshot->values));
+        snapshot->dehum_sts = record.flags & HA_TELEMETRY_FLAG_DEHUM;
+        snapshot->dehum_aut_sts = record.flags & HA_TELEMETRY_FLAG_DEHUM_AUT;
+        // Version 1 records have zeros in place of the link quality
+        snapshot->rssi = record.version >= 2 ? record.rssi : 0;
+        snapshot->loss_pct = record.version >= 2 ? record.loss_pct : HA_LINK_UNKNOWN;
+        ret = true;
+    }
+    furi_check(furi_mutex_release(telemetry->mutex) == FuriStatusOk);
+    return ret;
+}
+
+/**
+ * @brief      Find the first record logged at or after a timestamp.
+ * @param      telemetry  the HaTelemetry object
+ * @param      timestamp  the RTC timestamp to look for
+ * @return     the record number, equal to the number of records if none is found
+*/
+uint32_t ha_telemetry_seek(HaTelemetry* telemetry, uint32_t timestamp) {
+    furi_check(furi_mutex_acquire(telemetry->mutex, FuriWaitForever) == FuriStatusOk);
+    uint32_t record = ha_telemetry_seek_locked(telemetry, timestamp);
+    furi_check(furi_mutex_release(telemetry->mutex) == FuriStatusOk);
+    return record;
+}
+
+/**
+ * @brief      Read a record from the log.
+ * @param      telemetry  the HaTelemetry object
+ * @param      record     the record number
+ * @param      out        filled with the record
+ * @return     true if the record exists
+*/
+bool ha_telemetry_read(HaTelemetry* telemetry, uint32_t record, HaTelemetryRecord* out) {
+    furi_check(furi_mutex_acquire(telemetry->mutex, FuriWaitForever) == FuriStatusOk);
+    bool ret = ha_telemetry_read_locked(telemetry, record, out);
+    furi_check(furi_mutex_release(telemetry->mutex) == FuriStatusOk);
+    return ret;
+}
+
+/**
+ * @brief      Ask the writer thread to sample an entity between two timestamps.
+ * @details    The result is in telemetry->window once window.ready is set.
+ * @param      telemetry  the HaTelemetry object
+ * @param      entity     the entity to sample
+ * @param      start      RTC timestamp of the start of the window
+ * @param      end        RTC timestamp of the end of the window
+*/
+void ha_telemetry_request_window(
+    HaTelemetry* telemetry,
+    HaEntity entity,
+    uint32_t start,
+    uint32_t end) {
+    furi_check(furi_mutex_acquire(telemetry->mutex, FuriWaitForever) == FuriStatusOk);
+    telemetry->window.ready = false;
+    telemetry->window.entity = entity;
+    telemetry->window.start = start;
+    telemetry->window.end = end;
+    furi_check(furi_mutex_release(telemetry->mutex) == FuriStatusOk);
+    furi_thread_flags_set(telemetry->thread_id, ThreadCommLoadLog);
+}
+
+/**
+ * @brief      Copy the window loaded by the writer thread.
+ * @details    Doesn't wait, so the draw callback is never stuck behind an SD access.
+ * @param      telemetry  the HaTelemetry object
+ * @param      window     filled with the window
+ * @return     false if the window isn't loaded yet or the writer is busy
+*/
+bool ha_telemetry_get_window(HaTelemetry* telemetry, HaTelemetryWindow* window) {
+    if(furi_mutex_acquire(telemetry->mutex, 0) != FuriStatusOk) {
+        return false;
+    }
+    const bool ready = telemetry->window.ready;
+    if(ready) {
+        memcpy(window, &telemetry->window, sizeof(HaTelemetryWindow));
+    }
+    furi_check(furi_mutex_release(telemetry->mutex) == FuriStatusOk);
+    return ready;
+}
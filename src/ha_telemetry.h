@@ -0,0 +1,94 @@
+#pragma once
+#include "app.h"
+#include <storage/storage.h>
+
+#define TELEMETRY_TAG "TELEMETRY"
+
+#define HA_TELEMETRY_LOG_PATH HR_SETTINGS_FOLDER "/telemetry.bin"
+#define HA_TELEMETRY_IDX_PATH HR_SETTINGS_FOLDER "/telemetry.idx"
+
+#define HA_TELEMETRY_VERSION            2U
+#define HA_TELEMETRY_SECTOR_SIZE        512U
+#define HA_TELEMETRY_RECORDS_PER_SECTOR (HA_TELEMETRY_SECTOR_SIZE / sizeof(HaTelemetryRecord))
+#define HA_TELEMETRY_QUEUE_SIZE         16U
+#define HA_TELEMETRY_MIN_PERIOD_S       5U
+#define HA_TELEMETRY_WINDOW_POINTS      126U
+#define HA_TELEMETRY_OPEN_TIMEOUT_MS    500U
+#define HA_TELEMETRY_OPENED             0b00000001
+
+#define HA_TELEMETRY_FLAG_DEHUM     0b00000001
+#define HA_TELEMETRY_FLAG_DEHUM_AUT 0b00000010
+
+#pragma pack(push, 1)
+typedef struct {
+    uint32_t timestamp;
+    uint8_t version;
+    uint8_t source; // HaCtrlMode the values came from
+    uint16_t valid; // Bitmask of the HaEntity values
+    int16_t values[HaEntityCount];
+    uint8_t flags;
+    int8_t rssi; // Since version 2, dBm, 0 if unknown
+    uint8_t loss_pct; // Since version 2, HA_LINK_UNKNOWN if unknown
+    uint8_t reserved[5];
+} HaTelemetryRecord;
+
+// One entry for each sector of the log, holding the timestamp of its first record
+typedef struct {
+    uint32_t timestamp;
+    uint32_t record;
+} HaTelemetryIndexEntry;
+#pragma pack(pop)
+
+_Static_assert(
+    HA_TELEMETRY_SECTOR_SIZE % sizeof(HaTelemetryRecord) == 0,
+    "Records must not span sectors");
+
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+    HaEntity entity;
+    uint16_t count;
+    int16_t points[HA_TELEMETRY_WINDOW_POINTS];
+    bool ready;
+} HaTelemetryWindow;
+
+struct HaTelemetry {
+    FuriThread* thread;
+    FuriThreadId thread_id;
+    FuriMessageQueue* queue;
+    // Guards the files, the sector buffer and window
+    FuriMutex* mutex;
+    FuriEventFlag* opened; // HA_TELEMETRY_OPENED once the worker has opened the log
+    Storage* storage;
+    File* log_file;
+    File* idx_file;
+    // Records are collected here and written one sector at a time
+    HaTelemetryRecord sector[HA_TELEMETRY_RECORDS_PER_SECTOR];
+    size_t sector_len;
+    uint32_t sector_first;
+    uint32_t index_len;
+    // Of the last queued record, atomic: owned by ha_telemetry_append, seeded by the worker
+    uint32_t last_timestamp;
+    HaTelemetryWindow window;
+    // Statistics
+    uint32_t dropped;
+    uint32_t bytes_written;
+    uint32_t write_ticks;
+};
+
+HaTelemetry* ha_telemetry_alloc();
+void ha_telemetry_free(HaTelemetry* telemetry);
+void ha_telemetry_append(
+    HaTelemetry* telemetry,
+    const HaSnapshot* snapshot,
+    uint8_t source,
+    bool force);
+bool ha_telemetry_load_last(HaTelemetry* telemetry, HaSnapshot* snapshot);
+bool ha_telemetry_get_window(HaTelemetry* telemetry, HaTelemetryWindow* window);
+uint32_t ha_telemetry_seek(HaTelemetry* telemetry, uint32_t timestamp);
+bool ha_telemetry_read(HaTelemetry* telemetry, uint32_t record, HaTelemetryRecord* out);
+void ha_telemetry_request_window(
+    HaTelemetry* telemetry,
+    HaEntity entity,
+    uint32_t start,
+    uint32_t end);
@@ -1,4 +1,10 @@
 #include "sghz.h"
+#include "sghz_rx.h"
+#include "sghz_sched.h"
+#include "sghz_link.h"
+#include "cmd_channel.h"
+#include "ble_beacon.h"
+#include "ha_helpers.h"
 
 /**
  * @brief      Subghz data ready callback
@@ -12,6 +18,108 @@ void subghz_worker_update_rx(void* context) {
     furi_thread_flags_set(ha_model->sghz->rx_thread_id, ThreadCommUpdData);
 }
 
+/**
+ * @brief      Turn the receiver on or off, charging is suppressed only while it's on.
+ * @details    The suppression is taken once per start that went through and given back by
+ *             the stop, so the firmware count always ends where it started.
+ * @param      sghz  the SghzComm object
+ * @param      on    the wanted state
+ * @return     false if the receiver failed to start
+*/
+bool sghz_radio_set(SghzComm* sghz, bool on) {
+    if(on == subghz_tx_rx_worker_is_running(sghz->subghz_txrx)) {
+        return true;
+    }
+    if(on) {
+        if(!subghz_tx_rx_worker_start(sghz->subghz_txrx, sghz->device, sghz->frequency)) {
+            FURI_LOG_E(SGHZ_TAG, "Failed to start the receiver");
+            return false;
+        }
+        if(!sghz->charge_suppressed) {
+            furi_hal_power_suppress_charge_enter();
+            sghz->charge_suppressed = true;
+        }
+    } else {
+        subghz_tx_rx_worker_stop(sghz->subghz_txrx);
+        subghz_devices_sleep(sghz->device);
+        if(sghz->charge_suppressed) {
+            furi_hal_power_suppress_charge_exit();
+            sghz->charge_suppressed = false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief      Send a command through the BTHome beacon, to a sender that can't acknowledge.
+ * @param      ha_model  the Home Assistant model
+ * @param      command   the SghzCommand
+*/
+static void sghz_cmd_beacon(ReqModel* ha_model, uint8_t command) {
+    const BeaconControl control = command == SghzCommandDehumAut ? BeaconControlDehumAut :
+                                                                   BeaconControlDehum;
+    if(beacon_event_push(ha_model->ble, control)) {
+        furi_thread_flags_set(ha_model->sghz->beacon_thread_id, ThreadCommSendCmd);
+    }
+}
+
+/**
+ * @brief      Take the commands from the input callback and run the command channel.
+ * @details    Toggles requested while a command waits for its acknowledgement are kept, then
+ *             sent one after the other. Presses before the send are merged into one command,
+ *             never cancelled: each submit takes a new sequence and the sender drops only the
+ *             retries of a sequence it already ran.
+ * @param      ha_model  the Home Assistant model
+ * @param      wait_ms   filled with the time until the channel needs to run again
+*/
+static void sghz_cmd_run(ReqModel* ha_model, uint32_t* wait_ms) {
+    SghzComm* sghz = ha_model->sghz;
+    sghz->cmd_pending |= __atomic_exchange_n(&sghz->cmd_request, 0, __ATOMIC_ACQUIRE);
+    for(uint8_t command = SghzCommandDehum; command <= SghzCommandDehumAut; command++) {
+        if(!(sghz->cmd_pending & SGHZ_CMD_BIT(command))) {
+            continue;
+        }
+        if(!sghz->peer_binary) {
+            // An ASCII only sender has no way to acknowledge
+            sghz_cmd_beacon(ha_model, command);
+        } else if(!cmd_channel_submit(
+                      &sghz->cmd,
+                      command,
+                      furi_get_tick(),
+                      sghz->sched.period_ms + SGHZ_SCHED_WINDOW_MS)) {
+            break;
+        }
+        sghz->cmd_pending &= ~SGHZ_CMD_BIT(command);
+    }
+
+    switch(cmd_channel_update(&sghz->cmd, furi_get_tick(), wait_ms)) {
+    case CmdChannelActionSend: {
+        uint8_t buffer[SGHZ_CMD_FRAME_SIZE];
+        const size_t len =
+            sghz_frame_encode_cmd(sghz->cmd.seq, sghz->cmd.command, buffer, sizeof(buffer));
+        // The sender acknowledges in its next frame, the scheduler listens for it anyway
+        sghz_radio_set(sghz, true);
+        if(!subghz_tx_rx_worker_write(sghz->subghz_txrx, buffer, len)) {
+            FURI_LOG_E(SGHZ_TAG, "Write failed, retrying later");
+        }
+    } break;
+
+    case CmdChannelActionGiveUp:
+        // The command may have landed with only the acknowledgement lost, sending the toggle
+        // again over the beacon could undo it. The page tells it's lost instead
+        FURI_LOG_W(SGHZ_TAG, "Command %u lost", sghz->cmd.command);
+        break;
+
+    default:
+        break;
+    }
+
+    // The next queued command goes out right away
+    if(sghz->cmd.state == CmdChannelIdle && sghz->cmd_pending) {
+        *wait_ms = 0;
+    }
+}
+
 /**
  * @brief      Subghz data reading thread
  * @param      context ReqModel pointer
@@ -19,47 +127,127 @@ void subghz_worker_update_rx(void* context) {
 int32_t listen_rx(void* context) {
     furi_assert(context);
     ReqModel* ha_model = context;
+    SghzComm* sghz = ha_model->sghz;
     FURI_LOG_I(TAG, "listen_rx started...");
-    size_t message_max_len = 64;
-    uint8_t message[64] = {0};
-    FuriString* output = furi_string_alloc();
+    uint8_t message[SGHZ_ASCII_FRAME_SIZE + 1];
+    HaSnapshot frame;
+    uint8_t counter;
+    int16_t ack;
+    sghz_rx_reset(&sghz->rx);
+    sghz_link_reset(&sghz->link);
+    cmd_channel_reset(&sghz->cmd, furi_hal_random_get());
+    sghz->cmd_request = 0;
+    sghz->cmd_pending = 0;
+    sghz->peer_binary = false;
+    sghz_sched_reset(&sghz->sched, SGHZ_POLL_PERIOD, furi_get_tick());
+    uint32_t wait_ms = SGHZ_SCHED_IDLE_MS;
+    uint32_t cmd_wait_ms = UINT32_MAX;
     bool run = true;
     while(run) {
+        const uint32_t timeout_ms = MIN(SGHZ_DUTY_CYCLE ? wait_ms : UINT32_MAX, cmd_wait_ms);
         uint32_t events = furi_thread_flags_wait(
-            ThreadCommUpdData | ThreadCommStop, FuriFlagWaitAny, FuriWaitForever);
+            ThreadCommUpdData | ThreadCommStop | ThreadCommSendCmd,
+            FuriFlagWaitAny,
+            timeout_ms == UINT32_MAX ? FuriWaitForever : furi_ms_to_ticks(timeout_ms));
+        // The command request is picked up below at every wake up
+        if(!(events & FuriFlagError)) {
+            events &= ~ThreadCommSendCmd;
+        }
         switch(events) {
-        case ThreadCommUpdData:
-            while(subghz_tx_rx_worker_available(ha_model->sghz->subghz_txrx)) {
-                ha_model->sghz->status = SGHZ_BUSY;
-                memset(message, 0x00, message_max_len);
-                size_t len = subghz_tx_rx_worker_read(
-                    ha_model->sghz->subghz_txrx, message, message_max_len);
-                for(size_t i = 0; i < len; i++) {
-                    furi_string_push_back(output, message[i]);
+        case ThreadCommUpdData: {
+            // Read straight into the ring, a frame can span more reads
+            while(subghz_tx_rx_worker_available(sghz->subghz_txrx)) {
+                sghz->status = SGHZ_BUSY;
+                size_t space;
+                uint8_t* dst = sghz_rx_write_ptr(&sghz->rx, &space);
+                if(space > 0) {
+                    sghz_rx_commit(
+                        &sghz->rx, subghz_tx_rx_worker_read(sghz->subghz_txrx, dst, space));
+                } else {
+                    uint8_t discard[16];
+                    sghz_rx_drop(
+                        &sghz->rx,
+                        subghz_tx_rx_worker_read(sghz->subghz_txrx, discard, sizeof(discard)));
                 }
-                FURI_LOG_I(SGHZ_TAG, "[Message] %s", message);
             }
 
-            if(furi_mutex_acquire(ha_model->worker_mutex, 0) == FuriStatusOk) {
-                furi_string_set(ha_model->sghz->last_message, output);
-                ha_model->sghz->status = SGHZ_INACTIVE;
-                furi_check(furi_mutex_release(ha_model->worker_mutex) == FuriStatusOk);
-            }
+            size_t len;
+            SghzRxType type;
+            while((type = sghz_rx_next(&sghz->rx, message, &len)) != SghzRxNone) {
+                // Close enough to the frame, the packet has just been read out of the radio
+                const int8_t rssi = (int8_t)subghz_devices_get_rssi(sghz->device);
+                if(type == SghzRxBinary) {
+                    const SghzFrameResult result =
+                        sghz_frame_decode(message, len, &frame, &counter, &ack);
+                    if(result != SghzFrameOk) {
+                        sghz->frame_errors++;
+                        FURI_LOG_E(
+                            SGHZ_TAG,
+                            "[Frame] Dropped, error %u, total %lu",
+                            result,
+                            sghz->frame_errors);
+                        continue;
+                    }
+                    FURI_LOG_I(SGHZ_TAG, "[Frame] %u bytes, counter %u", len, counter);
+                    sghz->peer_binary = true;
+                    if(ack != SGHZ_FRAME_NO_ACK) {
+                        cmd_channel_on_ack(&sghz->cmd, ack, furi_get_tick());
+                    }
+                    sghz_sched_on_frame(&sghz->sched, furi_get_tick(), counter, 256);
+                    sghz_link_on_frame(&sghz->link, counter, 256, rssi);
+                } else {
+                    message[len] = '\0';
+                    FURI_LOG_I(SGHZ_TAG, "[Message] %s", message);
+                    // The reassembler checked the first two characters are digits
+                    counter = (message[0] - '0') * 10 + (message[1] - '0');
+                    sghz_sched_on_frame(&sghz->sched, furi_get_tick(), counter, 100);
+                    sghz_link_on_frame(&sghz->link, counter, 100, rssi);
+                }
 
-            furi_string_reset(output);
+                if(furi_mutex_acquire(ha_model->worker_mutex, 0) == FuriStatusOk) {
+                    if(type == SghzRxAscii) {
+                        furi_string_set_strn(sghz->last_message, (const char*)message, len);
+                        sghz->message_ready = true;
+                    } else {
+                        // Back to back frames not parsed yet are merged
+                        if(sghz->frame_ready) {
+                            ha_snapshot_merge(&sghz->frame, &frame);
+                        } else {
+                            sghz->frame = frame;
+                        }
+                        sghz->frame_counter = counter;
+                        sghz->frame_ready = true;
+                    }
+                    furi_check(furi_mutex_release(ha_model->worker_mutex) == FuriStatusOk);
+                }
+            }
 
-            break;
+            sghz->status = SGHZ_INACTIVE;
+        } break;
 
         case ThreadCommStop:
             run = false;
-            ha_model->sghz->status = SGHZ_INACTIVE;
+            sghz->status = SGHZ_INACTIVE;
             break;
 
         default:
             break;
         }
+
+        if(SGHZ_CMD_CHANNEL && run) {
+            sghz_cmd_run(ha_model, &cmd_wait_ms);
+        }
+
+        if(SGHZ_DUTY_CYCLE && run) {
+            const bool on = sghz_sched_update(&sghz->sched, furi_get_tick(), &wait_ms);
+            // Keep listening while a command waits, the transmission is also asynchronous
+            sghz_radio_set(sghz, on || sghz->cmd.state != CmdChannelIdle);
+        }
     }
 
-    furi_string_free(output);
+    sghz_rx_log(&sghz->rx);
+    sghz_sched_log(&sghz->sched, furi_get_tick());
+    sghz_link_log(&sghz->link);
+    cmd_channel_log(&sghz->cmd);
     return 0;
 }
@@ -1,10 +1,18 @@
 #pragma once
 #include "app.h"
+#include "sghz_frame.h"
 #include <lib/subghz/subghz_tx_rx_worker.h>
 #include <devices/cc1101_int/cc1101_int_interconnect.h>
 
 #define SGHZ_TAG         "SGHZ"
 #define SGHZ_POLL_PERIOD 5000U
+// Sleep the receiver between the frames of the sender
+#define SGHZ_DUTY_CYCLE true
+// Send the commands over Sub-GHz and wait for the sender to acknowledge them
+#define SGHZ_CMD_CHANNEL true
+// Bit of a SghzCommand in cmd_request and cmd_pending
+#define SGHZ_CMD_BIT(command) (1U << ((command) - 1))
 
+bool sghz_radio_set(SghzComm* sghz, bool on);
 void subghz_worker_update_rx(void* context);
 int32_t listen_rx(void* context);
@@ -0,0 +1,111 @@
+#include "sghz_ascii.h"
+#include "ha_snapshot.h"
+#include <ctype.h>
+
+static const char SGHZ_ASCII_DEHUM_TAG[] = "dh";
+static const char SGHZ_ASCII_DEHUM_AUTOMATION_TAG[] = "ad";
+
+// Tag of each HaEntity in the message, the same as the keys of the JSON response
+static const char* const SGHZ_ASCII_TAGS[HaEntityCount] = {
+    "bt",
+    "bh",
+    "kt",
+    "kh",
+    "ot",
+    "oh",
+    "co",
+    "pm",
+};
+
+/**
+ * @brief      Update a value from its Sub-GHz field, the string is set only on change.
+ * @param      snapshot  the HaSnapshot to update
+ * @param      print     the string shown for the entity
+ * @param      entity    the entity the field belongs to
+ * @param      value     the field, null terminated
+*/
+void sghz_ascii_set_field(
+    HaSnapshot* snapshot,
+    FuriString* print,
+    HaEntity entity,
+    const char* value) {
+    char* end;
+    const float_t parsed = strtof(value, &end);
+    if(end == value) {
+        // Not a number, show it as it is
+        furi_string_set_str(print, value);
+        return;
+    }
+
+    const bool was_valid = snapshot->valid & (1 << entity);
+    const int16_t prev = snapshot->values[entity];
+    ha_snapshot_set_float(snapshot, entity, parsed);
+    if(!was_valid || prev != snapshot->values[entity] || furi_string_empty(print)) {
+        furi_string_set_str(print, value);
+    }
+}
+
+/**
+ * @brief      Parse the Sub-GHz ASCII message.
+ * @details    The message is a two digit counter followed by fields made of a two letter
+ *             tag and a four character value. It is scanned once left to right, unknown
+ *             tags are skipped and a truncated field ends the scan. Nothing is done if the
+ *             counter did not change.
+ * @param      string        the message, null terminated
+ * @param      last_counter  the counter of the last message parsed, updated
+ * @param      snapshot      the HaSnapshot to update
+ * @param      prints        the strings shown for the message
+ * @return     the outcome of the parse
+*/
+SghzAsciiResult sghz_ascii_parse(
+    const char* string,
+    uint8_t* last_counter,
+    HaSnapshot* snapshot,
+    const SghzAsciiPrints* prints) {
+    const size_t len = strlen(string);
+    if(len < SGHZ_ASCII_COUNTER_SIZE || !isdigit((unsigned char)string[0]) ||
+       !isdigit((unsigned char)string[1])) {
+        return SghzAsciiNoCounter;
+    }
+    const uint8_t counter = (string[0] - '0') * 10 + (string[1] - '0');
+    if(counter == *last_counter) {
+        return SghzAsciiSameCounter;
+    }
+    *last_counter = counter;
+
+    bool dehum_changed = furi_string_empty(prints->dehum_sts);
+    char value[SGHZ_ASCII_VALUE_SIZE + 1];
+    size_t pos = SGHZ_ASCII_COUNTER_SIZE;
+    for(; pos + SGHZ_ASCII_TAG_SIZE + SGHZ_ASCII_VALUE_SIZE <= len;
+        pos += SGHZ_ASCII_TAG_SIZE + SGHZ_ASCII_VALUE_SIZE) {
+        const char* tag = &string[pos];
+        memcpy(value, &string[pos + SGHZ_ASCII_TAG_SIZE], SGHZ_ASCII_VALUE_SIZE);
+        value[SGHZ_ASCII_VALUE_SIZE] = '\0';
+
+        if(memcmp(tag, SGHZ_ASCII_DEHUM_TAG, SGHZ_ASCII_TAG_SIZE) == 0) {
+            const bool on = strstr(value, "on") != NULL;
+            dehum_changed |= on != snapshot->dehum_sts;
+            snapshot->dehum_sts = on;
+        } else if(memcmp(tag, SGHZ_ASCII_DEHUM_AUTOMATION_TAG, SGHZ_ASCII_TAG_SIZE) == 0) {
+            const bool on = strstr(value, "on") != NULL;
+            dehum_changed |= on != snapshot->dehum_aut_sts;
+            snapshot->dehum_aut_sts = on;
+        } else {
+            for(size_t e = 0; e < HaEntityCount; e++) {
+                if(memcmp(tag, SGHZ_ASCII_TAGS[e], SGHZ_ASCII_TAG_SIZE) == 0) {
+                    sghz_ascii_set_field(snapshot, prints->values[e], e, value);
+                    break;
+                }
+            }
+        }
+    }
+
+    if(dehum_changed) {
+        furi_string_printf(
+            prints->dehum_sts,
+            "%s-%s",
+            snapshot->dehum_sts ? "on" : "off",
+            snapshot->dehum_aut_sts ? "A" : "M");
+    }
+    return pos == len ? SghzAsciiOk : SghzAsciiTruncated;
+}
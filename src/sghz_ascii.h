@@ -0,0 +1,31 @@
+#pragma once
+#include "app.h"
+
+// Two digit counter, then fields of a two letter tag and a four character value
+#define SGHZ_ASCII_COUNTER_SIZE 2U
+#define SGHZ_ASCII_TAG_SIZE     2U
+#define SGHZ_ASCII_VALUE_SIZE   4U
+
+typedef enum {
+    SghzAsciiOk,
+    SghzAsciiNoCounter,
+    SghzAsciiSameCounter, // Already parsed, nothing changed
+    SghzAsciiTruncated, // The fields before the truncated one are applied
+} SghzAsciiResult;
+
+// The strings shown for the message, only set when their value changes
+typedef struct {
+    FuriString* values[HaEntityCount];
+    FuriString* dehum_sts;
+} SghzAsciiPrints;
+
+void sghz_ascii_set_field(
+    HaSnapshot* snapshot,
+    FuriString* print,
+    HaEntity entity,
+    const char* value);
+SghzAsciiResult sghz_ascii_parse(
+    const char* string,
+    uint8_t* last_counter,
+    HaSnapshot* snapshot,
+    const SghzAsciiPrints* prints);
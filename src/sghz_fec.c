@@ -0,0 +1,106 @@
+#include "sghz_fec.h"
+
+#define SGHZ_FEC_BITS (SGHZ_FEC_CODED_SIZE * 8U)
+
+// Extended Hamming(8,4) codewords: corrects one bit error, detects two
+static const uint8_t HAMMING_84[16] = {
+    0x00, 0x87, 0x99, 0x1E, 0xAA, 0x2D, 0x33, 0xB4,
+    0x4B, 0xCC, 0xD2, 0x55, 0xE1, 0x66, 0x78, 0xFF,
+};
+
+/**
+ * @brief      Decode a codeword to the nearest data nibble.
+ * @param      code       the received codeword
+ * @param      corrected  incremented by the number of corrected bits
+ * @return     the nibble, -1 if two bits are wrong and the nearest codeword is ambiguous
+*/
+static int8_t sghz_fec_decode_nibble(uint8_t code, uint32_t* corrected) {
+    int8_t best = -1;
+    uint8_t best_distance = 8;
+    bool ambiguous = false;
+    for(uint8_t nibble = 0; nibble < 16; nibble++) {
+        const uint8_t distance = __builtin_popcount(code ^ HAMMING_84[nibble]);
+        if(distance < best_distance) {
+            best = nibble;
+            best_distance = distance;
+            ambiguous = false;
+        } else if(distance == best_distance) {
+            ambiguous = true;
+        }
+    }
+    if(ambiguous || best_distance > 1) {
+        return -1;
+    }
+    *corrected += best_distance;
+    return best;
+}
+
+/**
+ * @brief      Position of a codeword bit on air.
+ * @details    Bit b of codeword c is sent as bit b * codewords + c, so a burst of
+ *             errors shorter than the number of codewords hits each of them at most once.
+*/
+static uint16_t sghz_fec_bit_index(uint16_t codeword, uint8_t bit) {
+    return bit * SGHZ_FEC_CODED_SIZE + codeword;
+}
+
+/**
+ * @brief      Protect a binary frame, the output always has SGHZ_FEC_FRAME_SIZE bytes.
+ * @param      frame   the binary frame, CRC included
+ * @param      len     the frame length, at most SGHZ_FRAME_MAX_SIZE
+ * @param      buffer  the output buffer
+ * @param      size    the output buffer size
+ * @return     the output length, 0 if the frame or the buffer have the wrong size
+*/
+size_t sghz_fec_encode(const uint8_t* frame, size_t len, uint8_t* buffer, size_t size) {
+    if(len > SGHZ_FRAME_MAX_SIZE || size < SGHZ_FEC_FRAME_SIZE) {
+        return 0;
+    }
+
+    buffer[0] = SGHZ_FEC_MAGIC;
+    uint8_t* coded = &buffer[1];
+    memset(coded, 0, SGHZ_FEC_CODED_SIZE);
+    for(uint16_t c = 0; c < SGHZ_FEC_CODED_SIZE; c++) {
+        const uint8_t byte = c / 2 < len ? frame[c / 2] : 0;
+        const uint8_t code = HAMMING_84[c % 2 ? byte & 0x0F : byte >> 4];
+        for(uint8_t bit = 0; bit < 8; bit++) {
+            if(code & (1 << bit)) {
+                const uint16_t index = sghz_fec_bit_index(c, bit);
+                coded[index / 8] |= 1 << (index % 8);
+            }
+        }
+    }
+
+    return SGHZ_FEC_FRAME_SIZE;
+}
+
+/**
+ * @brief      Correct and extract the frame of a FEC frame.
+ * @details    The frame still has to be checked by its CRC, a codeword with more than
+ *             two errors can decode to the wrong nibble.
+ * @param      buffer  the received SGHZ_FEC_FRAME_SIZE bytes, starting with the magic
+ * @param      frame   filled with SGHZ_FRAME_MAX_SIZE bytes, the frame and its padding
+ * @return     the number of corrected bits, -1 if a codeword can't be corrected
+*/
+int32_t sghz_fec_decode(const uint8_t* buffer, uint8_t* frame) {
+    const uint8_t* coded = &buffer[1];
+    uint32_t corrected = 0;
+    for(uint16_t c = 0; c < SGHZ_FEC_CODED_SIZE; c++) {
+        uint8_t code = 0;
+        for(uint8_t bit = 0; bit < 8; bit++) {
+            const uint16_t index = sghz_fec_bit_index(c, bit);
+            code |= ((coded[index / 8] >> (index % 8)) & 1) << bit;
+        }
+        const int8_t nibble = sghz_fec_decode_nibble(code, &corrected);
+        if(nibble < 0) {
+            return -1;
+        }
+        if(c % 2) {
+            frame[c / 2] |= nibble;
+        } else {
+            frame[c / 2] = nibble << 4;
+        }
+    }
+
+    return corrected;
+}
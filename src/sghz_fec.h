@@ -0,0 +1,15 @@
+#pragma once
+#include "app.h"
+#include "sghz_frame.h"
+
+// Binary frame protected by forward error correction: this magic, then the frame padded to
+// SGHZ_FRAME_MAX_SIZE, every nibble Hamming(8,4) coded and the bits interleaved
+#define SGHZ_FEC_MAGIC      0xA7
+#define SGHZ_FEC_CODED_SIZE (SGHZ_FRAME_MAX_SIZE * 2U)
+#define SGHZ_FEC_FRAME_SIZE (1U + SGHZ_FEC_CODED_SIZE)
+
+// The tx/rx worker sends at most 64 bytes at once
+_Static_assert(SGHZ_FEC_FRAME_SIZE <= 64, "FEC frame too long for a single transmission");
+
+size_t sghz_fec_encode(const uint8_t* frame, size_t len, uint8_t* buffer, size_t size);
+int32_t sghz_fec_decode(const uint8_t* buffer, uint8_t* frame);
@@ -0,0 +1,155 @@
+#include "sghz_frame.h"
+
+/**
+ * @brief      CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), same as the sender.
+ * @param      data  the bytes to check
+ * @param      len   the number of bytes
+ * @return     the CRC
+*/
+uint16_t sghz_frame_crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for(size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for(uint8_t bit = 0; bit < 8; bit++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief      Length of a binary frame, from its presence bitmap and flags.
+ * @param      present  the presence bitmap
+ * @param      flags    the flags byte
+ * @return     the frame length, CRC included
+*/
+size_t sghz_frame_length(uint8_t present, uint8_t flags) {
+    present &= (1 << HaEntityCount) - 1;
+    return SGHZ_FRAME_HEADER_SIZE + (flags & SGHZ_FRAME_FLAG_ACK ? SGHZ_FRAME_ACK_SIZE : 0) +
+           __builtin_popcount(present) * sizeof(int16_t) + SGHZ_FRAME_CRC_SIZE;
+}
+
+/**
+ * @brief      Encode the valid values of a snapshot in a binary frame.
+ * @details    Layout: magic, version, counter, presence bitmap, flags, one little endian
+ *             int16 for each bit set in the bitmap (in HaEntity order), CRC16 of all the
+ *             previous bytes, little endian.
+ * @param      snapshot  the values to send
+ * @param      counter   the frame counter
+ * @param      buffer    the output buffer
+ * @param      size      the output buffer size
+ * @return     the frame length, 0 if the buffer is too small
+*/
+size_t sghz_frame_encode(
+    const HaSnapshot* snapshot,
+    uint8_t counter,
+    uint8_t* buffer,
+    size_t size) {
+    const uint8_t present = snapshot->valid & ((1 << HaEntityCount) - 1);
+    if(size < sghz_frame_length(present, 0)) {
+        return 0;
+    }
+
+    size_t pos = 0;
+    buffer[pos++] = SGHZ_FRAME_MAGIC;
+    buffer[pos++] = SGHZ_FRAME_VERSION;
+    buffer[pos++] = counter;
+    buffer[pos++] = present;
+    buffer[pos++] = (snapshot->dehum_sts ? SGHZ_FRAME_FLAG_DEHUM : 0) |
+                    (snapshot->dehum_aut_sts ? SGHZ_FRAME_FLAG_DEHUM_AUT : 0);
+    for(size_t e = 0; e < HaEntityCount; e++) {
+        if(present & (1 << e)) {
+            const uint16_t value = (uint16_t)snapshot->values[e];
+            buffer[pos++] = value & 0xFF;
+            buffer[pos++] = value >> 8;
+        }
+    }
+    const uint16_t crc = sghz_frame_crc16(buffer, pos);
+    buffer[pos++] = crc & 0xFF;
+    buffer[pos++] = crc >> 8;
+
+    return pos;
+}
+
+/**
+ * @brief      Decode a binary frame straight from the receive buffer.
+ * @details    Only the values flagged in the bitmap are written, the valid mask of the
+ *             output is set to the bitmap.
+ * @param      buffer    the received bytes
+ * @param      len       the number of received bytes
+ * @param      snapshot  filled with the decoded values
+ * @param      counter   filled with the frame counter
+ * @param      ack       filled with the acknowledged command sequence, or SGHZ_FRAME_NO_ACK
+ * @return     SghzFrameOk if the frame is valid
+*/
+SghzFrameResult sghz_frame_decode(
+    const uint8_t* buffer,
+    size_t len,
+    HaSnapshot* snapshot,
+    uint8_t* counter,
+    int16_t* ack) {
+    if(len < 1 || buffer[0] != SGHZ_FRAME_MAGIC) {
+        return SghzFrameNotBinary;
+    }
+    if(len < SGHZ_FRAME_HEADER_SIZE + SGHZ_FRAME_CRC_SIZE) {
+        return SghzFrameBadLength;
+    }
+    if(buffer[1] != SGHZ_FRAME_VERSION) {
+        return SghzFrameBadVersion;
+    }
+
+    const uint8_t present = buffer[3] & ((1 << HaEntityCount) - 1);
+    if(len != sghz_frame_length(present, buffer[4])) {
+        return SghzFrameBadLength;
+    }
+    const uint16_t crc = buffer[len - 2] | (uint16_t)buffer[len - 1] << 8;
+    if(crc != sghz_frame_crc16(buffer, len - SGHZ_FRAME_CRC_SIZE)) {
+        return SghzFrameBadCrc;
+    }
+
+    *counter = buffer[2];
+    snapshot->valid = present;
+    snapshot->dehum_sts = buffer[4] & SGHZ_FRAME_FLAG_DEHUM;
+    snapshot->dehum_aut_sts = buffer[4] & SGHZ_FRAME_FLAG_DEHUM_AUT;
+    size_t pos = SGHZ_FRAME_HEADER_SIZE;
+    *ack = SGHZ_FRAME_NO_ACK;
+    if(buffer[4] & SGHZ_FRAME_FLAG_ACK) {
+        *ack = buffer[pos];
+        pos += SGHZ_FRAME_ACK_SIZE;
+    }
+    for(size_t e = 0; e < HaEntityCount; e++) {
+        if(present & (1 << e)) {
+            snapshot->values[e] = (int16_t)(buffer[pos] | (uint16_t)buffer[pos + 1] << 8);
+            pos += sizeof(int16_t);
+        }
+    }
+
+    return SghzFrameOk;
+}
+
+/**
+ * @brief      Encode a command for the sender.
+ * @details    Layout: magic, version, sequence, command, CRC16 of the previous bytes,
+ *             little endian. The sender acknowledges the sequence in its next frame.
+ * @param      seq      the command sequence
+ * @param      command  the SghzCommand
+ * @param      buffer   the output buffer
+ * @param      size     the output buffer size
+ * @return     the frame length, 0 if the buffer is too small
+*/
+size_t sghz_frame_encode_cmd(uint8_t seq, uint8_t command, uint8_t* buffer, size_t size) {
+    if(size < SGHZ_CMD_FRAME_SIZE) {
+        return 0;
+    }
+
+    size_t pos = 0;
+    buffer[pos++] = SGHZ_CMD_MAGIC;
+    buffer[pos++] = SGHZ_CMD_VERSION;
+    buffer[pos++] = seq;
+    buffer[pos++] = command;
+    const uint16_t crc = sghz_frame_crc16(buffer, pos);
+    buffer[pos++] = crc & 0xFF;
+    buffer[pos++] = crc >> 8;
+
+    return pos;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "app.h"
+
+#define SGHZ_FRAME_MAGIC   0xA5
+#define SGHZ_FRAME_VERSION 1U
+// magic, version, counter, presence bitmap, flags
+#define SGHZ_FRAME_HEADER_SIZE 5U
+#define SGHZ_FRAME_CRC_SIZE    2U
+// Sequence of the last command executed by the sender, only if SGHZ_FRAME_FLAG_ACK is set
+#define SGHZ_FRAME_ACK_SIZE 1U
+#define SGHZ_FRAME_MAX_SIZE                                                            \
+    (SGHZ_FRAME_HEADER_SIZE + SGHZ_FRAME_ACK_SIZE + HaEntityCount * sizeof(int16_t) + \
+     SGHZ_FRAME_CRC_SIZE)
+
+// Command frame sent to the sender: magic, version, sequence, command, CRC16
+#define SGHZ_CMD_MAGIC      0xA6
+#define SGHZ_CMD_VERSION    1U
+#define SGHZ_CMD_FRAME_SIZE 6U
+
+// Two digit counter and ten fields of two letter tag and four character value
+#define SGHZ_ASCII_FRAME_SIZE 62U
+
+#define SGHZ_FRAME_FLAG_DEHUM     0b00000001
+#define SGHZ_FRAME_FLAG_DEHUM_AUT 0b00000010
+#define SGHZ_FRAME_FLAG_ACK       0b00000100
+
+// No acknowledgement in the frame
+#define SGHZ_FRAME_NO_ACK (-1)
+
+_Static_assert(HaEntityCount <= 8, "The presence bitmap is a single byte");
+
+typedef enum {
+    SghzFrameOk,
+    SghzFrameNotBinary, // Not starting with the magic, try the ASCII format
+    SghzFrameBadVersion,
+    SghzFrameBadLength,
+    SghzFrameBadCrc,
+} SghzFrameResult;
+
+uint16_t sghz_frame_crc16(const uint8_t* data, size_t len);
+size_t sghz_frame_length(uint8_t present, uint8_t flags);
+size_t sghz_frame_encode(
+    const HaSnapshot* snapshot,
+    uint8_t counter,
+    uint8_t* buffer,
+    size_t size);
+SghzFrameResult sghz_frame_decode(
+    const uint8_t* buffer,
+    size_t len,
+    HaSnapshot* snapshot,
+    uint8_t* counter,
+    int16_t* ack);
+size_t sghz_frame_encode_cmd(uint8_t seq, uint8_t command, uint8_t* buffer, size_t size);
@@ -0,0 +1,100 @@
+#include "sghz_link.h"
+
+/**
+ * @brief      Shift a frame in the rolling window.
+*/
+static void sghz_link_window_push(SghzLink* link, bool received) {
+    link->window = (link->window << 1) | (received ? 1 : 0);
+    if(link->window_len < SGHZ_LINK_WINDOW) {
+        link->window_len++;
+    }
+}
+
+void sghz_link_reset(SghzLink* link) {
+    memset(link, 0, sizeof(SghzLink));
+}
+
+/**
+ * @brief      Account a received frame.
+ * @details    The counter step from the previous frame gives the number of lost frames,
+ *             it wraps at the modulus (100 for the ASCII format, 256 for the binary one).
+ *             A step of zero is a duplicate. More than a full wrap can't be detected.
+ * @param      link     the SghzLink object
+ * @param      counter  the frame counter
+ * @param      modulus  the counter wraps at this value
+ * @param      rssi     the RSSI of the frame in dBm
+ * @return     false if the frame is a duplicate
+*/
+bool sghz_link_on_frame(SghzLink* link, uint8_t counter, uint16_t modulus, int8_t rssi) {
+    if(link->have_last) {
+        const uint16_t steps = (counter + modulus - link->last_counter % modulus) % modulus;
+        if(steps == 0) {
+            link->duplicates++;
+            return false;
+        }
+        const uint16_t lost = steps - 1;
+        link->lost += lost;
+        for(uint16_t i = 0; i < lost && i < SGHZ_LINK_WINDOW; i++) {
+            sghz_link_window_push(link, false);
+        }
+    }
+    sghz_link_window_push(link, true);
+    link->have_last = true;
+    link->last_counter = counter;
+    link->received++;
+
+    link->rssi[link->rssi_idx] = rssi;
+    link->rssi_idx = (link->rssi_idx + 1) % SGHZ_LINK_WINDOW;
+    if(link->rssi_count < SGHZ_LINK_WINDOW) {
+        link->rssi_count++;
+    }
+
+    return true;
+}
+
+/**
+ * @brief      Loss rate and RSSI over the rolling window.
+ * @param      link   the SghzLink object
+ * @param      stats  filled with the result
+*/
+void sghz_link_stats(const SghzLink* link, SghzLinkStats* stats) {
+    memset(stats, 0, sizeof(SghzLinkStats));
+    if(link->window_len == 0) {
+        stats->loss_pct = HA_LINK_UNKNOWN;
+        return;
+    }
+
+    const uint32_t mask =
+        link->window_len == SGHZ_LINK_WINDOW ? UINT32_MAX : ((uint32_t)1 << link->window_len) - 1;
+    const uint8_t received = __builtin_popcount(link->window & mask);
+    stats->loss_pct = (link->window_len - received) * 100 / link->window_len;
+
+    stats->rssi_last = link->rssi[(link->rssi_idx + SGHZ_LINK_WINDOW - 1) % SGHZ_LINK_WINDOW];
+    stats->rssi_min = INT8_MAX;
+    stats->rssi_max = INT8_MIN;
+    int32_t sum = 0;
+    for(uint8_t i = 0; i < link->rssi_count; i++) {
+        const int8_t rssi = link->rssi[i];
+        sum += rssi;
+        if(rssi < stats->rssi_min) {
+            stats->rssi_min = rssi;
+        }
+        if(rssi > stats->rssi_max) {
+            stats->rssi_max = rssi;
+        }
+    }
+    stats->rssi_avg = sum / link->rssi_count;
+}
+
+void sghz_link_log(const SghzLink* link) {
+    SghzLinkStats stats;
+    sghz_link_stats(link, &stats);
+    FURI_LOG_I(
+        SGHZ_LINK_TAG,
+        "Received: %lu, lost: %lu, duplicates: %lu, recent loss: %u%%, RSSI avg: %d",
+        link->received,
+        link->lost,
+        link->duplicates,
+        stats.loss_pct,
+        stats.rssi_avg);
+}
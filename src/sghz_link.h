@@ -0,0 +1,17 @@
+#pragma once
+#include "app.h"
+
+#define SGHZ_LINK_TAG "SGHZ_LINK"
+
+typedef struct {
+    uint8_t loss_pct; // Over the rolling window, HA_LINK_UNKNOWN if empty
+    int8_t rssi_last;
+    int8_t rssi_min;
+    int8_t rssi_max;
+    int8_t rssi_avg;
+} SghzLinkStats;
+
+void sghz_link_reset(SghzLink* link);
+bool sghz_link_on_frame(SghzLink* link, uint8_t counter, uint16_t modulus, int8_t rssi);
+void sghz_link_stats(const SghzLink* link, SghzLinkStats* stats);
+void sghz_link_log(const SghzLink* link);
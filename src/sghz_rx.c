@@ -0,0 +1,195 @@
+#include "sghz_rx.h"
+
+#define SGHZ_RX_RING_MASK (SGHZ_RX_RING_SIZE - 1)
+
+_Static_assert((SGHZ_RX_RING_SIZE & SGHZ_RX_RING_MASK) == 0, "Ring size must be a power of 2");
+_Static_assert(SGHZ_RX_RING_SIZE >= 2 * SGHZ_ASCII_FRAME_SIZE, "Ring too small");
+_Static_assert(SGHZ_ASCII_FRAME_SIZE >= SGHZ_FRAME_MAX_SIZE, "Frame buffer too small");
+
+static size_t sghz_rx_used(const SghzRx* rx) {
+    return rx->head - rx->tail;
+}
+
+static uint8_t sghz_rx_peek(const SghzRx* rx, size_t offset) {
+    return rx->ring[(rx->tail + offset) & SGHZ_RX_RING_MASK];
+}
+
+/**
+ * @brief      Skip one byte, the start of the buffer is not the start of a frame.
+*/
+static void sghz_rx_resync(SghzRx* rx) {
+    rx->tail++;
+    rx->resyncs++;
+}
+
+/**
+ * @brief      Copy a complete frame out of the ring.
+*/
+static void sghz_rx_pop(SghzRx* rx, uint8_t* frame, size_t len) {
+    for(size_t i = 0; i < len; i++) {
+        frame[i] = sghz_rx_peek(rx, i);
+    }
+    rx->tail += len;
+    rx->frames++;
+}
+
+void sghz_rx_reset(SghzRx* rx) {
+    memset(rx, 0, sizeof(SghzRx));
+}
+
+/**
+ * @brief      Where the rx worker can read the next bytes to, without any copy.
+ * @details    Bytes of a frame not completed within SGHZ_RX_GAP_MS are dropped first,
+ *             so a lost chunk doesn't corrupt the next frame.
+ * @param      rx     the SghzRx object
+ * @param      space  filled with the contiguous free space, 0 if the ring is full
+ * @return     the write position
+*/
+uint8_t* sghz_rx_write_ptr(SghzRx* rx, size_t* space) {
+    const size_t used = sghz_rx_used(rx);
+    if(used > 0 && furi_get_tick() - rx->last_rx_tick > furi_ms_to_ticks(SGHZ_RX_GAP_MS)) {
+        FURI_LOG_I(SGHZ_RX_TAG, "Dropping %u bytes of an incomplete frame", used);
+        rx->drops += used;
+        rx->tail = rx->head;
+    }
+
+    const size_t index = rx->head & SGHZ_RX_RING_MASK;
+    const size_t contiguous = SGHZ_RX_RING_SIZE - index;
+    const size_t free = SGHZ_RX_RING_SIZE - sghz_rx_used(rx);
+    *space = contiguous < free ? contiguous : free;
+    return &rx->ring[index];
+}
+
+/**
+ * @brief      Add the bytes written at sghz_rx_write_ptr.
+ * @param      rx   the SghzRx object
+ * @param      len  the number of bytes written
+*/
+void sghz_rx_commit(SghzRx* rx, size_t len) {
+    rx->head += len;
+    rx->bytes += len;
+    rx->last_rx_tick = furi_get_tick();
+}
+
+/**
+ * @brief      Count bytes that were read but didn't fit in the ring.
+*/
+void sghz_rx_drop(SghzRx* rx, size_t len) {
+    rx->bytes += len;
+    rx->drops += len;
+}
+
+/**
+ * @brief      Extract the next complete frame.
+ * @details    A binary frame starts with SGHZ_FRAME_MAGIC, its length comes from the
+ *             presence bitmap and its CRC must match. A FEC frame starts with
+ *             SGHZ_FEC_MAGIC and is returned as the binary frame it carries. An ASCII frame
+ *             starts with two digits followed by a lowercase tag and is SGHZ_ASCII_FRAME_SIZE
+ *             long. Anything else is skipped one byte at a time until a frame start is found.
+ * @param      rx     the SghzRx object
+ * @param      frame  filled with the frame, at least SGHZ_ASCII_FRAME_SIZE bytes
+ * @param      len    filled with the frame length
+ * @return     the frame type, SghzRxNone if no complete frame is available yet
+*/
+SghzRxType sghz_rx_next(SghzRx* rx, uint8_t* frame, size_t* len) {
+    while(sghz_rx_used(rx) > 0) {
+        const size_t used = sghz_rx_used(rx);
+        const uint8_t first = sghz_rx_peek(rx, 0);
+
+        if(first == SGHZ_FRAME_MAGIC) {
+            if(used < SGHZ_FRAME_HEADER_SIZE) {
+                return SghzRxNone;
+            }
+            if(sghz_rx_peek(rx, 1) != SGHZ_FRAME_VERSION) {
+                sghz_rx_resync(rx);
+                continue;
+            }
+            const size_t frame_len =
+                sghz_frame_length(sghz_rx_peek(rx, 3), sghz_rx_peek(rx, 4));
+            if(used < frame_len) {
+                return SghzRxNone;
+            }
+            for(size_t i = 0; i < frame_len; i++) {
+                frame[i] = sghz_rx_peek(rx, i);
+            }
+            const uint16_t crc = frame[frame_len - 2] | (uint16_t)frame[frame_len - 1] << 8;
+            if(crc != sghz_frame_crc16(frame, frame_len - SGHZ_FRAME_CRC_SIZE)) {
+                // Corrupted, or the magic byte was part of something else
+                rx->crc_errors++;
+                sghz_rx_resync(rx);
+                continue;
+            }
+            rx->tail += frame_len;
+            rx->frames++;
+            *len = frame_len;
+            return SghzRxBinary;
+        }
+
+        if(first == SGHZ_FEC_MAGIC) {
+            if(used < SGHZ_FEC_FRAME_SIZE) {
+                return SghzRxNone;
+            }
+            uint8_t coded[SGHZ_FEC_FRAME_SIZE];
+            for(size_t i = 0; i < SGHZ_FEC_FRAME_SIZE; i++) {
+                coded[i] = sghz_rx_peek(rx, i);
+            }
+            const int32_t corrected = sghz_fec_decode(coded, frame);
+            const size_t frame_len = sghz_frame_length(frame[3], frame[4]);
+            if(corrected < 0 || frame[0] != SGHZ_FRAME_MAGIC || frame[1] != SGHZ_FRAME_VERSION ||
+               frame_len > SGHZ_FRAME_MAX_SIZE) {
+                sghz_rx_resync(rx);
+                continue;
+            }
+            const uint16_t crc = frame[frame_len - 2] | (uint16_t)frame[frame_len - 1] << 8;
+            if(crc != sghz_frame_crc16(frame, frame_len - SGHZ_FRAME_CRC_SIZE)) {
+                rx->crc_errors++;
+                sghz_rx_resync(rx);
+                continue;
+            }
+            rx->tail += SGHZ_FEC_FRAME_SIZE;
+            rx->frames++;
+            rx->fec_frames++;
+            rx->fec_corrected += corrected;
+            *len = frame_len;
+            return SghzRxBinary;
+        }
+
+        if(first >= '0' && first <= '9') {
+            // Counter and first tag must be there to tell if this is a frame start
+            const size_t check_len = used < 4 ? used : 4;
+            bool valid = true;
+            for(size_t i = 1; i < check_len; i++) {
+                const uint8_t c = sghz_rx_peek(rx, i);
+                valid &= i < 2 ? (c >= '0' && c <= '9') : (c >= 'a' && c <= 'z');
+            }
+            if(!valid) {
+                sghz_rx_resync(rx);
+                continue;
+            }
+            if(used < SGHZ_ASCII_FRAME_SIZE) {
+                return SghzRxNone;
+            }
+            sghz_rx_pop(rx, frame, SGHZ_ASCII_FRAME_SIZE);
+            *len = SGHZ_ASCII_FRAME_SIZE;
+            return SghzRxAscii;
+        }
+
+        sghz_rx_resync(rx);
+    }
+
+    return SghzRxNone;
+}
+
+void sghz_rx_log(SghzRx* rx) {
+    FURI_LOG_I(
+        SGHZ_RX_TAG,
+        "Bytes: %lu, frames: %lu, resyncs: %lu, drops: %lu, CRC errors: %lu, FEC frames: %lu, "
+        "corrected bits: %lu",
+        rx->bytes,
+        rx->frames,
+        rx->resyncs,
+        rx->drops,
+        rx->crc_errors,
+        rx->fec_frames,
+        rx->fec_corrected);
+}
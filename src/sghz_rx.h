@@ -0,0 +1,22 @@
+#pragma once
+#include "app.h"
+#include "sghz_frame.h"
+#include "sghz_fec.h"
+
+#define SGHZ_RX_TAG "SGHZ_RX"
+
+// A frame not completed within this time is dropped
+#define SGHZ_RX_GAP_MS 500U
+
+typedef enum {
+    SghzRxNone,
+    SghzRxBinary,
+    SghzRxAscii,
+} SghzRxType;
+
+void sghz_rx_reset(SghzRx* rx);
+uint8_t* sghz_rx_write_ptr(SghzRx* rx, size_t* space);
+void sghz_rx_commit(SghzRx* rx, size_t len);
+void sghz_rx_drop(SghzRx* rx, size_t len);
+SghzRxType sghz_rx_next(SghzRx* rx, uint8_t* frame, size_t* len);
+void sghz_rx_log(SghzRx* rx);
@@ -0,0 +1,146 @@
+#include "sghz_sched.h"
+
+/**
+ * @brief      Check if an interval is within a quarter of the expected period.
+*/
+static bool sghz_sched_close(uint32_t interval_ms, uint32_t period_ms) {
+    const uint32_t diff =
+        interval_ms > period_ms ? interval_ms - period_ms : period_ms - interval_ms;
+    return diff <= period_ms / 4;
+}
+
+/**
+ * @brief      Index of the first window, at k periods from the last frame, not closed yet.
+*/
+static uint32_t sghz_sched_next_window(uint32_t since, uint32_t period, uint32_t window) {
+    return since < period + window ? 1 : (since - window) / period + 1;
+}
+
+/**
+ * @brief      Start listening continuously, the period is learned again.
+ * @param      sched      the SghzSched object
+ * @param      period_ms  the nominal period of the sender
+ * @param      now        the current tick
+*/
+void sghz_sched_reset(SghzSched* sched, uint32_t period_ms, uint32_t now) {
+    memset(sched, 0, sizeof(SghzSched));
+    sched->period_ms = period_ms;
+    sched->window_ms = SGHZ_SCHED_WINDOW_MS;
+    sched->radio_on = true;
+    sched->start_tick = now;
+    sched->state_tick = now;
+}
+
+/**
+ * @brief      Learn the sender period from a received frame.
+ * @details    The counter difference tells how many frames were missed, so the interval is
+ *             divided by it. Repeated counters are ignored. Once locked, intervals far from
+ *             the period are ignored and the others slowly correct it.
+ * @param      sched    the SghzSched object
+ * @param      now      the tick the frame was received at
+ * @param      counter  the frame counter
+ * @param      modulus  the counter wraps at this value
+*/
+void sghz_sched_on_frame(SghzSched* sched, uint32_t now, uint8_t counter, uint16_t modulus) {
+    if(sched->have_last) {
+        const uint16_t steps = (counter + modulus - sched->last_counter % modulus) % modulus;
+        if(steps == 0) {
+            return;
+        }
+        const uint32_t interval_ms = (now - sched->last_rx_tick) / steps;
+        if(interval_ms >= SGHZ_SCHED_MIN_PERIOD_MS && interval_ms <= SGHZ_SCHED_MAX_PERIOD_MS) {
+            if(!sched->locked) {
+                sched->samples = sghz_sched_close(interval_ms, sched->period_ms) ?
+                                     sched->samples + 1 :
+                                     1;
+                sched->period_ms = interval_ms;
+                if(sched->samples >= SGHZ_SCHED_LOCK_SAMPLES) {
+                    sched->locked = true;
+                    FURI_LOG_I(SGHZ_SCHED_TAG, "Locked on period %lums", sched->period_ms);
+                }
+            } else if(sghz_sched_close(interval_ms, sched->period_ms)) {
+                sched->period_ms = (int32_t)sched->period_ms +
+                                   ((int32_t)interval_ms - (int32_t)sched->period_ms) / 4;
+            }
+        }
+    }
+
+    sched->have_last = true;
+    sched->last_counter = counter;
+    sched->last_rx_tick = now;
+    sched->misses = 0;
+    sched->window_ms = SGHZ_SCHED_WINDOW_MS;
+}
+
+/**
+ * @brief      Decide if the radio must be on now and when to check again.
+ * @details    The listen window is centered on the next expected frame. Each missed window
+ *             doubles its width, after SGHZ_SCHED_MAX_MISSES the period is learned again
+ *             listening continuously.
+ * @param      sched    the SghzSched object
+ * @param      now      the current tick
+ * @param      wait_ms  filled with the time until the next change
+ * @return     true if the radio must be on
+*/
+bool sghz_sched_update(SghzSched* sched, uint32_t now, uint32_t* wait_ms) {
+    bool radio_on = true;
+    *wait_ms = SGHZ_SCHED_IDLE_MS;
+
+    if(sched->locked) {
+        const uint32_t since = now - sched->last_rx_tick;
+        const uint32_t period = sched->period_ms;
+        uint32_t k = sghz_sched_next_window(since, period, sched->window_ms);
+        if(k - 1 > sched->misses) {
+            sched->misses = k - 1;
+            sched->window_ms = SGHZ_SCHED_WINDOW_MS << sched->misses;
+            if(sched->window_ms > period / 2) {
+                sched->window_ms = period / 2;
+            }
+            FURI_LOG_I(
+                SGHZ_SCHED_TAG, "Missed %u frames, window %lums", sched->misses, sched->window_ms);
+        }
+
+        if(sched->misses > SGHZ_SCHED_MAX_MISSES) {
+            FURI_LOG_I(SGHZ_SCHED_TAG, "Lost the sender, listening continuously");
+            sched->locked = false;
+            sched->samples = 0;
+            sched->window_ms = SGHZ_SCHED_WINDOW_MS;
+        } else {
+            k = sghz_sched_next_window(since, period, sched->window_ms);
+            const uint32_t open = k * period - sched->window_ms;
+            const uint32_t close = k * period + sched->window_ms;
+            radio_on = since >= open;
+            *wait_ms = radio_on ? close - since : open - since;
+        }
+    }
+
+    if(*wait_ms < SGHZ_SCHED_MIN_WAIT_MS) {
+        *wait_ms = SGHZ_SCHED_MIN_WAIT_MS;
+    }
+    if(radio_on != sched->radio_on) {
+        if(sched->radio_on) {
+            sched->on_ms += now - sched->state_tick;
+        }
+        sched->radio_on = radio_on;
+        sched->state_tick = now;
+    }
+
+    return radio_on;
+}
+
+/**
+ * @brief      Log the radio on time against the total listening time.
+*/
+void sghz_sched_log(SghzSched* sched, uint32_t now) {
+    const uint32_t total_ms = now - sched->start_tick;
+    const uint32_t on_ms = sched->on_ms + (sched->radio_on ? now - sched->state_tick : 0);
+    const uint32_t permille = total_ms ? (uint64_t)on_ms * 1000 / total_ms : 1000;
+    FURI_LOG_I(
+        SGHZ_SCHED_TAG,
+        "Radio on %lums of %lums (%lu.%lu%%), period %lums",
+        on_ms,
+        total_ms,
+        permille / 10,
+        permille % 10,
+        sched->period_ms);
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "app.h"
+
+#define SGHZ_SCHED_TAG "SGHZ_SCHED"
+
+// Half width of the listen window around an expected frame
+#define SGHZ_SCHED_WINDOW_MS     300U
+#define SGHZ_SCHED_MIN_PERIOD_MS 1000U
+#define SGHZ_SCHED_MAX_PERIOD_MS 60000U
+// Consistent intervals needed before the radio starts sleeping
+#define SGHZ_SCHED_LOCK_SAMPLES 2U
+// Missed windows in a row before going back to continuous listening
+#define SGHZ_SCHED_MAX_MISSES 3U
+// Wake up period while listening continuously
+#define SGHZ_SCHED_IDLE_MS 1000U
+#define SGHZ_SCHED_MIN_WAIT_MS 10U
+
+void sghz_sched_reset(SghzSched* sched, uint32_t period_ms, uint32_t now);
+void sghz_sched_on_frame(SghzSched* sched, uint32_t now, uint8_t counter, uint16_t modulus);
+bool sghz_sched_update(SghzSched* sched, uint32_t now, uint32_t* wait_ms);
+void sghz_sched_log(SghzSched* sched, uint32_t now);
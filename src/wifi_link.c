@@ -0,0 +1,174 @@
+#include "wifi_link.h"
+
+/**
+ * @brief      Allocate the WiFi link cache, nothing is associated yet.
+ * @return     WifiLink object.
+*/
+WifiLink* wifi_link_alloc() {
+    WifiLink* link = malloc(sizeof(WifiLink));
+    link->ssid = furi_string_alloc();
+    link->pass = furi_string_alloc();
+    link->associated = false;
+    link->fhttp = NULL;
+    link->probe_done = furi_event_flag_alloc();
+    link->probing = false;
+    link->probe_up = false;
+    link->joins = 0;
+    link->skips = 0;
+    return link;
+}
+
+void wifi_link_free(WifiLink* link) {
+    FURI_LOG_I(WIFI_LINK_TAG, "Associations: %lu, skipped: %lu", link->joins, link->skips);
+    furi_string_free(link->ssid);
+    furi_string_free(link->pass);
+    furi_event_flag_free(link->probe_done);
+    free(link);
+}
+
+/**
+ * @brief      Check if the credentials are the last ones sent to the ESP32.
+ * @param      link  the WifiLink object
+ * @param      ssid  the network
+ * @param      pass  the password of the network
+ * @return     true if they match and were sent, the association may still fail
+*/
+bool wifi_link_matches(const WifiLink* link, FuriString* ssid, FuriString* pass) {
+    return link->associated && furi_string_equal(link->ssid, ssid) &&
+           furi_string_equal(link->pass, pass);
+}
+
+/**
+ * @brief      Parse the answer to the address request.
+ * @param      line  a line received from the ESP32
+ * @param      ip    filled with the address
+ * @return     true if the line is an IPv4 address and nothing else
+*/
+bool wifi_link_parse_ip(const char* line, uint8_t ip[4]) {
+    while(*line == ' ') {
+        line++;
+    }
+    for(size_t i = 0; i < 4; i++) {
+        if(i > 0 && *line++ != '.') {
+            return false;
+        }
+        uint16_t part = 0;
+        size_t digits = 0;
+        for(; *line >= '0' && *line <= '9' && digits < 4; line++, digits++) {
+            part = part * 10 + (*line - '0');
+        }
+        if(digits == 0 || digits > 3 || part > UINT8_MAX) {
+            return false;
+        }
+        ip[i] = part;
+    }
+    // Trailing spaces or line ending only
+    while(*line == ' ' || *line == '\r' || *line == '\n') {
+        line++;
+    }
+    return *line == '\0';
+}
+
+/**
+ * @brief      Line callback of FlipperHTTP, takes the answer of a probe.
+ * @details    The answer is not passed on, so it doesn't replace last_response, which may
+ *             hold a response prefetched by the warm backend. Runs on the UART thread.
+ * @param      line     the received line
+ * @param      context  the WifiLink object
+*/
+static void wifi_link_rx_line(const char* line, void* context) {
+    WifiLink* link = context;
+    if(link->probing) {
+        uint8_t ip[4];
+        const bool up = wifi_link_parse_ip(line, ip);
+        // 0.0.0.0 or an error: the ESP32 isn't associated
+        if(up || strstr(line, "[ERROR]") != NULL) {
+            link->probe_up = up && (ip[0] | ip[1] | ip[2] | ip[3]) != 0;
+            link->probing = false;
+            furi_event_flag_set(link->probe_done, WIFI_LINK_PROBE_DONE);
+            return;
+        }
+    }
+    flipper_http_rx_callback(line, link->fhttp);
+}
+
+/**
+ * @brief      Route the lines of the ESP32 through the link, so probes get their answer.
+ * @param      link   the WifiLink object
+ * @param      fhttp  the FlipperHTTP object, its lines still reach flipper_http_rx_callback
+*/
+void wifi_link_attach(WifiLink* link, FlipperHTTP* fhttp) {
+    link->fhttp = fhttp;
+    fhttp->callback_context = link;
+    fhttp->handle_rx_line_cb = wifi_link_rx_line;
+}
+
+/**
+ * @brief      Ask the ESP32 for its address on the network, waiting for the answer.
+ * @details    Sending the credentials only says the UART command went out, this tells if the
+ *             association actually went through. Blocks up to WIFI_LINK_PROBE_MS, so it must
+ *             run on a worker thread.
+ * @param      link   the WifiLink object
+ * @param      fhttp  the FlipperHTTP object
+ * @return     true if the ESP32 has an address
+*/
+static bool wifi_link_probe(WifiLink* link, FlipperHTTP* fhttp) {
+    furi_event_flag_clear(link->probe_done, WIFI_LINK_PROBE_DONE);
+    link->probe_up = false;
+    link->probing = true;
+    if(!flipper_http_ip_wifi(fhttp)) {
+        link->probing = false;
+        return false;
+    }
+    const uint32_t done = furi_event_flag_wait(
+        link->probe_done,
+        WIFI_LINK_PROBE_DONE,
+        FuriFlagWaitAny,
+        furi_ms_to_ticks(WIFI_LINK_PROBE_MS));
+    link->probing = false;
+    if(done & FuriFlagError) {
+        FURI_LOG_W(WIFI_LINK_TAG, "No answer to the address request");
+        return false;
+    }
+    return link->probe_up;
+}
+
+/**
+ * @brief      Make sure the ESP32 is associated to the given network.
+ * @details    The save command, and so the association, is skipped when the credentials
+ *             match the last ones sent and the ESP32 still reports an address. A failed
+ *             association is never cached: the probe fails and the credentials are sent again.
+ *             May wait for the probe, call it from a worker thread.
+ * @param      link   the WifiLink object
+ * @param      fhttp  the FlipperHTTP object
+ * @param      ssid   the network to join
+ * @param      pass   the password of the network
+ * @return     true if the link is up or the save command was sent
+*/
+bool wifi_link_join(WifiLink* link, FlipperHTTP* fhttp, FuriString* ssid, FuriString* pass) {
+    if(fhttp->state != ISSUE && fhttp->state != INACTIVE && wifi_link_matches(link, ssid, pass)) {
+        if(wifi_link_probe(link, fhttp)) {
+            link->skips++;
+            FURI_LOG_I(
+                WIFI_LINK_TAG,
+                "Already associated to ssid: %s, skipping",
+                furi_string_get_cstr(ssid));
+            return true;
+        }
+        FURI_LOG_W(WIFI_LINK_TAG, "Link to ssid: %s is down", furi_string_get_cstr(ssid));
+    }
+
+    link->associated =
+        flipper_http_save_wifi(fhttp, furi_string_get_cstr(ssid), furi_string_get_cstr(pass));
+    if(link->associated) {
+        furi_string_set(link->ssid, ssid);
+        furi_string_set(link->pass, pass);
+        link->joins++;
+        FURI_LOG_I(
+            WIFI_LINK_TAG, "Attempting connection to ssid: %s", furi_string_get_cstr(ssid));
+    } else {
+        FURI_LOG_E(WIFI_LINK_TAG, "Failed to send WiFi credentials");
+    }
+
+    return link->associated;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "app.h"
+
+#define WIFI_LINK_TAG "WIFI_LINK"
+
+// Wait for the ESP32 to report its address before trusting a previous association
+#define WIFI_LINK_PROBE_MS   1000U
+#define WIFI_LINK_PROBE_DONE 0b00000001
+
+WifiLink* wifi_link_alloc();
+void wifi_link_free(WifiLink* link);
+void wifi_link_attach(WifiLink* link, FlipperHTTP* fhttp);
+bool wifi_link_parse_ip(const char* line, uint8_t ip[4]);
+bool wifi_link_matches(const WifiLink* link, FuriString* ssid, FuriString* pass);
+bool wifi_link_join(WifiLink* link, FlipperHTTP* fhttp, FuriString* ssid, FuriString* pass);
@@ -0,0 +1,50 @@
+#include <furi.h>
+#include "ha_history.h"
+
+#define RESOLUTION_S 60U
+#define PUSHES       100000U
+#define SCANS        10000U
+
+/**
+ * Append and scan cost of the history ring. Host numbers, only useful to compare changes:
+ * the Flipper is roughly two orders of magnitude slower.
+*/
+int main(void) {
+    HaHistory* history = ha_history_alloc(RESOLUTION_S);
+    HaSnapshot snapshot = {0};
+    snapshot.valid = (1 << HaEntityCount) - 1;
+    srand(1);
+
+    uint32_t start = furi_host_time_us();
+    for(uint32_t i = 0; i < PUSHES; i++) {
+        snapshot.timestamp = 1700000000U + i * RESOLUTION_S;
+        for(size_t e = 0; e < HaEntityCount; e++) {
+            // Mostly small steps with a jump now and then, like real sensors
+            snapshot.values[e] = rand() % 50 == 0 ? rand() % 2000 :
+                                                    snapshot.values[e] + rand() % 7 - 3;
+        }
+        ha_history_push(history, &snapshot);
+    }
+    const uint32_t push_us = furi_host_time_us() - start;
+
+    HaHistoryStats stats;
+    volatile uint32_t sink = 0;
+    start = furi_host_time_us();
+    for(uint32_t i = 0; i < SCANS; i++) {
+        ha_history_stats(history, i % HaEntityCount, &stats);
+        sink += stats.max;
+    }
+    const uint32_t scan_us = furi_host_time_us() - start;
+
+    printf(
+        "ha_history: push %.1f ns (%u entities), scan %.1f ns (%u samples), "
+        "%u clamped, %zu bytes\n",
+        push_us * 1000.0 / PUSHES,
+        HaEntityCount,
+        scan_us * 1000.0 / SCANS,
+        HA_HISTORY_SAMPLES,
+        history->clamped,
+        sizeof(HaHistory));
+    ha_history_free(history);
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <furi.h>
+#include "sghz_ascii.h"
+
+#define ROUNDS 1000000U
+
+static const char MESSAGE[] = "00bt21.5bh45.0kt19.8kh50.2ot-3.2oh88.1co 412pm  12dhon  adoff ";
+
+/**
+ * Parse cost of a full ASCII message, with the values unchanged and with a new value in
+ * every message. Host numbers, only useful to compare changes.
+*/
+int main(void) {
+    HaSnapshot snapshot = {0};
+    uint8_t last_counter = UINT8_MAX;
+    SghzAsciiPrints prints;
+    for(size_t e = 0; e < HaEntityCount; e++) {
+        prints.values[e] = furi_string_alloc();
+    }
+    prints.dehum_sts = furi_string_alloc();
+    char message[sizeof(MESSAGE)];
+    memcpy(message, MESSAGE, sizeof(message));
+    volatile uint32_t sink = 0;
+
+    uint32_t start = furi_host_time_us();
+    for(uint32_t i = 0; i < ROUNDS; i++) {
+        // Only the counter changes, so the strings are left as they are
+        message[1] = '0' + i % 10;
+        sink += sghz_ascii_parse(message, &last_counter, &snapshot, &prints);
+    }
+    const uint32_t same_us = furi_host_time_us() - start;
+
+    start = furi_host_time_us();
+    for(uint32_t i = 0; i < ROUNDS; i++) {
+        message[1] = '0' + i % 10;
+        // The last digit of the bedroom temperature
+        message[7] = '0' + i % 10;
+        sink += sghz_ascii_parse(message, &last_counter, &snapshot, &prints);
+    }
+    const uint32_t changed_us = furi_host_time_us() - start;
+
+    start = furi_host_time_us();
+    for(uint32_t i = 0; i < ROUNDS; i++) {
+        sink += sghz_ascii_parse(message, &last_counter, &snapshot, &prints);
+    }
+    const uint32_t repeat_us = furi_host_time_us() - start;
+
+    printf(
+        "ha_sghz_parse: unchanged %.0f ns, one value changed %.0f ns, repeated counter %.0f ns "
+        "(%zu bytes)\n",
+        same_us * 1000.0 / ROUNDS,
+        changed_us * 1000.0 / ROUNDS,
+        repeat_us * 1000.0 / ROUNDS,
+        sizeof(MESSAGE) - 1);
+    for(size_t e = 0; e < HaEntityCount; e++) {
+        furi_string_free(prints.values[e]);
+    }
+    furi_string_free(prints.dehum_sts);
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include <furi.h>
+#include "ha_telemetry.h"
+
+#define RECORDS 20000U
+#define SEEKS   20000U
+#define START   1700000000U
+
+/**
+ * Write and seek cost of the telemetry log on the host file system. The seek count of file
+ * reads is what carries over to the SD card: one per index probe plus one per record probe.
+*/
+int main(void) {
+    storage_simply_remove(NULL, HA_TELEMETRY_LOG_PATH);
+    storage_simply_remove(NULL, HA_TELEMETRY_IDX_PATH);
+    HaTelemetry* telemetry = ha_telemetry_alloc();
+    HaSnapshot snapshot = {0};
+    snapshot.valid = 1 << HaEntityBedroomTemp;
+    HaTelemetryRecord record;
+
+    uint32_t start = furi_host_time_us();
+    for(uint32_t n = 0; n < RECORDS; n++) {
+        snapshot.timestamp = START + n * HA_TELEMETRY_MIN_PERIOD_S;
+        snapshot.values[HaEntityBedroomTemp] = n % 300;
+        ha_telemetry_append(telemetry, &snapshot, HaCtrlWifi, false);
+        // Stay under the queue size, the writer would drop records
+        if(n % (HA_TELEMETRY_QUEUE_SIZE / 2) == 0) {
+            while(!ha_telemetry_read(telemetry, n, &record)) {
+            }
+        }
+    }
+    while(!ha_telemetry_read(telemetry, RECORDS - 1, &record)) {
+    }
+    const uint32_t write_us = furi_host_time_us() - start;
+
+    srand(1);
+    volatile uint32_t sink = 0;
+    start = furi_host_time_us();
+    for(uint32_t i = 0; i < SEEKS; i++) {
+        sink += ha_telemetry_seek(
+            telemetry, START + rand() % (RECORDS * HA_TELEMETRY_MIN_PERIOD_S));
+    }
+    const uint32_t seek_us = furi_host_time_us() - start;
+
+    printf(
+        "ha_telemetry: write %.2f us/record (%u dropped, %u bytes), seek %.2f us "
+        "(%u records, %u index entries)\n",
+        (double)write_us / RECORDS,
+        telemetry->dropped,
+        telemetry->bytes_written,
+        (double)seek_us / SEEKS,
+        RECORDS,
+        telemetry->index_len);
+    ha_telemetry_free(telemetry);
+
+    start = furi_host_time_us();
+    telemetry = ha_telemetry_alloc();
+    ha_telemetry_load_last(telemetry, &snapshot);
+    printf("ha_telemetry: reopen %u us\n", furi_host_time_us() - start);
+    ha_telemetry_free(telemetry);
+    return 0;
+}
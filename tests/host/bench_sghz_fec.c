@@ -0,0 +1,50 @@
+#include <furi.h>
+#include "sghz_fec.h"
+
+#define ROUNDS 100000U
+
+/**
+ * Encode and decode cost of a full FEC frame, clean and with one error per codeword.
+ * Host numbers, only useful to compare changes.
+*/
+int main(void) {
+    HaSnapshot snapshot = {0};
+    snapshot.valid = (1 << HaEntityCount) - 1;
+    uint8_t frame[SGHZ_FRAME_MAX_SIZE];
+    const size_t len = sghz_frame_encode(&snapshot, 0, frame, sizeof(frame));
+    uint8_t coded[SGHZ_FEC_FRAME_SIZE];
+    volatile uint32_t sink = 0;
+
+    uint32_t start = furi_host_time_us();
+    for(uint32_t i = 0; i < ROUNDS; i++) {
+        frame[2] = i;
+        sink += sghz_fec_encode(frame, len, coded, sizeof(coded));
+    }
+    const uint32_t encode_us = furi_host_time_us() - start;
+
+    uint8_t out[SGHZ_FRAME_MAX_SIZE];
+    start = furi_host_time_us();
+    for(uint32_t i = 0; i < ROUNDS; i++) {
+        sink += sghz_fec_decode(coded, out);
+    }
+    const uint32_t decode_us = furi_host_time_us() - start;
+
+    for(size_t bit = 0; bit < SGHZ_FEC_CODED_SIZE; bit++) {
+        coded[1 + bit / 8] ^= 1 << (bit % 8);
+    }
+    start = furi_host_time_us();
+    for(uint32_t i = 0; i < ROUNDS; i++) {
+        sink += sghz_fec_decode(coded, out);
+    }
+    const uint32_t corrupted_us = furi_host_time_us() - start;
+
+    printf(
+        "sghz_fec: encode %.0f ns, decode %.0f ns, decode with %u errors %.0f ns "
+        "(%u bytes on air)\n",
+        encode_us * 1000.0 / ROUNDS,
+        decode_us * 1000.0 / ROUNDS,
+        SGHZ_FEC_CODED_SIZE,
+        corrupted_us * 1000.0 / ROUNDS,
+        SGHZ_FEC_FRAME_SIZE);
+    return 0;
+}
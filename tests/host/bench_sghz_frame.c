@@ -0,0 +1,64 @@
+#include <furi.h>
+#include "sghz_frame.h"
+
+#define ROUNDS 1000000U
+
+/**
+ * Encode and decode cost of the binary frame, with every value and with half of them.
+ * Host numbers, only useful to compare changes.
+*/
+int main(void) {
+    HaSnapshot snapshot = {0};
+    snapshot.valid = (1 << HaEntityCount) - 1;
+    for(size_t e = 0; e < HaEntityCount; e++) {
+        snapshot.values[e] = (int16_t)(e * 1111 - 2000);
+    }
+    uint8_t frame[SGHZ_FRAME_MAX_SIZE];
+    volatile uint32_t sink = 0;
+
+    uint32_t start = furi_host_time_us();
+    for(uint32_t i = 0; i < ROUNDS; i++) {
+        sink += sghz_frame_encode(&snapshot, i, frame, sizeof(frame));
+    }
+    const uint32_t encode_us = furi_host_time_us() - start;
+    const size_t full_len = sghz_frame_encode(&snapshot, 0, frame, sizeof(frame));
+
+    HaSnapshot out;
+    uint8_t counter;
+    int16_t ack;
+    start = furi_host_time_us();
+    for(uint32_t i = 0; i < ROUNDS; i++) {
+        sink += sghz_frame_decode(frame, full_len, &out, &counter, &ack);
+        sink += out.values[i % HaEntityCount];
+    }
+    const uint32_t decode_us = furi_host_time_us() - start;
+
+    // Every other value missing
+    snapshot.valid = 0x55 & ((1 << HaEntityCount) - 1);
+    const size_t half_len = sghz_frame_encode(&snapshot, 0, frame, sizeof(frame));
+    start = furi_host_time_us();
+    for(uint32_t i = 0; i < ROUNDS; i++) {
+        sink += sghz_frame_decode(frame, half_len, &out, &counter, &ack);
+        sink += out.valid;
+    }
+    const uint32_t half_us = furi_host_time_us() - start;
+
+    // A corrupted frame still pays for the CRC
+    frame[half_len - 1] ^= 1;
+    start = furi_host_time_us();
+    for(uint32_t i = 0; i < ROUNDS; i++) {
+        sink += sghz_frame_decode(frame, half_len, &out, &counter, &ack);
+    }
+    const uint32_t bad_us = furi_host_time_us() - start;
+
+    printf(
+        "sghz_frame: encode %.0f ns, decode %.0f ns (%zu bytes), decode partial %.0f ns "
+        "(%zu bytes), reject bad CRC %.0f ns\n",
+        encode_us * 1000.0 / ROUNDS,
+        decode_us * 1000.0 / ROUNDS,
+        full_len,
+        half_us * 1000.0 / ROUNDS,
+        half_len,
+        bad_us * 1000.0 / ROUNDS);
+    return 0;
+}
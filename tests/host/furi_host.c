@@ -0,0 +1,692 @@
+#include <furi.h>
+#include <furi_hal_bt.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+bool furi_host_log = false;
+uint32_t furi_host_canvas_ops = 0;
+
+void furi_host_crash(const char* expr, const char* file, int line) {
+    fprintf(stderr, "furi_check failed: %s at %s:%d\n", expr, file, line);
+    abort();
+}
+
+// Kernel
+
+static uint32_t furi_host_tick;
+
+uint32_t furi_get_tick(void) {
+    return __atomic_load_n(&furi_host_tick, __ATOMIC_RELAXED);
+}
+
+void furi_host_set_tick(uint32_t tick) {
+    __atomic_store_n(&furi_host_tick, tick, __ATOMIC_RELAXED);
+}
+
+uint32_t furi_host_time_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000U + now.tv_nsec / 1000U;
+}
+
+void furi_delay_ms(uint32_t ms) {
+    usleep(ms * 1000U);
+}
+
+void furi_thread_yield(void) {
+    sched_yield();
+}
+
+uint32_t furi_hal_random_get(void) {
+    return (uint32_t)rand();
+}
+
+void furi_hal_random_fill_buf(uint8_t* buffer, uint32_t len) {
+    for(uint32_t i = 0; i < len; i++) {
+        buffer[i] = rand();
+    }
+}
+
+FuriStatus furi_timer_start(FuriTimer* timer, uint32_t ticks) {
+    UNUSED(timer);
+    UNUSED(ticks);
+    return FuriStatusOk;
+}
+
+/**
+ * @brief      Absolute deadline of a wait, timeouts run on the real clock, not the tick.
+*/
+static struct timespec furi_host_deadline(uint32_t timeout) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout / 1000U;
+    deadline.tv_nsec += (long)(timeout % 1000U) * 1000000L;
+    if(deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return deadline;
+}
+
+/**
+ * @brief      Wait on a condition, the mutex must be held. False on timeout.
+*/
+static bool furi_host_cond_wait(
+    pthread_cond_t* cond,
+    pthread_mutex_t* mutex,
+    const struct timespec* deadline,
+    uint32_t timeout) {
+    if(timeout == FuriWaitForever) {
+        pthread_cond_wait(cond, mutex);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, mutex, deadline) != ETIMEDOUT;
+}
+
+struct FuriMutex {
+    pthread_mutex_t mutex;
+};
+
+FuriMutex* furi_mutex_alloc(FuriMutexType type) {
+    furi_check(type == FuriMutexTypeNormal);
+    FuriMutex* mutex = malloc(sizeof(FuriMutex));
+    pthread_mutex_init(&mutex->mutex, NULL);
+    return mutex;
+}
+
+void furi_mutex_free(FuriMutex* mutex) {
+    pthread_mutex_destroy(&mutex->mutex);
+    free(mutex);
+}
+
+FuriStatus furi_mutex_acquire(FuriMutex* mutex, uint32_t timeout) {
+    if(timeout == FuriWaitForever) {
+        return pthread_mutex_lock(&mutex->mutex) == 0 ? FuriStatusOk : FuriStatusError;
+    }
+    if(timeout == 0) {
+        return pthread_mutex_trylock(&mutex->mutex) == 0 ? FuriStatusOk :
+                                                           FuriStatusErrorTimeout;
+    }
+    struct timespec deadline = furi_host_deadline(timeout);
+    return pthread_mutex_timedlock(&mutex->mutex, &deadline) == 0 ? FuriStatusOk :
+                                                                    FuriStatusErrorTimeout;
+}
+
+FuriStatus furi_mutex_release(FuriMutex* mutex) {
+    return pthread_mutex_unlock(&mutex->mutex) == 0 ? FuriStatusOk : FuriStatusError;
+}
+
+// Flags shared by the event flags and the thread flags
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint32_t flags;
+} FuriHostFlags;
+
+static void furi_host_flags_init(FuriHostFlags* flags) {
+    pthread_mutex_init(&flags->mutex, NULL);
+    pthread_cond_init(&flags->cond, NULL);
+    flags->flags = 0;
+}
+
+static void furi_host_flags_deinit(FuriHostFlags* flags) {
+    pthread_cond_destroy(&flags->cond);
+    pthread_mutex_destroy(&flags->mutex);
+}
+
+static uint32_t furi_host_flags_set(FuriHostFlags* flags, uint32_t set) {
+    pthread_mutex_lock(&flags->mutex);
+    flags->flags |= set;
+    const uint32_t ret = flags->flags;
+    pthread_cond_broadcast(&flags->cond);
+    pthread_mutex_unlock(&flags->mutex);
+    return ret;
+}
+
+static uint32_t
+    furi_host_flags_wait(FuriHostFlags* flags, uint32_t wait, uint32_t options, uint32_t timeout) {
+    const struct timespec deadline = furi_host_deadline(timeout == FuriWaitForever ? 0 : timeout);
+    uint32_t ret = FuriFlagErrorTimeout;
+    pthread_mutex_lock(&flags->mutex);
+    while(true) {
+        const uint32_t match = flags->flags & wait;
+        if((options & FuriFlagWaitAll) ? match == wait : match != 0) {
+            ret = flags->flags;
+            if(!(options & FuriFlagNoClear)) {
+                flags->flags &= ~wait;
+            }
+            break;
+        }
+        if(timeout == 0 || !furi_host_cond_wait(&flags->cond, &flags->mutex, &deadline, timeout)) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&flags->mutex);
+    return ret;
+}
+
+struct FuriEventFlag {
+    FuriHostFlags flags;
+};
+
+FuriEventFlag* furi_event_flag_alloc(void) {
+    FuriEventFlag* flag = malloc(sizeof(FuriEventFlag));
+    furi_host_flags_init(&flag->flags);
+    return flag;
+}
+
+void furi_event_flag_free(FuriEventFlag* flag) {
+    furi_host_flags_deinit(&flag->flags);
+    free(flag);
+}
+
+uint32_t furi_event_flag_set(FuriEventFlag* flag, uint32_t flags) {
+    return furi_host_flags_set(&flag->flags, flags);
+}
+
+uint32_t
+    furi_event_flag_wait(FuriEventFlag* flag, uint32_t flags, uint32_t options, uint32_t timeout) {
+    return furi_host_flags_wait(&flag->flags, flags, options, timeout);
+}
+
+struct FuriMessageQueue {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint8_t* buffer;
+    uint32_t msg_count;
+    uint32_t msg_size;
+    uint32_t head;
+    uint32_t count;
+};
+
+FuriMessageQueue* furi_message_queue_alloc(uint32_t msg_count, uint32_t msg_size) {
+    FuriMessageQueue* queue = malloc(sizeof(FuriMessageQueue));
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->cond, NULL);
+    queue->buffer = malloc(msg_count * msg_size);
+    queue->msg_count = msg_count;
+    queue->msg_size = msg_size;
+    queue->head = 0;
+    queue->count = 0;
+    return queue;
+}
+
+void furi_message_queue_free(FuriMessageQueue* queue) {
+    pthread_cond_destroy(&queue->cond);
+    pthread_mutex_destroy(&queue->mutex);
+    free(queue->buffer);
+    free(queue);
+}
+
+FuriStatus furi_message_queue_put(FuriMessageQueue* queue, const void* msg, uint32_t timeout) {
+    const struct timespec deadline = furi_host_deadline(timeout == FuriWaitForever ? 0 : timeout);
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&queue->mutex);
+    while(queue->count == queue->msg_count) {
+        if(timeout == 0 || !furi_host_cond_wait(&queue->cond, &queue->mutex, &deadline, timeout)) {
+            status = FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) {
+        const uint32_t tail = (queue->head + queue->count) % queue->msg_count;
+        memcpy(queue->buffer + tail * queue->msg_size, msg, queue->msg_size);
+        queue->count++;
+        pthread_cond_broadcast(&queue->cond);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return status;
+}
+
+FuriStatus furi_message_queue_get(FuriMessageQueue* queue, void* msg, uint32_t timeout) {
+    const struct timespec deadline = furi_host_deadline(timeout == FuriWaitForever ? 0 : timeout);
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&queue->mutex);
+    while(queue->count == 0) {
+        if(timeout == 0 || !furi_host_cond_wait(&queue->cond, &queue->mutex, &deadline, timeout)) {
+            status = FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) {
+        memcpy(msg, queue->buffer + queue->head * queue->msg_size, queue->msg_size);
+        queue->head = (queue->head + 1) % queue->msg_count;
+        queue->count--;
+        pthread_cond_broadcast(&queue->cond);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return status;
+}
+
+struct FuriThread {
+    pthread_t thread;
+    FuriThreadCallback callback;
+    void* context;
+    FuriHostFlags flags;
+    bool started;
+};
+
+// The thread flags of the test itself, for code waiting on the caller thread
+static FuriThread furi_host_main_thread;
+static pthread_once_t furi_host_main_once = PTHREAD_ONCE_INIT;
+static __thread FuriThread* furi_host_current;
+
+static void furi_host_main_init(void) {
+    furi_host_flags_init(&furi_host_main_thread.flags);
+}
+
+static FuriThread* furi_host_thread_current(void) {
+    if(furi_host_current == NULL) {
+        pthread_once(&furi_host_main_once, furi_host_main_init);
+        furi_host_current = &furi_host_main_thread;
+    }
+    return furi_host_current;
+}
+
+FuriThread* furi_thread_alloc_ex(
+    const char* name,
+    uint32_t stack_size,
+    FuriThreadCallback callback,
+    void* context) {
+    UNUSED(name);
+    UNUSED(stack_size);
+    FuriThread* thread = malloc(sizeof(FuriThread));
+    memset(thread, 0, sizeof(FuriThread));
+    thread->callback = callback;
+    thread->context = context;
+    furi_host_flags_init(&thread->flags);
+    return thread;
+}
+
+void furi_thread_free(FuriThread* thread) {
+    furi_host_flags_deinit(&thread->flags);
+    free(thread);
+}
+
+static void* furi_host_thread_body(void* arg) {
+    FuriThread* thread = arg;
+    furi_host_current = thread;
+    thread->callback(thread->context);
+    return NULL;
+}
+
+void furi_thread_start(FuriThread* thread) {
+    furi_check(pthread_create(&thread->thread, NULL, furi_host_thread_body, thread) == 0);
+    thread->started = true;
+}
+
+bool furi_thread_join(FuriThread* thread) {
+    if(thread->started) {
+        pthread_join(thread->thread, NULL);
+        thread->started = false;
+    }
+    return true;
+}
+
+FuriThreadId furi_thread_get_id(FuriThread* thread) {
+    return thread;
+}
+
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags) {
+    return furi_host_flags_set(&thread_id->flags, flags);
+}
+
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout) {
+    return furi_host_flags_wait(&furi_host_thread_current()->flags, flags, options, timeout);
+}
+
+void* furi_record_open(const char* name) {
+    // Only the storage record, which holds no state on the host
+    furi_check(strcmp(name, RECORD_STORAGE) == 0);
+    return (void*)name;
+}
+
+void furi_record_close(const char* name) {
+    UNUSED(name);
+}
+
+// Strings
+
+struct FuriString {
+    char* data;
+    size_t size;
+    size_t capacity;
+};
+
+static void furi_host_string_reserve(FuriString* string, size_t size) {
+    if(size + 1 > string->capacity) {
+        string->capacity = (size + 1) * 2;
+        string->data = realloc(string->data, string->capacity);
+    }
+}
+
+FuriString* furi_string_alloc(void) {
+    FuriString* string = malloc(sizeof(FuriString));
+    string->data = NULL;
+    string->size = 0;
+    string->capacity = 0;
+    furi_host_string_reserve(string, 16);
+    string->data[0] = '\0';
+    return string;
+}
+
+void furi_string_free(FuriString* string) {
+    free(string->data);
+    free(string);
+}
+
+void furi_string_reset(FuriString* string) {
+    string->size = 0;
+    string->data[0] = '\0';
+}
+
+void furi_string_cat_str(FuriString* string, const char* cstr) {
+    const size_t len = strlen(cstr);
+    furi_host_string_reserve(string, string->size + len);
+    memcpy(string->data + string->size, cstr, len + 1);
+    string->size += len;
+}
+
+void furi_string_set_str(FuriString* string, const char* cstr) {
+    furi_string_reset(string);
+    furi_string_cat_str(string, cstr);
+}
+
+static int furi_host_string_vcat(FuriString* string, const char* format, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    const int len = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+    if(len > 0) {
+        furi_host_string_reserve(string, string->size + len);
+        vsnprintf(string->data + string->size, len + 1, format, args);
+        string->size += len;
+    }
+    return len;
+}
+
+int furi_string_printf(FuriString* string, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    furi_string_reset(string);
+    const int len = furi_host_string_vcat(string, format, args);
+    va_end(args);
+    return len;
+}
+
+int furi_string_cat_printf(FuriString* string, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    const int len = furi_host_string_vcat(string, format, args);
+    va_end(args);
+    return len;
+}
+
+const char* furi_string_get_cstr(const FuriString* string) {
+    return string->data;
+}
+
+size_t furi_string_size(const FuriString* string) {
+    return string->size;
+}
+
+bool furi_string_empty(const FuriString* string) {
+    return string->size == 0;
+}
+
+// Storage
+
+struct File {
+    FILE* file;
+};
+
+/**
+ * @brief      Map a Flipper path under FURI_HOST_STORAGE, or /tmp/furi_host if unset.
+*/
+const char* furi_host_storage_path(const char* path, char* out, size_t size) {
+    const char* root = getenv("FURI_HOST_STORAGE");
+    snprintf(out, size, "%s%s", root ? root : "/tmp/furi_host", path);
+    return out;
+}
+
+/**
+ * @brief      Create the missing parent directories of a host path.
+*/
+static void furi_host_make_parents(char* host) {
+    for(char* p = host + 1; *p; p++) {
+        if(*p == '/') {
+            *p = '\0';
+            mkdir(host, 0755);
+            *p = '/';
+        }
+    }
+}
+
+bool storage_simply_mkdir(Storage* storage, const char* path) {
+    UNUSED(storage);
+    char host[512];
+    furi_host_make_parents((char*)furi_host_storage_path(path, host, sizeof(host)));
+    return mkdir(host, 0755) == 0 || errno == EEXIST;
+}
+
+bool storage_simply_remove(Storage* storage, const char* path) {
+    UNUSED(storage);
+    char host[512];
+    return remove(furi_host_storage_path(path, host, sizeof(host))) == 0 || errno == ENOENT;
+}
+
+File* storage_file_alloc(Storage* storage) {
+    UNUSED(storage);
+    File* file = malloc(sizeof(File));
+    file->file = NULL;
+    return file;
+}
+
+void storage_file_free(File* file) {
+    storage_file_close(file);
+    free(file);
+}
+
+bool storage_file_open(File* file, const char* path, FS_AccessMode access, FS_OpenMode mode) {
+    char host[512];
+    furi_host_storage_path(path, host, sizeof(host));
+    // The SD card of the tests starts empty
+    furi_host_make_parents(host);
+
+    const bool write = access & FSAM_WRITE;
+    switch(mode) {
+    case FSOM_OPEN_EXISTING:
+        file->file = fopen(host, write ? "r+b" : "rb");
+        break;
+    case FSOM_OPEN_ALWAYS:
+    case FSOM_OPEN_APPEND:
+        file->file = fopen(host, "r+b");
+        if(file->file == NULL) {
+            file->file = fopen(host, "w+b");
+        }
+        if(file->file != NULL && mode == FSOM_OPEN_APPEND) {
+            fseek(file->file, 0, SEEK_END);
+        }
+        break;
+    case FSOM_CREATE_NEW:
+        file->file = fopen(host, "wx+b");
+        break;
+    case FSOM_CREATE_ALWAYS:
+        file->file = fopen(host, "w+b");
+        break;
+    }
+    return file->file != NULL;
+}
+
+bool storage_file_close(File* file) {
+    if(file->file == NULL) {
+        return false;
+    }
+    fclose(file->file);
+    file->file = NULL;
+    return true;
+}
+
+size_t storage_file_read(File* file, void* buff, size_t to_read) {
+    return file->file ? fread(buff, 1, to_read, file->file) : 0;
+}
+
+size_t storage_file_write(File* file, const void* buff, size_t to_write) {
+    return file->file ? fwrite(buff, 1, to_write, file->file) : 0;
+}
+
+bool storage_file_seek(File* file, uint32_t offset, bool from_start) {
+    return file->file && fseek(file->file, offset, from_start ? SEEK_SET : SEEK_CUR) == 0;
+}
+
+uint64_t storage_file_size(File* file) {
+    if(file->file == NULL) {
+        return 0;
+    }
+    fflush(file->file);
+    struct stat st;
+    return fstat(fileno(file->file), &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+bool storage_file_truncate(File* file) {
+    if(file->file == NULL) {
+        return false;
+    }
+    fflush(file->file);
+    return ftruncate(fileno(file->file), ftell(file->file)) == 0;
+}
+
+// Extra beacon
+
+FuriHostBeacon furi_host_beacon;
+
+static void furi_host_beacon_call(void) {
+    furi_host_beacon.calls++;
+    furi_host_set_tick(furi_get_tick() + furi_host_beacon.call_ticks);
+}
+
+bool furi_hal_bt_extra_beacon_set_config(const GapExtraBeaconConfig* config) {
+    furi_host_beacon_call();
+    // Like the firmware, the configuration can't change while advertising
+    if(furi_host_beacon.active) {
+        return false;
+    }
+    furi_host_beacon.config = *config;
+    furi_host_beacon.configured = true;
+    return true;
+}
+
+const GapExtraBeaconConfig* furi_hal_bt_extra_beacon_get_config(void) {
+    return furi_host_beacon.configured ? &furi_host_beacon.config : NULL;
+}
+
+bool furi_hal_bt_extra_beacon_set_data(const uint8_t* data, uint8_t len) {
+    if(len > EXTRA_BEACON_MAX_DATA_SIZE) {
+        return false;
+    }
+    furi_host_beacon_call();
+    memcpy(furi_host_beacon.data, data, len);
+    furi_host_beacon.data_len = len;
+    furi_host_beacon.data_sets++;
+    furi_host_beacon.on_air_tick = furi_get_tick();
+    return true;
+}
+
+uint8_t furi_hal_bt_extra_beacon_get_data(uint8_t* data) {
+    memcpy(data, furi_host_beacon.data, furi_host_beacon.data_len);
+    return furi_host_beacon.data_len;
+}
+
+bool furi_hal_bt_extra_beacon_start(void) {
+    furi_host_beacon_call();
+    if(!furi_host_beacon.configured || furi_host_beacon.active) {
+        return false;
+    }
+    furi_host_beacon.active = true;
+    furi_host_beacon.starts++;
+    furi_host_beacon.on_air_tick = furi_get_tick();
+    return true;
+}
+
+bool furi_hal_bt_extra_beacon_stop(void) {
+    furi_host_beacon_call();
+    if(!furi_host_beacon.active) {
+        return false;
+    }
+    furi_host_beacon.active = false;
+    return true;
+}
+
+bool furi_hal_bt_extra_beacon_is_active(void) {
+    return furi_host_beacon.active;
+}
+
+// Canvas, only counted
+
+void canvas_draw_line(Canvas* canvas, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    UNUSED(canvas);
+    UNUSED(x1);
+    UNUSED(y1);
+    UNUSED(x2);
+    UNUSED(y2);
+    furi_host_canvas_ops++;
+}
+
+void canvas_draw_dot(Canvas* canvas, int32_t x, int32_t y) {
+    UNUSED(canvas);
+    UNUSED(x);
+    UNUSED(y);
+    furi_host_canvas_ops++;
+}
+
+void canvas_draw_box(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height) {
+    UNUSED(canvas);
+    UNUSED(x);
+    UNUSED(y);
+    UNUSED(width);
+    UNUSED(height);
+    furi_host_canvas_ops++;
+}
+
+void canvas_draw_frame(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height) {
+    UNUSED(canvas);
+    UNUSED(x);
+    UNUSED(y);
+    UNUSED(width);
+    UNUSED(height);
+    furi_host_canvas_ops++;
+}
+
+void canvas_draw_str(Canvas* canvas, int32_t x, int32_t y, const char* str) {
+    UNUSED(canvas);
+    UNUSED(x);
+    UNUSED(y);
+    UNUSED(str);
+    furi_host_canvas_ops++;
+}
+
+void canvas_draw_str_aligned(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    Align horizontal,
+    Align vertical,
+    const char* str) {
+    UNUSED(horizontal);
+    UNUSED(vertical);
+    canvas_draw_str(canvas, x, y, str);
+}
+
+void canvas_set_color(Canvas* canvas, Color color) {
+    UNUSED(canvas);
+    UNUSED(color);
+}
+
+void canvas_set_font(Canvas* canvas, Font font) {
+    UNUSED(canvas);
+    UNUSED(font);
+}
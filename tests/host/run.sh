@@ -0,0 +1,51 @@
+#!/bin/sh
+# Build and run the host tests of the pure logic modules, from the repository root:
+#   tests/host/run.sh          tests, under ASan and UBSan
+#   tests/host/run.sh bench    tests, then the benchmarks built with -O2
+set -e
+
+CC=${CC:-cc}
+OUT=${OUT:-/tmp/home_remote_host}
+INCLUDES="-Itests/host/sdk -Itests/host -I. -Isrc"
+# Flipper logs print uint32_t with %lu, it's a long on the target only
+WARNINGS="-Wall -Wextra -Wno-format"
+TEST_CFLAGS="-std=gnu17 -O1 -g -fsanitize=address,undefined -fno-sanitize-recover=all"
+BENCH_CFLAGS="-std=gnu17 -O2 -DNDEBUG"
+MODULES="
+    libs/spsc_queue.c
+    src/ble_beacon.c
+    src/bt_conn.c
+    src/bt_rpc.c
+    src/bt_tlv.c
+    src/cmd_channel.c
+    src/ha_history.c
+    src/ha_snapshot.c
+    src/ha_telemetry.c
+    src/sghz_ascii.c
+    src/sghz_fec.c
+    src/sghz_frame.c
+    src/sghz_link.c
+    src/sghz_rx.c
+    src/sghz_sched.c
+"
+
+mkdir -p "$OUT"
+export FURI_HOST_STORAGE="$OUT/sd"
+
+for test in tests/host/test_*.c; do
+    name=$(basename "$test" .c)
+    $CC $TEST_CFLAGS $WARNINGS $INCLUDES -o "$OUT/$name" "$test" tests/host/test.c \
+        tests/host/furi_host.c $MODULES -lpthread -lm
+    rm -rf "$FURI_HOST_STORAGE"
+    "$OUT/$name"
+done
+
+if [ "$1" = "bench" ]; then
+    for bench in tests/host/bench_*.c; do
+        name=$(basename "$bench" .c)
+        $CC $BENCH_CFLAGS $WARNINGS $INCLUDES -o "$OUT/$name" "$bench" \
+            tests/host/furi_host.c $MODULES -lpthread -lm
+        rm -rf "$FURI_HOST_STORAGE"
+        "$OUT/$name"
+    done
+fi
@@ -0,0 +1,267 @@
+#pragma once
+/**
+ * Host stand-in for the parts of the Flipper SDK the pure logic modules use, so they build
+ * and run on a PC. GUI, radio and BT types are opaque, the kernel calls are implemented on
+ * top of pthreads and stdio in furi_host.c. Not a simulator: only what the tests need.
+*/
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+#define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
+#define UNUSED(x)   (void)(x)
+
+#define EXT_PATH(path) "/ext/" path
+
+#define furi_check(x)  ((x) ? (void)0 : furi_host_crash(#x, __FILE__, __LINE__))
+#define furi_assert(x) furi_check(x)
+
+extern bool furi_host_log;
+#define FURI_HOST_LOG(level, tag, ...)                 \
+    do {                                               \
+        if(furi_host_log) {                            \
+            printf("[%s][%s] ", level, tag);           \
+            printf(__VA_ARGS__);                       \
+            printf("\n");                              \
+        }                                              \
+    } while(0)
+#define FURI_LOG_E(tag, ...) FURI_HOST_LOG("E", tag, __VA_ARGS__)
+#define FURI_LOG_W(tag, ...) FURI_HOST_LOG("W", tag, __VA_ARGS__)
+#define FURI_LOG_I(tag, ...) FURI_HOST_LOG("I", tag, __VA_ARGS__)
+#define FURI_LOG_D(tag, ...) FURI_HOST_LOG("D", tag, __VA_ARGS__)
+
+void furi_host_crash(const char* expr, const char* file, int line);
+
+// Kernel, one tick per ms. The tick is the test clock, moved by furi_host_set_tick
+typedef enum {
+    FuriStatusOk = 0,
+    FuriStatusError = -1,
+    FuriStatusErrorTimeout = -2,
+} FuriStatus;
+
+typedef enum {
+    FuriFlagWaitAny = 0x00000000U,
+    FuriFlagWaitAll = 0x00000001U,
+    FuriFlagNoClear = 0x00000002U,
+    FuriFlagError = 0x80000000U,
+    FuriFlagErrorTimeout = 0xFFFFFFFEU,
+} FuriFlag;
+
+#define FuriWaitForever 0xFFFFFFFFU
+
+uint32_t furi_get_tick(void);
+void furi_host_set_tick(uint32_t tick);
+uint32_t furi_host_time_us(void);
+#define furi_ms_to_ticks(ms)             ((uint32_t)(ms))
+#define furi_kernel_get_tick_frequency() 1000U
+void furi_delay_ms(uint32_t ms);
+void furi_thread_yield(void);
+
+typedef struct FuriMutex FuriMutex;
+typedef enum {
+    FuriMutexTypeNormal,
+    FuriMutexTypeRecursive,
+} FuriMutexType;
+FuriMutex* furi_mutex_alloc(FuriMutexType type);
+void furi_mutex_free(FuriMutex* mutex);
+FuriStatus furi_mutex_acquire(FuriMutex* mutex, uint32_t timeout);
+FuriStatus furi_mutex_release(FuriMutex* mutex);
+
+typedef struct FuriEventFlag FuriEventFlag;
+FuriEventFlag* furi_event_flag_alloc(void);
+void furi_event_flag_free(FuriEventFlag* flag);
+uint32_t furi_event_flag_set(FuriEventFlag* flag, uint32_t flags);
+uint32_t
+    furi_event_flag_wait(FuriEventFlag* flag, uint32_t flags, uint32_t options, uint32_t timeout);
+
+typedef struct FuriMessageQueue FuriMessageQueue;
+FuriMessageQueue* furi_message_queue_alloc(uint32_t msg_count, uint32_t msg_size);
+void furi_message_queue_free(FuriMessageQueue* queue);
+FuriStatus furi_message_queue_put(FuriMessageQueue* queue, const void* msg, uint32_t timeout);
+FuriStatus furi_message_queue_get(FuriMessageQueue* queue, void* msg, uint32_t timeout);
+
+typedef struct FuriThread FuriThread;
+typedef struct FuriThread* FuriThreadId;
+typedef int32_t (*FuriThreadCallback)(void* context);
+FuriThread* furi_thread_alloc_ex(
+    const char* name,
+    uint32_t stack_size,
+    FuriThreadCallback callback,
+    void* context);
+void furi_thread_free(FuriThread* thread);
+void furi_thread_start(FuriThread* thread);
+bool furi_thread_join(FuriThread* thread);
+FuriThreadId furi_thread_get_id(FuriThread* thread);
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags);
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout);
+
+void* furi_record_open(const char* name);
+void furi_record_close(const char* name);
+
+// Strings, a plain growable buffer
+typedef struct FuriString FuriString;
+FuriString* furi_string_alloc(void);
+void furi_string_free(FuriString* string);
+void furi_string_reset(FuriString* string);
+void furi_string_set_str(FuriString* string, const char* cstr);
+void furi_string_cat_str(FuriString* string, const char* cstr);
+int furi_string_printf(FuriString* string, const char* format, ...);
+int furi_string_cat_printf(FuriString* string, const char* format, ...);
+const char* furi_string_get_cstr(const FuriString* string);
+size_t furi_string_size(const FuriString* string);
+bool furi_string_empty(const FuriString* string);
+
+// Storage, paths are mapped under the directory of FURI_HOST_STORAGE (default /tmp)
+#define RECORD_STORAGE "storage"
+typedef struct Storage Storage;
+typedef struct File File;
+typedef enum {
+    FSAM_READ = (1 << 0),
+    FSAM_WRITE = (1 << 1),
+    FSAM_READ_WRITE = FSAM_READ | FSAM_WRITE,
+} FS_AccessMode;
+typedef enum {
+    FSOM_OPEN_EXISTING = 1,
+    FSOM_OPEN_ALWAYS = 2,
+    FSOM_OPEN_APPEND = 4,
+    FSOM_CREATE_NEW = 8,
+    FSOM_CREATE_ALWAYS = 16,
+} FS_OpenMode;
+File* storage_file_alloc(Storage* storage);
+void storage_file_free(File* file);
+bool storage_file_open(File* file, const char* path, FS_AccessMode access, FS_OpenMode mode);
+bool storage_file_close(File* file);
+size_t storage_file_read(File* file, void* buff, size_t to_read);
+size_t storage_file_write(File* file, const void* buff, size_t to_write);
+bool storage_file_seek(File* file, uint32_t offset, bool from_start);
+uint64_t storage_file_size(File* file);
+bool storage_file_truncate(File* file);
+bool storage_simply_mkdir(Storage* storage, const char* path);
+bool storage_simply_remove(Storage* storage, const char* path);
+const char* furi_host_storage_path(const char* path, char* out, size_t size);
+
+// Input
+typedef enum {
+    InputKeyUp,
+    InputKeyDown,
+    InputKeyRight,
+    InputKeyLeft,
+    InputKeyOk,
+    InputKeyBack,
+    InputKeyMAX,
+} InputKey;
+typedef enum {
+    InputTypePress,
+    InputTypeRelease,
+    InputTypeShort,
+    InputTypeLong,
+    InputTypeRepeat,
+} InputType;
+typedef struct {
+    uint32_t sequence;
+    InputKey key;
+    InputType type;
+} InputEvent;
+
+// GUI, opaque. The canvas calls used by the draw helpers only count the primitives
+typedef struct Canvas Canvas;
+typedef struct Icon Icon;
+typedef enum {
+    AlignLeft,
+    AlignRight,
+    AlignTop,
+    AlignBottom,
+    AlignCenter,
+} Align;
+typedef enum {
+    ColorWhite,
+    ColorBlack,
+    ColorXOR,
+} Color;
+typedef enum {
+    FontPrimary,
+    FontSecondary,
+    FontKeyboard,
+    FontBigNumbers,
+} Font;
+extern uint32_t furi_host_canvas_ops;
+void canvas_draw_line(Canvas* canvas, int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+void canvas_draw_dot(Canvas* canvas, int32_t x, int32_t y);
+void canvas_draw_box(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height);
+void canvas_draw_frame(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height);
+void canvas_draw_str(Canvas* canvas, int32_t x, int32_t y, const char* str);
+void canvas_draw_str_aligned(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    Align horizontal,
+    Align vertical,
+    const char* str);
+void canvas_set_color(Canvas* canvas, Color color);
+void canvas_set_font(Canvas* canvas, Font font);
+
+typedef struct View View;
+typedef struct ViewDispatcher ViewDispatcher;
+typedef struct Gui Gui;
+typedef struct Submenu Submenu;
+typedef struct TextBox TextBox;
+typedef struct TextInput TextInput;
+typedef struct VariableItemList VariableItemList;
+typedef struct VariableItem VariableItem;
+typedef void (*VariableItemChangeCallback)(VariableItem* item);
+typedef struct Widget Widget;
+typedef struct Menu Menu;
+typedef struct Popup Popup;
+typedef struct Loading Loading;
+typedef struct DialogEx DialogEx;
+typedef enum {
+    DialogExResultLeft,
+    DialogExResultCenter,
+    DialogExResultRight,
+} DialogExResult;
+typedef struct NotificationApp NotificationApp;
+typedef struct FuriPubSub FuriPubSub;
+typedef struct FuriPubSubSubscription FuriPubSubSubscription;
+typedef struct FuriTimer FuriTimer;
+// Timers never fire on the host, the tests call the callbacks themselves
+FuriStatus furi_timer_start(FuriTimer* timer, uint32_t ticks);
+typedef struct FuriStreamBuffer FuriStreamBuffer;
+
+// Radio and BT, opaque
+typedef struct SubGhzTxRxWorker SubGhzTxRxWorker;
+typedef struct SubGhzDevice SubGhzDevice;
+typedef struct Bt Bt;
+typedef struct FuriHalBleProfileBase FuriHalBleProfileBase;
+typedef struct FuriHalSerialHandle FuriHalSerialHandle;
+typedef enum {
+    FuriHalSerialIdUsart,
+    FuriHalSerialIdLpuart,
+} FuriHalSerialId;
+#define FuriHalSerialIdUsart FuriHalSerialIdUsart
+typedef enum {
+    FuriHalSerialRxEventData = (1 << 0),
+} FuriHalSerialRxEvent;
+#define EXTRA_BEACON_MAX_DATA_SIZE 31U
+#define EXTRA_BEACON_MAC_ADDR_SIZE 6U
+typedef struct {
+    uint16_t min_adv_interval_ms;
+    uint16_t max_adv_interval_ms;
+    uint8_t adv_channel_map;
+    uint8_t adv_power_level;
+    uint8_t address_type;
+    uint8_t address[EXTRA_BEACON_MAC_ADDR_SIZE];
+} GapExtraBeaconConfig;
+
+uint32_t furi_hal_random_get(void);
+void furi_hal_random_fill_buf(uint8_t* buffer, uint32_t len);
@@ -0,0 +1,26 @@
+#pragma once
+#include <furi.h>
+
+// Extra beacon, a fake that keeps what was set so the tests can look at it
+bool furi_hal_bt_extra_beacon_set_config(const GapExtraBeaconConfig* config);
+const GapExtraBeaconConfig* furi_hal_bt_extra_beacon_get_config(void);
+bool furi_hal_bt_extra_beacon_set_data(const uint8_t* data, uint8_t len);
+uint8_t furi_hal_bt_extra_beacon_get_data(uint8_t* data);
+bool furi_hal_bt_extra_beacon_start(void);
+bool furi_hal_bt_extra_beacon_stop(void);
+bool furi_hal_bt_extra_beacon_is_active(void);
+
+typedef struct {
+    bool active;
+    bool configured;
+    GapExtraBeaconConfig config;
+    uint8_t data[EXTRA_BEACON_MAX_DATA_SIZE];
+    uint8_t data_len;
+    uint32_t data_sets;
+    uint32_t starts;
+    uint32_t calls;
+    // Ticks every call takes, the radio commands aren't free on the target
+    uint32_t call_ticks;
+    uint32_t on_air_tick; // When the current data started being advertised
+} FuriHostBeacon;
+extern FuriHostBeacon furi_host_beacon;
@@ -0,0 +1,9 @@
+#include "test.h"
+
+uint32_t test_failed = 0;
+uint32_t test_checked = 0;
+
+int test_done(const char* name) {
+    printf("%s: %u checks, %u failed\n", name, test_checked, test_failed);
+    return test_failed == 0 ? 0 : 1;
+}
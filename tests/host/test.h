@@ -0,0 +1,38 @@
+#pragma once
+#include <furi.h>
+
+/**
+ * Minimal assertions for the host tests: a failed check is printed and counted, the test
+ * returns test_done() as its exit code.
+*/
+extern uint32_t test_failed;
+extern uint32_t test_checked;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        test_checked++;                                                     \
+        if(!(cond)) {                                                       \
+            test_failed++;                                                  \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        }                                                                   \
+    } while(0)
+
+#define CHECK_EQ(a, b)                                                  \
+    do {                                                                \
+        test_checked++;                                                 \
+        const long long _a = (long long)(a);                            \
+        const long long _b = (long long)(b);                            \
+        if(_a != _b) {                                                  \
+            test_failed++;                                              \
+            printf(                                                     \
+                "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n",       \
+                __FILE__,                                               \
+                __LINE__,                                               \
+                #a,                                                     \
+                #b,                                                     \
+                _a,                                                     \
+                _b);                                                    \
+        }                                                               \
+    } while(0)
+
+int test_done(const char* name);
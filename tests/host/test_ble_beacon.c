@@ -0,0 +1,314 @@
+#include "test.h"
+#include "ble_beacon.h"
+#include "alloc_free.h"
+
+// Ticks taken by every call to the fake beacon HAL, stop, config, data and start alike
+#define HAL_CALL_TICKS 2U
+
+/**
+ * The advertisement as make_packet built it before beacon_packet_build and
+ * beacon_packet_patch, for a single button object. The original wrote past the 31 bytes
+ * before checking the size, the buffer here is large enough for that.
+*/
+static bool make_packet(BtBeacon* ble, uint8_t event_type, uint8_t* packet, uint8_t* size) {
+    size_t i = 0;
+    ble->cnt++;
+
+    packet[i++] = 0x02;
+    packet[i++] = 0x03;
+    packet[i++] = 0b00000110;
+    packet[i++] = 0x08;
+    packet[i++] = 0x16;
+    packet[i++] = 0xD2;
+    packet[i++] = 0xFC;
+    packet[i++] = 0b01000100;
+    packet[i++] = 0x00;
+    packet[i++] = ble->cnt;
+    packet[i++] = 0x3A;
+    packet[i++] = event_type;
+    packet[i++] = ble->device_name_len + 1;
+    packet[i++] = 0x09;
+    for(size_t j = 0; j < ble->device_name_len; j++) {
+        packet[i++] = (uint8_t)ble->device_name[j];
+    }
+
+    if(i > EXTRA_BEACON_MAX_DATA_SIZE) {
+        return false;
+    }
+    *size = i;
+    return true;
+}
+
+static void beacon_init(BtBeacon* ble, char* name) {
+    memset(ble, 0, sizeof(*ble));
+    ble->device_name = name;
+    // The app counts the terminator, see app_alloc
+    ble->device_name_len = strlen(name) + 1;
+}
+
+static void test_same_as_make_packet(void) {
+    static const uint8_t events[] = {BTHomeNone, BTHomeShortPress, BTHomeLongPress};
+    char* names[] = {"", "A", "Flipper", "Home Remote", "Kitchen_Remote01"};
+    for(size_t n = 0; n < COUNT_OF(names); n++) {
+        BtBeacon ble;
+        BtBeacon old;
+        beacon_init(&ble, names[n]);
+        beacon_init(&old, names[n]);
+        CHECK(beacon_packet_build(&ble));
+        // Past the counter wrap
+        for(uint32_t i = 0; i < 300; i++) {
+            const uint8_t event = events[i % COUNT_OF(events)];
+            uint8_t expected[64];
+            uint8_t expected_len = 0;
+            CHECK(make_packet(&old, event, expected, &expected_len));
+            const uint8_t patch[BEACON_SLOTS_MAX] = {event};
+            CHECK(beacon_packet_patch(&ble, event == BTHomeNone ? NULL : patch));
+            CHECK_EQ(ble.packet_len, expected_len);
+            CHECK(memcmp(ble.packet, expected, expected_len) == 0);
+        }
+    }
+}
+
+static void test_name_too_long(void) {
+    // The longest name that fits, then one more character
+    char name[EXTRA_BEACON_MAX_DATA_SIZE];
+    memset(name, 'n', sizeof(name));
+    const size_t longest = EXTRA_BEACON_MAX_DATA_SIZE - BEACON_PACKET_HEADER_SIZE(1) - 1;
+    for(size_t len = longest; len <= longest + 1; len++) {
+        name[len] = '\0';
+        BtBeacon ble;
+        BtBeacon old;
+        beacon_init(&ble, name);
+        beacon_init(&old, name);
+        uint8_t expected[64];
+        uint8_t expected_len = 0;
+        const bool fits = make_packet(&old, BTHomeShortPress, expected, &expected_len);
+        CHECK_EQ(beacon_packet_build(&ble), fits);
+        CHECK_EQ(fits, len == longest);
+        if(fits) {
+            CHECK(beacon_packet_patch(&ble, (const uint8_t[BEACON_SLOTS_MAX]){BTHomeShortPress}));
+            CHECK(memcmp(ble.packet, expected, expected_len) == 0);
+        } else {
+            // Nothing to advertise, the counter doesn't move
+            CHECK_EQ(ble.packet_len, 0);
+            CHECK(!beacon_packet_patch(&ble, NULL));
+            CHECK_EQ(ble.cnt, 0);
+        }
+        name[len] = 'n';
+    }
+}
+
+static void test_multi_object_layout(void) {
+    char name[] = "Flipper";
+    BtBeacon ble;
+    beacon_init(&ble, name);
+    ble.multi_object = true;
+    CHECK_EQ(beacon_slots(&ble), BeaconControlCount);
+    CHECK(beacon_packet_build(&ble));
+    CHECK_EQ(ble.packet_len, BEACON_PACKET_HEADER_SIZE(BeaconControlCount) + ble.device_name_len);
+    // The service data grows by an object ID and an event per button
+    CHECK_EQ(ble.packet[3], 0x06 + 2 * BeaconControlCount);
+    CHECK_EQ(ble.packet[4], 0x16);
+    for(uint8_t slot = 0; slot < BeaconControlCount; slot++) {
+        CHECK_EQ(ble.packet[BEACON_PACKET_EVENT_POS(slot) - 1], 0x3A);
+    }
+    // The name record follows the last button
+    const size_t name_pos = BEACON_PACKET_EVENT_POS(BeaconControlCount);
+    CHECK_EQ(name_pos, BEACON_PACKET_HEADER_SIZE(BeaconControlCount) - 1);
+    CHECK_EQ(ble.packet[name_pos - 1], ble.device_name_len + 1);
+    CHECK_EQ(ble.packet[name_pos], 0x09);
+    CHECK(memcmp(&ble.packet[name_pos + 1], name, ble.device_name_len) == 0);
+
+    const uint8_t events[BEACON_SLOTS_MAX] = {BTHomeNone, BTHomeShortPress};
+    CHECK(beacon_packet_patch(&ble, events));
+    CHECK_EQ(ble.packet[BEACON_PACKET_CNT_POS], 1);
+    CHECK_EQ(ble.packet[BEACON_PACKET_EVENT_POS(0)], BTHomeNone);
+    CHECK_EQ(ble.packet[BEACON_PACKET_EVENT_POS(1)], BTHomeShortPress);
+
+    // Every extra button takes two bytes off the longest name
+    char longest[EXTRA_BEACON_MAX_DATA_SIZE];
+    const size_t longest_len =
+        EXTRA_BEACON_MAX_DATA_SIZE - BEACON_PACKET_HEADER_SIZE(BeaconControlCount) - 1;
+    memset(longest, 'n', longest_len + 1);
+    longest[longest_len] = '\0';
+    beacon_init(&ble, longest);
+    ble.multi_object = true;
+    CHECK(beacon_packet_build(&ble));
+    CHECK_EQ(ble.packet_len, EXTRA_BEACON_MAX_DATA_SIZE);
+    longest[longest_len] = 'n';
+    longest[longest_len + 1] = '\0';
+    beacon_init(&ble, longest);
+    ble.multi_object = true;
+    CHECK(!beacon_packet_build(&ble));
+}
+
+static BtBeacon* sim_alloc(bool persistent) {
+    static char name[] = "Flipper";
+    BtBeacon* ble = malloc(sizeof(BtBeacon));
+    beacon_init(ble, name);
+    ble->events = spsc_queue_alloc(BEACON_EVENT_QUEUE_SIZE, sizeof(BeaconEvent));
+    ble->beacon_period = BEACON_PERIOD;
+    ble->beacon_duration = BEACON_DURATION;
+    ble->persistent = persistent;
+    memset(&furi_host_beacon, 0, sizeof(furi_host_beacon));
+    furi_host_beacon.call_ticks = HAL_CALL_TICKS;
+    furi_host_set_tick(0);
+    CHECK(beacon_packet_build(ble));
+    if(persistent) {
+        beacon_session_start(ble);
+    }
+    // The session starts with the page, long before the first press
+    furi_host_set_tick(0);
+    return ble;
+}
+
+static void sim_free(BtBeacon* ble) {
+    spsc_queue_free(ble->events);
+    free(ble);
+}
+
+/**
+ * @brief      Run the worker on the fake tick: queue the presses due, wake up when the
+ *             worker asks to, until the queue is empty. The reset timer never fires here.
+ * @details    The presses made while the worker was in the HAL are queued with their own
+ *             tick, like the input thread does.
+*/
+static void sim_run(BtBeacon* ble, const uint32_t* presses, size_t count) {
+    uint32_t timeout = FuriWaitForever;
+    size_t next = 0;
+    while(next < count || timeout != FuriWaitForever) {
+        const uint32_t now = furi_get_tick();
+        const uint32_t wake = timeout == FuriWaitForever ? UINT32_MAX : now + timeout;
+        if(next < count && presses[next] <= wake) {
+            const uint32_t at = MAX(presses[next], now);
+            while(next < count && presses[next] <= at) {
+                furi_host_set_tick(presses[next]);
+                CHECK(beacon_event_push(ble, BeaconControlDehum));
+                next++;
+            }
+            furi_host_set_tick(at);
+            timeout = beacon_worker_step(ble, ThreadCommSendCmd);
+        } else {
+            furi_host_set_tick(wake);
+            timeout = beacon_worker_step(ble, FuriFlagErrorTimeout);
+        }
+    }
+}
+
+/**
+ * @brief      Queue the controls, then check what every advertisement carries.
+ * @param      expected  the events of the slots of each advertisement
+*/
+static void check_adverts(
+    bool multi_object,
+    const BeaconControl* controls,
+    size_t count,
+    const uint8_t (*expected)[BEACON_SLOTS_MAX],
+    size_t adverts) {
+    BtBeacon* ble = sim_alloc(true);
+    ble->multi_object = multi_object;
+    CHECK(beacon_packet_build(ble));
+    for(size_t i = 0; i < count; i++) {
+        CHECK(beacon_event_push(ble, controls[i]));
+    }
+    uint32_t timeout = beacon_worker_step(ble, ThreadCommSendCmd);
+    for(size_t a = 0; a < adverts; a++) {
+        for(uint8_t slot = 0; slot < beacon_slots(ble); slot++) {
+            CHECK_EQ(furi_host_beacon.data[BEACON_PACKET_EVENT_POS(slot)], expected[a][slot]);
+        }
+        CHECK_EQ(timeout == FuriWaitForever, a == adverts - 1);
+        if(timeout != FuriWaitForever) {
+            furi_host_set_tick(furi_get_tick() + timeout);
+            timeout = beacon_worker_step(ble, FuriFlagErrorTimeout);
+        }
+    }
+    CHECK_EQ(ble->air_events, count);
+    sim_free(ble);
+}
+
+static void test_event_take_order(void) {
+    const BeaconControl controls[] = {
+        BeaconControlDehum,
+        BeaconControlDehumAut,
+        BeaconControlDehum,
+        BeaconControlDehum,
+        BeaconControlDehumAut,
+    };
+    // One button: every event has its advertisement, in order
+    const uint8_t single[][BEACON_SLOTS_MAX] = {
+        {BTHomeShortPress},
+        {BTHomeLongPress},
+        {BTHomeShortPress},
+        {BTHomeShortPress},
+        {BTHomeLongPress},
+    };
+    check_adverts(false, controls, COUNT_OF(controls), single, COUNT_OF(single));
+
+    // A button per control: events of different buttons share an advertisement, until the
+    // next one is for a button already taken
+    const uint8_t multi[][BEACON_SLOTS_MAX] = {
+        {BTHomeShortPress, BTHomeShortPress},
+        {BTHomeShortPress, BTHomeNone},
+        {BTHomeShortPress, BTHomeShortPress},
+    };
+    check_adverts(true, controls, COUNT_OF(controls), multi, COUNT_OF(multi));
+
+    // An event for the second button first doesn't let a later one jump ahead
+    const BeaconControl reversed[] = {BeaconControlDehumAut, BeaconControlDehum};
+    const uint8_t reversed_adverts[][BEACON_SLOTS_MAX] = {{BTHomeShortPress, BTHomeShortPress}};
+    check_adverts(true, reversed, COUNT_OF(reversed), reversed_adverts, 1);
+}
+
+static void test_press_to_air(void) {
+    const uint32_t hold = BEACON_PERIOD * BEACON_EVENT_HOLD_ADV;
+    // The old path stops, configures, sets the data and starts, the first time not stopping
+    const uint32_t old_cost = 4 * HAL_CALL_TICKS;
+    const uint32_t persistent_cost = HAL_CALL_TICKS;
+
+    // A single press
+    for(uint32_t persistent = 0; persistent <= 1; persistent++) {
+        BtBeacon* ble = sim_alloc(persistent);
+        const uint32_t calls = furi_host_beacon.calls;
+        sim_run(ble, (const uint32_t[]){10}, 1);
+        const uint32_t cost = persistent ? persistent_cost : old_cost - HAL_CALL_TICKS;
+        CHECK_EQ(ble->air_events, 1);
+        CHECK_EQ(ble->air_ms_max, cost);
+        CHECK_EQ(furi_host_beacon.calls - calls, cost / HAL_CALL_TICKS);
+        CHECK_EQ(furi_host_beacon.on_air_tick, 10 + cost);
+        CHECK_EQ(furi_host_beacon.data[BEACON_PACKET_EVENT_POS(0)], BTHomeShortPress);
+        sim_free(ble);
+    }
+
+    // A burst, every event waits for the hold of the ones before it
+    const uint32_t burst[] = {0, 0, 0, 0};
+    for(uint32_t persistent = 0; persistent <= 1; persistent++) {
+        BtBeacon* ble = sim_alloc(persistent);
+        sim_run(ble, burst, COUNT_OF(burst));
+        const uint32_t cost = persistent ? persistent_cost : old_cost;
+        const uint32_t first = persistent ? persistent_cost : old_cost - HAL_CALL_TICKS;
+        const uint32_t last = first + (COUNT_OF(burst) - 1) * (hold + cost);
+        CHECK_EQ(ble->air_events, COUNT_OF(burst));
+        CHECK_EQ(ble->air_ms_max, last);
+        // Queued events advance every advertising interval
+        CHECK(ble->air_ms_max <= first + (COUNT_OF(burst) - 1) * (BEACON_PERIOD + cost));
+        CHECK_EQ(ble->air_ms_sum, COUNT_OF(burst) * (first + last) / 2);
+        sim_free(ble);
+    }
+
+    // The latency of every event starts at its own press, not at the last one
+    BtBeacon* ble = sim_alloc(true);
+    sim_run(ble, (const uint32_t[]){0, hold / 2}, 2);
+    CHECK_EQ(ble->air_events, 2);
+    CHECK_EQ(ble->air_ms_max, persistent_cost + hold + persistent_cost - hold / 2);
+    CHECK_EQ(ble->air_ms_sum, persistent_cost + ble->air_ms_max);
+    sim_free(ble);
+}
+
+int main(void) {
+    test_same_as_make_packet();
+    test_name_too_long();
+    test_multi_object_layout();
+    test_event_take_order();
+    test_press_to_air();
+    return test_done("ble_beacon");
+}
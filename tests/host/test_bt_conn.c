@@ -0,0 +1,80 @@
+#include "test.h"
+#include "bt_conn.h"
+
+static void test_profiles(void) {
+    BtConn conn;
+    bt_conn_reset(&conn, 1000);
+    CHECK_EQ(conn.profile, BtConnInteractive);
+    CHECK_EQ(conn.requested, BtConnCount);
+
+    uint32_t wait_ms;
+    CHECK_EQ(bt_conn_update(&conn, 1000, 1000, &wait_ms), BtConnInteractive);
+    CHECK_EQ(wait_ms, BT_CONN_IDLE_MS);
+    CHECK_EQ(bt_conn_update(&conn, 1000, 1000 + BT_CONN_IDLE_MS - 1, &wait_ms), BtConnInteractive);
+    CHECK_EQ(wait_ms, 1);
+    CHECK_EQ(bt_conn_update(&conn, 1000, 1000 + BT_CONN_IDLE_MS, &wait_ms), BtConnIdle);
+    CHECK_EQ(wait_ms, BT_CONN_BACKGROUND_MS - BT_CONN_IDLE_MS);
+    CHECK_EQ(conn.stats[BtConnInteractive].time_ms, BT_CONN_IDLE_MS);
+    CHECK_EQ(
+        bt_conn_update(&conn, 1000, 1000 + BT_CONN_BACKGROUND_MS, &wait_ms), BtConnBackground);
+    CHECK_EQ(wait_ms, FuriWaitForever);
+    CHECK_EQ(conn.stats[BtConnIdle].time_ms, BT_CONN_BACKGROUND_MS - BT_CONN_IDLE_MS);
+
+    // An input brings it back at once, the tick may have wrapped
+    const uint32_t input = UINT32_MAX - 10;
+    CHECK_EQ(bt_conn_update(&conn, input, input + 20, &wait_ms), BtConnInteractive);
+    CHECK_EQ(wait_ms, BT_CONN_IDLE_MS - 20);
+    CHECK_EQ(conn.stats[BtConnBackground].time_ms, input + 20 - (1000 + BT_CONN_BACKGROUND_MS));
+}
+
+static void test_stats(void) {
+    BtConn conn;
+    bt_conn_reset(&conn, 0);
+    uint32_t wait_ms;
+    bt_conn_on_sent(&conn, 20, 10);
+    bt_conn_on_sent(&conn, 100, 30);
+    bt_conn_update(&conn, 0, BT_CONN_IDLE_MS, &wait_ms);
+    bt_conn_on_sent(&conn, 50, 200);
+
+    const BtConnStats* interactive = &conn.stats[BtConnInteractive];
+    CHECK_EQ(interactive->notifications, 2);
+    CHECK_EQ(interactive->bytes, 120);
+    CHECK_EQ(interactive->latency_sum_ms, 40);
+    CHECK_EQ(interactive->latency_max_ms, 30);
+    CHECK_EQ(bt_conn_throughput(interactive), 120 * 1000 / BT_CONN_IDLE_MS);
+    const BtConnStats* idle = &conn.stats[BtConnIdle];
+    CHECK_EQ(idle->notifications, 1);
+    CHECK_EQ(idle->latency_max_ms, 200);
+    // No time spent in the idle profile until it ends or is logged
+    CHECK_EQ(bt_conn_throughput(idle), 0);
+    bt_conn_log(&conn, BT_CONN_IDLE_MS + 500);
+    CHECK_EQ(idle->time_ms, 500);
+    CHECK_EQ(bt_conn_throughput(idle), 100);
+    // Logging again doesn't count the same time twice
+    bt_conn_log(&conn, BT_CONN_IDLE_MS + 500);
+    CHECK_EQ(idle->time_ms, 500);
+    CHECK_EQ(conn.stats[BtConnBackground].time_ms, 0);
+
+    // Large counts don't overflow
+    BtConnStats big = {.bytes = UINT32_MAX, .time_ms = 1000};
+    CHECK_EQ(bt_conn_throughput(&big), UINT32_MAX);
+}
+
+static void test_duty(void) {
+    BtConnStats stats = {0};
+    CHECK_EQ(bt_conn_duty_permille(&stats), 0);
+    // A 1 ms event every 7.5 ms
+    stats.interval = 6;
+    CHECK_EQ(bt_conn_duty_permille(&stats), 133);
+    // Every 50 ms, skipping 4 events
+    stats.interval = 40;
+    stats.latency = 4;
+    CHECK_EQ(bt_conn_duty_permille(&stats), 4);
+}
+
+int main(void) {
+    test_profiles();
+    test_stats();
+    test_duty();
+    return test_done("bt_conn");
+}
@@ -0,0 +1,214 @@
+#include "test.h"
+#include "bt_rpc.h"
+
+#define TIMEOUT 500U
+
+/**
+ * The other end of the link: requests sent by BtRpc are answered here, the replies wait
+ * until the test delivers them so it controls the order and the loss.
+*/
+typedef struct {
+    bool link_down;
+    uint32_t requests;
+    uint8_t replies[BT_RPC_MAX_CALLS * 2][64];
+    size_t replies_len[BT_RPC_MAX_CALLS * 2];
+    size_t replies_count;
+} FakeServer;
+
+typedef struct {
+    uint32_t calls;
+    uint8_t status;
+    int16_t samples[16];
+    size_t samples_count;
+    HaSnapshot update;
+} Result;
+
+static size_t server_reply(const uint8_t* request, size_t len, uint8_t* reply) {
+    uint8_t value_len;
+    const uint8_t* id = bt_tlv_find(request, len, BT_TLV_TYPE_RPC_ID, &value_len);
+    const uint8_t* method = bt_tlv_find(request, len, BT_TLV_TYPE_RPC_METHOD, &value_len);
+    const uint8_t* args = bt_tlv_find(request, len, BT_TLV_TYPE_RPC_ARGS, &value_len);
+    size_t pos = 0;
+    reply[pos++] = BT_TLV_MAGIC;
+    reply[pos++] = BT_TLV_VERSION;
+    reply[pos++] = BT_TLV_TYPE_RPC_ID;
+    reply[pos++] = 1;
+    reply[pos++] = *id;
+    reply[pos++] = BT_TLV_TYPE_RPC_STATUS;
+    reply[pos++] = 1;
+    switch(*method) {
+    case BtRpcMethodGetEntities: {
+        reply[pos++] = BtRpcStatusOk;
+        // Every requested entity has its index as value
+        const uint16_t mask = args[0] | args[1] << 8;
+        for(uint8_t e = 0; e < HaEntityCount; e++) {
+            if(mask & (1 << e)) {
+                reply[pos++] = BT_TLV_TYPE_ENTITY_FIRST + e;
+                reply[pos++] = 2;
+                reply[pos++] = e;
+                reply[pos++] = 0;
+            }
+        }
+        break;
+    }
+    case BtRpcMethodGetHistory: {
+        reply[pos++] = BtRpcStatusOk;
+        // The samples count down from the entity
+        const uint8_t count = args[5];
+        reply[pos++] = BT_TLV_TYPE_SAMPLES;
+        reply[pos++] = count * 2;
+        for(uint8_t i = 0; i < count; i++) {
+            const int16_t sample = args[0] * 100 - i;
+            reply[pos++] = sample & 0xFF;
+            reply[pos++] = (uint16_t)sample >> 8;
+        }
+        break;
+    }
+    case BtRpcMethodCallService:
+        reply[pos++] = memcmp(args, "switch.toggle ", 14) == 0 ? BtRpcStatusOk :
+                                                                 BtRpcStatusError;
+        break;
+    default:
+        reply[pos++] = BtRpcStatusUnknownMethod;
+        break;
+    }
+    return pos;
+}
+
+static bool server_send(void* context, uint8_t* data, size_t len) {
+    FakeServer* server = context;
+    if(server->link_down) {
+        return false;
+    }
+    server->requests++;
+    const size_t index = server->replies_count++;
+    server->replies_len[index] = server_reply(data, len, server->replies[index]);
+    return true;
+}
+
+static void deliver(BtRpc* rpc, FakeServer* server, size_t index, uint32_t now) {
+    bt_rpc_on_packet(rpc, server->replies[index], server->replies_len[index], now);
+}
+
+static void on_result(void* context, uint8_t status, const uint8_t* reply, size_t len) {
+    Result* result = context;
+    result->calls++;
+    result->status = status;
+    if(reply) {
+        result->samples_count = bt_rpc_samples(
+            reply, len, result->samples, COUNT_OF(result->samples));
+        bool has_flags;
+        int16_t ack;
+        bt_tlv_decode(reply, len, &result->update, &has_flags, &ack);
+    }
+}
+
+static void test_loopback(void) {
+    FakeServer server = {0};
+    BtRpc rpc;
+    bt_rpc_init(&rpc, server_send, &server, 250);
+    Result entities = {0};
+    Result history = {0};
+    Result service = {0};
+
+    const uint16_t mask = (1 << HaEntityKitchenTemp) | (1 << HaEntityCo2);
+    CHECK_EQ(bt_rpc_get_entities(&rpc, mask, TIMEOUT, on_result, &entities, 0), 250);
+    CHECK_EQ(bt_rpc_get_history(&rpc, HaEntityCo2, 3600, 5, TIMEOUT, on_result, &history, 0), 251);
+    CHECK_EQ(
+        bt_rpc_call_service(
+            &rpc, "switch.toggle", "switch.dehum", TIMEOUT, on_result, &service, 0),
+        252);
+    CHECK(bt_rpc_in_flight(&rpc, BtRpcMethodGetHistory));
+
+    // Replies come back in any order
+    deliver(&rpc, &server, 1, 40);
+    deliver(&rpc, &server, 2, 50);
+    deliver(&rpc, &server, 0, 60);
+    CHECK(!bt_rpc_in_flight(&rpc, BtRpcMethodGetHistory));
+    CHECK_EQ(bt_rpc_run(&rpc, 60), UINT32_MAX);
+
+    CHECK_EQ(entities.calls, 1);
+    CHECK_EQ(entities.status, BtRpcStatusOk);
+    CHECK_EQ(entities.update.valid, mask);
+    CHECK_EQ(entities.update.values[HaEntityCo2], HaEntityCo2);
+    CHECK_EQ(history.samples_count, 5);
+    CHECK_EQ(history.samples[0], HaEntityCo2 * 100);
+    CHECK_EQ(history.samples[4], HaEntityCo2 * 100 - 4);
+    CHECK_EQ(service.status, BtRpcStatusOk);
+    CHECK_EQ(rpc.replies, 3);
+    CHECK_EQ(rpc.latency_max_ms, 60);
+
+    // Unknown method, then a duplicated reply matches no call
+    Result unknown = {0};
+    CHECK_EQ(bt_rpc_call(&rpc, 9, NULL, 0, TIMEOUT, on_result, &unknown, 100), 253);
+    deliver(&rpc, &server, 3, 110);
+    CHECK_EQ(unknown.status, BtRpcStatusUnknownMethod);
+    deliver(&rpc, &server, 3, 120);
+    CHECK_EQ(unknown.calls, 1);
+    CHECK_EQ(rpc.unmatched, 1);
+}
+
+static void test_timeouts(void) {
+    FakeServer server = {0};
+    BtRpc rpc;
+    bt_rpc_init(&rpc, server_send, &server, 0);
+    Result results[BT_RPC_MAX_CALLS] = {0};
+    for(uint32_t i = 0; i < BT_RPC_MAX_CALLS; i++) {
+        CHECK_EQ(
+            bt_rpc_get_entities(&rpc, 1, TIMEOUT + i * 100, on_result, &results[i], 0), (int)i);
+    }
+    // All the calls in flight
+    CHECK_EQ(bt_rpc_get_entities(&rpc, 1, TIMEOUT, NULL, NULL, 0), BT_RPC_NO_CALL);
+    CHECK_EQ(server.requests, BT_RPC_MAX_CALLS);
+
+    CHECK_EQ(bt_rpc_run(&rpc, 100), TIMEOUT - 100);
+    CHECK_EQ(bt_rpc_run(&rpc, TIMEOUT), 100);
+    CHECK_EQ(results[0].calls, 1);
+    CHECK_EQ(results[0].status, BtRpcStatusTimeout);
+    CHECK_EQ(results[1].calls, 0);
+
+    // A late reply doesn't complete anything, the freed slot takes a new call
+    deliver(&rpc, &server, 0, TIMEOUT + 10);
+    CHECK_EQ(results[0].calls, 1);
+    CHECK_EQ(rpc.unmatched, 1);
+    deliver(&rpc, &server, 1, TIMEOUT + 10);
+    CHECK_EQ(results[1].status, BtRpcStatusOk);
+    CHECK_EQ(bt_rpc_get_entities(&rpc, 1, TIMEOUT, NULL, NULL, TIMEOUT + 10), 4);
+
+    // The first call, the two left and the new one
+    CHECK_EQ(bt_rpc_run(&rpc, 10 * TIMEOUT), UINT32_MAX);
+    CHECK_EQ(rpc.timeouts, 4);
+}
+
+static void test_ids(void) {
+    FakeServer server = {0};
+    BtRpc rpc;
+    bt_rpc_init(&rpc, server_send, &server, UINT8_MAX);
+    // The id wraps, and skips one still in flight
+    CHECK_EQ(bt_rpc_get_entities(&rpc, 1, 100000, NULL, NULL, 0), UINT8_MAX);
+    for(uint32_t i = 0; i < UINT8_MAX; i++) {
+        const int16_t id = bt_rpc_get_entities(&rpc, 1, TIMEOUT, NULL, NULL, 0);
+        CHECK_EQ(id, (int16_t)i);
+        deliver(&rpc, &server, server.replies_count - 1, 0);
+        server.replies_count--;
+    }
+    CHECK_EQ(bt_rpc_get_entities(&rpc, 1, TIMEOUT, NULL, NULL, 0), 0);
+
+    // Nothing is in flight if the packet can't be sent
+    bt_rpc_init(&rpc, server_send, &server, 0);
+    server.link_down = true;
+    CHECK_EQ(bt_rpc_get_entities(&rpc, 1, TIMEOUT, NULL, NULL, 0), BT_RPC_NO_CALL);
+    CHECK(!bt_rpc_in_flight(&rpc, BtRpcMethodGetEntities));
+    CHECK_EQ(rpc.sent, 0);
+
+    // Packets that aren't replies are left to the caller
+    const uint8_t values[] = {BT_TLV_MAGIC, BT_TLV_VERSION, BT_TLV_TYPE_SEQ, 1, 3};
+    CHECK(!bt_rpc_on_packet(&rpc, values, sizeof(values), 0));
+}
+
+int main(void) {
+    test_loopback();
+    test_timeouts();
+    test_ids();
+    return test_done("bt_rpc");
+}
@@ -0,0 +1,92 @@
+#include "test.h"
+#include "cmd_channel.h"
+
+#define TIMEOUT 1000U
+
+static void test_acknowledged(void) {
+    CmdChannel cmd;
+    cmd_channel_reset(&cmd, 41);
+    uint32_t wait_ms;
+    CHECK_EQ(cmd_channel_update(&cmd, 0, &wait_ms), CmdChannelActionNone);
+    CHECK_EQ(wait_ms, UINT32_MAX);
+
+    CHECK(cmd_channel_submit(&cmd, 2, 100, TIMEOUT));
+    CHECK_EQ(cmd.seq, 42);
+    // Busy until acknowledged
+    CHECK(!cmd_channel_submit(&cmd, 3, 100, TIMEOUT));
+    CHECK_EQ(cmd_channel_update(&cmd, 100, &wait_ms), CmdChannelActionSend);
+    CHECK_EQ(wait_ms, TIMEOUT);
+    CHECK_EQ(cmd_channel_update(&cmd, 400, &wait_ms), CmdChannelActionNone);
+    CHECK_EQ(wait_ms, TIMEOUT - 300);
+
+    // The sender still acknowledges the previous command
+    CHECK(!cmd_channel_on_ack(&cmd, 41, 500));
+    CHECK(cmd_channel_on_ack(&cmd, 42, 600));
+    CHECK_EQ(cmd.state, CmdChannelIdle);
+    CHECK_EQ(cmd.latency_last_ms, 500);
+    // Repeated in the following frames
+    CHECK(!cmd_channel_on_ack(&cmd, 42, 700));
+    CHECK_EQ(cmd.acked, 1);
+    CHECK(cmd_channel_submit(&cmd, 3, 800, TIMEOUT));
+}
+
+static void test_retries_then_give_up(void) {
+    CmdChannel cmd;
+    cmd_channel_reset(&cmd, 0);
+    uint32_t wait_ms;
+    CHECK(cmd_channel_submit(&cmd, 1, 0, TIMEOUT));
+    uint32_t now = 0;
+    for(uint32_t attempt = 0; attempt < CMD_CHANNEL_MAX_ATTEMPTS; attempt++) {
+        CHECK_EQ(cmd_channel_update(&cmd, now, &wait_ms), CmdChannelActionSend);
+        // Every retry waits twice as long
+        CHECK_EQ(wait_ms, TIMEOUT << attempt);
+        CHECK_EQ(cmd_channel_update(&cmd, now + wait_ms - 1, &wait_ms), CmdChannelActionNone);
+        CHECK_EQ(wait_ms, 1);
+        now += TIMEOUT << attempt;
+    }
+    CHECK(!cmd_channel_failed_recently(&cmd, now));
+    CHECK_EQ(cmd_channel_update(&cmd, now, &wait_ms), CmdChannelActionGiveUp);
+    CHECK_EQ(cmd.state, CmdChannelIdle);
+    CHECK_EQ(cmd.sent, CMD_CHANNEL_MAX_ATTEMPTS);
+    CHECK_EQ(cmd.retries, CMD_CHANNEL_MAX_ATTEMPTS - 1);
+    CHECK_EQ(cmd.failed, 1);
+
+    CHECK(cmd_channel_failed_recently(&cmd, now));
+    CHECK(cmd_channel_failed_recently(&cmd, now + CMD_CHANNEL_FAILED_SHOW_MS - 1));
+    CHECK(!cmd_channel_failed_recently(&cmd, now + CMD_CHANNEL_FAILED_SHOW_MS));
+
+    // A late acknowledgement doesn't revive it
+    CHECK(!cmd_channel_on_ack(&cmd, cmd.seq, now + 10));
+    CHECK_EQ(cmd.acked, 0);
+}
+
+static void test_timeout_capped(void) {
+    CmdChannel cmd;
+    cmd_channel_reset(&cmd, 0);
+    uint32_t wait_ms;
+    CHECK(cmd_channel_submit(&cmd, 1, 0, CMD_CHANNEL_MAX_TIMEOUT_MS / 2 + 1));
+    cmd_channel_update(&cmd, 0, &wait_ms);
+    const uint32_t now = wait_ms;
+    CHECK_EQ(cmd_channel_update(&cmd, now, &wait_ms), CmdChannelActionSend);
+    CHECK_EQ(wait_ms, CMD_CHANNEL_MAX_TIMEOUT_MS);
+    CHECK_EQ(cmd_channel_update(&cmd, now + 1, &wait_ms), CmdChannelActionNone);
+    CHECK_EQ(wait_ms, CMD_CHANNEL_MAX_TIMEOUT_MS - 1);
+}
+
+static void test_seq_wraps(void) {
+    CmdChannel cmd;
+    cmd_channel_reset(&cmd, UINT8_MAX);
+    uint32_t wait_ms;
+    CHECK(cmd_channel_submit(&cmd, 1, 0, TIMEOUT));
+    CHECK_EQ(cmd_channel_update(&cmd, 0, &wait_ms), CmdChannelActionSend);
+    CHECK(!cmd_channel_on_ack(&cmd, UINT8_MAX, 10));
+    CHECK(cmd_channel_on_ack(&cmd, 0, 10));
+}
+
+int main(void) {
+    test_acknowledged();
+    test_retries_then_give_up();
+    test_timeout_capped();
+    test_seq_wraps();
+    return test_done("cmd_channel");
+}
@@ -0,0 +1,170 @@
+#include "test.h"
+#include "ha_history.h"
+
+#define RESOLUTION_S 60U
+#define START        1700000000U
+
+/**
+ * @brief      Push a single entity value at a slot.
+*/
+static void push(HaHistory* history, uint32_t slot, HaEntity entity, int16_t value) {
+    HaSnapshot snapshot = {0};
+    snapshot.timestamp = START + slot * RESOLUTION_S;
+    snapshot.valid = 1 << entity;
+    snapshot.values[entity] = value;
+    ha_history_push(history, &snapshot);
+}
+
+static void test_empty(void) {
+    HaHistory* history = ha_history_alloc(RESOLUTION_S);
+    HaHistoryStats stats;
+    CHECK(!ha_history_stats(history, HaEntityBedroomTemp, &stats));
+    ha_history_free(history);
+}
+
+static void test_small_steps(void) {
+    HaHistory* history = ha_history_alloc(RESOLUTION_S);
+    const int16_t values[] = {215, 216, 214, 220, 219};
+    for(size_t i = 0; i < COUNT_OF(values); i++) {
+        push(history, i, HaEntityBedroomTemp, values[i]);
+    }
+    HaHistoryStats stats;
+    CHECK(ha_history_stats(history, HaEntityBedroomTemp, &stats));
+    CHECK_EQ(stats.min, 214);
+    CHECK_EQ(stats.max, 220);
+    CHECK_EQ(stats.last, 219);
+    CHECK_EQ(stats.count, COUNT_OF(values));
+    CHECK(!ha_history_stats(history, HaEntityKitchenTemp, &stats));
+    ha_history_free(history);
+}
+
+static void test_gap_repeats_last(void) {
+    HaHistory* history = ha_history_alloc(RESOLUTION_S);
+    push(history, 0, HaEntityCo2, 600);
+    push(history, 10, HaEntityCo2, 650);
+    HaHistoryStats stats;
+    CHECK(ha_history_stats(history, HaEntityCo2, &stats));
+    // The missing slots hold the value before the gap
+    CHECK_EQ(stats.count, 11);
+    CHECK_EQ(stats.min, 600);
+    CHECK_EQ(stats.max, 650);
+    CHECK_EQ(stats.last, 650);
+    ha_history_free(history);
+}
+
+static void test_same_slot_replaces(void) {
+    HaHistory* history = ha_history_alloc(RESOLUTION_S);
+    push(history, 0, HaEntityOutsideHum, 500);
+    push(history, 1, HaEntityOutsideHum, 510);
+    push(history, 1, HaEntityOutsideHum, 900);
+    push(history, 1, HaEntityOutsideHum, 505);
+    HaHistoryStats stats;
+    CHECK(ha_history_stats(history, HaEntityOutsideHum, &stats));
+    CHECK_EQ(stats.count, 2);
+    CHECK_EQ(stats.max, 505);
+    CHECK_EQ(stats.last, 505);
+    ha_history_free(history);
+}
+
+static void test_jumps_are_exact(void) {
+    HaHistory* history = ha_history_alloc(RESOLUTION_S);
+    // Out of the int8 delta range both ways, fewer than the escapes table holds
+    const int16_t values[] = {0, 1000, -1000, 32000, -32000, 5, 300};
+    for(size_t i = 0; i < COUNT_OF(values); i++) {
+        push(history, i, HaEntityOutsideTemp, values[i]);
+    }
+    HaHistoryStats stats;
+    CHECK(ha_history_stats(history, HaEntityOutsideTemp, &stats));
+    CHECK_EQ(stats.min, -32000);
+    CHECK_EQ(stats.max, 32000);
+    CHECK_EQ(stats.last, 300);
+    CHECK_EQ(history->clamped, 0);
+    ha_history_free(history);
+}
+
+static void test_ring_wraps(void) {
+    HaHistory* history = ha_history_alloc(RESOLUTION_S);
+    for(uint32_t i = 0; i < 3 * HA_HISTORY_SAMPLES; i++) {
+        push(history, i, HaEntityKitchenHum, i < 2 * HA_HISTORY_SAMPLES ? 900 : 400 + i % 50);
+    }
+    HaHistoryStats stats;
+    CHECK(ha_history_stats(history, HaEntityKitchenHum, &stats));
+    CHECK_EQ(stats.count, HA_HISTORY_SAMPLES);
+    // The 900 jump back and forth is out of the ring
+    CHECK_EQ(stats.max, 449);
+    CHECK_EQ(stats.min, 400);
+    ha_history_free(history);
+}
+
+/**
+ * @brief      Compare with a plain array of the values for random walks with jumps.
+*/
+static void test_random_against_reference(void) {
+    static int16_t reference[4000];
+    srand(1);
+    for(int round = 0; round < 200; round++) {
+        HaHistory* history = ha_history_alloc(RESOLUTION_S);
+        size_t count = 0;
+        uint32_t slot = 0;
+        int16_t value = 200;
+        const int steps = rand() % 3000 + 1;
+        for(int i = 0; i < steps; i++) {
+            if(rand() % 100 < 3) {
+                value = rand() % 4000 - 2000;
+            } else {
+                value += rand() % 21 - 10;
+            }
+            const bool advance = count == 0 || rand() % 10 != 0;
+            slot += advance ? 1 : 0;
+            push(history, slot, HaEntityBedroomHum, value);
+            if(advance) {
+                reference[count++] = value;
+            } else {
+                reference[count - 1] = value;
+            }
+        }
+
+        const size_t from = count > HA_HISTORY_SAMPLES ? count - HA_HISTORY_SAMPLES : 0;
+        int16_t min = reference[from];
+        int16_t max = reference[from];
+        for(size_t i = from; i < count; i++) {
+            min = MIN(min, reference[i]);
+            max = MAX(max, reference[i]);
+        }
+        HaHistoryStats stats;
+        CHECK(ha_history_stats(history, HaEntityBedroomHum, &stats));
+        CHECK_EQ(stats.count, count - from);
+        CHECK_EQ(stats.last, reference[count - 1]);
+        // With a full escapes table the jump is smeared, only the bounds can differ
+        if(history->clamped == 0) {
+            CHECK_EQ(stats.min, min);
+            CHECK_EQ(stats.max, max);
+        }
+        ha_history_free(history);
+    }
+}
+
+static void test_sparkline(void) {
+    HaHistory* history = ha_history_alloc(RESOLUTION_S);
+    for(uint32_t i = 0; i < HA_HISTORY_SAMPLES; i++) {
+        push(history, i, HaEntityPm2_5, i % 30);
+    }
+    HaHistoryStats stats;
+    CHECK(ha_history_stats(history, HaEntityPm2_5, &stats));
+    furi_host_canvas_ops = 0;
+    ha_history_draw_sparkline(NULL, history, HaEntityPm2_5, &stats, 0, 12, 128, 40);
+    CHECK(furi_host_canvas_ops > 0);
+    ha_history_free(history);
+}
+
+int main(void) {
+    test_empty();
+    test_small_steps();
+    test_gap_repeats_last();
+    test_same_slot_replaces();
+    test_jumps_are_exact();
+    test_ring_wraps();
+    test_random_against_reference();
+    test_sparkline();
+    return test_done("ha_history");
+}
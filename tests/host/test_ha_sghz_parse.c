@@ -0,0 +1,154 @@
+#include "test.h"
+#include "sghz_ascii.h"
+#include "sghz_frame.h"
+
+#define FUZZ_MESSAGES 200000U
+
+// Every entity, the dehumidifier and its automation
+static const char FULL_MESSAGE[] =
+    "12bt21.5bh45.0kt19.8kh50.2ot-3.2oh88.1co 412pm  12dhon  adoff ";
+
+typedef struct {
+    HaSnapshot snapshot;
+    uint8_t last_counter;
+    SghzAsciiPrints prints;
+} Parser;
+
+static void parser_init(Parser* parser) {
+    memset(parser, 0, sizeof(*parser));
+    parser->last_counter = UINT8_MAX;
+    for(size_t e = 0; e < HaEntityCount; e++) {
+        parser->prints.values[e] = furi_string_alloc();
+    }
+    parser->prints.dehum_sts = furi_string_alloc();
+}
+
+static void parser_free(Parser* parser) {
+    for(size_t e = 0; e < HaEntityCount; e++) {
+        furi_string_free(parser->prints.values[e]);
+    }
+    furi_string_free(parser->prints.dehum_sts);
+}
+
+static SghzAsciiResult parse(Parser* parser, const char* string) {
+    return sghz_ascii_parse(string, &parser->last_counter, &parser->snapshot, &parser->prints);
+}
+
+static const char* print(Parser* parser, HaEntity entity) {
+    return furi_string_get_cstr(parser->prints.values[entity]);
+}
+
+static void test_full_message(void) {
+    CHECK_EQ(strlen(FULL_MESSAGE), SGHZ_ASCII_FRAME_SIZE);
+    Parser parser;
+    parser_init(&parser);
+    CHECK_EQ(parse(&parser, FULL_MESSAGE), SghzAsciiOk);
+    CHECK_EQ(parser.last_counter, 12);
+    CHECK_EQ(parser.snapshot.valid, (1 << HaEntityCount) - 1);
+    CHECK_EQ(parser.snapshot.values[HaEntityBedroomTemp], 215);
+    CHECK_EQ(parser.snapshot.values[HaEntityOutsideTemp], -32);
+    CHECK_EQ(parser.snapshot.values[HaEntityCo2], 412);
+    CHECK_EQ(parser.snapshot.values[HaEntityPm2_5], 12);
+    CHECK(strcmp(print(&parser, HaEntityKitchenHum), "50.2") == 0);
+    CHECK(strcmp(print(&parser, HaEntityCo2), " 412") == 0);
+    CHECK(parser.snapshot.dehum_sts);
+    CHECK(!parser.snapshot.dehum_aut_sts);
+    CHECK(strcmp(furi_string_get_cstr(parser.prints.dehum_sts), "on-M") == 0);
+
+    // The same counter is the same message, even if the content differs
+    CHECK_EQ(parse(&parser, "12bt99.9"), SghzAsciiSameCounter);
+    CHECK_EQ(parser.snapshot.values[HaEntityBedroomTemp], 215);
+    parser_free(&parser);
+}
+
+static void test_changes_only(void) {
+    Parser parser;
+    parser_init(&parser);
+    CHECK_EQ(parse(&parser, "01bt21.5co 412"), SghzAsciiOk);
+    // A string is only set when its value changes, so marks left on it stay
+    furi_string_set_str(parser.prints.values[HaEntityBedroomTemp], "mark");
+    furi_string_set_str(parser.prints.values[HaEntityCo2], "mark");
+    furi_string_set_str(parser.prints.dehum_sts, "mark");
+    CHECK_EQ(parse(&parser, "02bt21.5co 413dhoff "), SghzAsciiOk);
+    CHECK(strcmp(print(&parser, HaEntityBedroomTemp), "mark") == 0);
+    CHECK(strcmp(print(&parser, HaEntityCo2), " 413") == 0);
+    CHECK(strcmp(furi_string_get_cstr(parser.prints.dehum_sts), "mark") == 0);
+    CHECK_EQ(parse(&parser, "03adon  "), SghzAsciiOk);
+    CHECK(strcmp(furi_string_get_cstr(parser.prints.dehum_sts), "off-A") == 0);
+
+    // An empty string is always set
+    furi_string_reset(parser.prints.values[HaEntityCo2]);
+    CHECK_EQ(parse(&parser, "04co 413"), SghzAsciiOk);
+    CHECK(strcmp(print(&parser, HaEntityCo2), " 413") == 0);
+    parser_free(&parser);
+}
+
+static void test_bad_fields(void) {
+    Parser parser;
+    parser_init(&parser);
+    CHECK_EQ(parse(&parser, ""), SghzAsciiNoCounter);
+    CHECK_EQ(parse(&parser, "1"), SghzAsciiNoCounter);
+    CHECK_EQ(parse(&parser, "x1bt21.5"), SghzAsciiNoCounter);
+    CHECK_EQ(parser.snapshot.valid, 0);
+
+    // Unknown tags are skipped, values that aren't numbers are shown but not stored
+    CHECK_EQ(parse(&parser, "05zz12.3bhunavkt19.8"), SghzAsciiOk);
+    CHECK_EQ(parser.snapshot.valid, 1 << HaEntityKitchenTemp);
+    CHECK(strcmp(print(&parser, HaEntityBedroomHum), "unav") == 0);
+
+    // The fields before a truncated one are applied
+    CHECK_EQ(parse(&parser, "06oh88.1ot-3"), SghzAsciiTruncated);
+    CHECK_EQ(parser.snapshot.values[HaEntityOutsideHum], 881);
+    CHECK(!(parser.snapshot.valid & (1 << HaEntityOutsideTemp)));
+    CHECK_EQ(parser.last_counter, 6);
+    parser_free(&parser);
+}
+
+/**
+ * @brief      Random messages and truncations of a valid one, in buffers of their exact
+ *             size so ASan catches any read past the end.
+*/
+static void test_fuzz(void) {
+    static const char alphabet[] = "0123456789.- bhktocpmdaonfz";
+    Parser parser;
+    parser_init(&parser);
+    srand(33);
+    uint32_t ok = 0;
+    for(uint32_t i = 0; i < FUZZ_MESSAGES; i++) {
+        size_t len;
+        char* string;
+        if(i % 2) {
+            len = rand() % (SGHZ_ASCII_FRAME_SIZE + 8);
+            string = malloc(len + 1);
+            for(size_t c = 0; c < len; c++) {
+                string[c] = rand() % 4 ? alphabet[rand() % (sizeof(alphabet) - 1)] :
+                                         1 + rand() % 255;
+            }
+        } else {
+            len = rand() % (SGHZ_ASCII_FRAME_SIZE + 1);
+            string = malloc(len + 1);
+            memcpy(string, FULL_MESSAGE, len);
+            // A new counter each time so the message is parsed
+            if(len >= SGHZ_ASCII_COUNTER_SIZE) {
+                string[0] = '0' + (i / 2 / 10) % 10;
+                string[1] = '0' + (i / 2) % 10;
+            }
+        }
+        string[len] = '\0';
+        const SghzAsciiResult result = parse(&parser, string);
+        ok += result == SghzAsciiOk;
+        CHECK(result <= SghzAsciiTruncated);
+        CHECK_EQ(parser.snapshot.valid & ~((1U << HaEntityCount) - 1), 0);
+        free(string);
+    }
+    CHECK(ok > 0);
+    parser_free(&parser);
+}
+
+int main(void) {
+    test_full_message();
+    test_changes_only();
+    test_bad_fields();
+    test_fuzz();
+    return test_done("ha_sghz_parse");
+}
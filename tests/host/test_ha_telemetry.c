@@ -0,0 +1,197 @@
+#include "test.h"
+#include "ha_telemetry.h"
+
+#define START  1700000000U
+#define PERIOD HA_TELEMETRY_MIN_PERIOD_S
+
+static HaSnapshot snapshot_at(uint32_t n) {
+    HaSnapshot snapshot = {0};
+    snapshot.timestamp = START + n * PERIOD;
+    snapshot.valid = (1 << HaEntityBedroomTemp) | (1 << HaEntityCo2);
+    snapshot.values[HaEntityBedroomTemp] = 200 + n % 40;
+    snapshot.values[HaEntityCo2] = 400 + n;
+    snapshot.dehum_sts = n % 2;
+    snapshot.rssi = -60;
+    snapshot.loss_pct = 3;
+    return snapshot;
+}
+
+/**
+ * @brief      Append records and wait for the writer to take them, the queue never blocks.
+*/
+static void append_records(HaTelemetry* telemetry, uint32_t from, uint32_t to) {
+    HaTelemetryRecord record;
+    for(uint32_t n = from; n < to; n++) {
+        const HaSnapshot snapshot = snapshot_at(n);
+        ha_telemetry_append(telemetry, &snapshot, HaCtrlSghzBtHome, false);
+        while(!ha_telemetry_read(telemetry, n, &record)) {
+            furi_delay_ms(1);
+        }
+    }
+}
+
+/**
+ * @brief      Record expected for a seek, the first at or after the timestamp.
+*/
+static uint32_t expected_seek(uint32_t timestamp, uint32_t count) {
+    if(timestamp <= START) {
+        return 0;
+    }
+    const uint32_t n = (timestamp - START + PERIOD - 1) / PERIOD;
+    return MIN(n, count);
+}
+
+static void check_seeks(HaTelemetry* telemetry, uint32_t count) {
+    CHECK_EQ(ha_telemetry_seek(telemetry, 0), 0);
+    CHECK_EQ(ha_telemetry_seek(telemetry, START), 0);
+    CHECK_EQ(ha_telemetry_seek(telemetry, START + count * PERIOD), count);
+    CHECK_EQ(ha_telemetry_seek(telemetry, UINT32_MAX), count);
+    for(uint32_t timestamp = START - PERIOD; timestamp < START + (count + 1) * PERIOD;
+        timestamp += 3) {
+        CHECK_EQ(ha_telemetry_seek(telemetry, timestamp), expected_seek(timestamp, count));
+    }
+}
+
+static void remove_log(void) {
+    storage_simply_remove(NULL, HA_TELEMETRY_LOG_PATH);
+    storage_simply_remove(NULL, HA_TELEMETRY_IDX_PATH);
+}
+
+static void test_empty(void) {
+    remove_log();
+    HaTelemetry* telemetry = ha_telemetry_alloc();
+    HaSnapshot snapshot;
+    CHECK(!ha_telemetry_load_last(telemetry, &snapshot));
+    CHECK_EQ(ha_telemetry_seek(telemetry, START), 0);
+    ha_telemetry_free(telemetry);
+}
+
+static void test_seek(void) {
+    remove_log();
+    HaTelemetry* telemetry = ha_telemetry_alloc();
+    // A few sectors and a partial one still in the buffer
+    const uint32_t count = 5 * HA_TELEMETRY_RECORDS_PER_SECTOR + 7;
+    append_records(telemetry, 0, count);
+    CHECK_EQ(telemetry->index_len, 5);
+    check_seeks(telemetry, count);
+
+    HaTelemetryRecord record;
+    CHECK(ha_telemetry_read(telemetry, 37, &record));
+    CHECK_EQ(record.timestamp, START + 37 * PERIOD);
+    CHECK_EQ(record.values[HaEntityCo2], 437);
+    CHECK(!ha_telemetry_read(telemetry, count, &record));
+    ha_telemetry_free(telemetry);
+}
+
+static void test_skips_close_snapshots(void) {
+    remove_log();
+    HaTelemetry* telemetry = ha_telemetry_alloc();
+    append_records(telemetry, 0, 1);
+    HaSnapshot snapshot = snapshot_at(0);
+    snapshot.timestamp += PERIOD - 1;
+    ha_telemetry_append(telemetry, &snapshot, HaCtrlWifi, false);
+    snapshot.timestamp = START;
+    ha_telemetry_append(telemetry, &snapshot, HaCtrlWifi, true);
+    append_records(telemetry, 1, 2);
+    HaTelemetryRecord record;
+    CHECK(!ha_telemetry_read(telemetry, 2, &record));
+    ha_telemetry_free(telemetry);
+}
+
+static void test_append_never_waits(void) {
+    remove_log();
+    HaTelemetry* telemetry = ha_telemetry_alloc();
+    append_records(telemetry, 0, 1);
+
+    // The writer is stuck on the SD card, appends drop records instead of waiting
+    furi_check(furi_mutex_acquire(telemetry->mutex, FuriWaitForever) == FuriStatusOk);
+    const uint32_t appended = 2 * HA_TELEMETRY_QUEUE_SIZE;
+    for(uint32_t n = 1; n <= appended; n++) {
+        const HaSnapshot snapshot = snapshot_at(n);
+        ha_telemetry_append(telemetry, &snapshot, HaCtrlWifi, false);
+    }
+    furi_check(furi_mutex_release(telemetry->mutex) == FuriStatusOk);
+    CHECK(telemetry->dropped > 0);
+
+    // The first dropped snapshot isn't taken as logged, it goes in once there's room
+    const uint32_t last = appended - telemetry->dropped;
+    CHECK_EQ(telemetry->last_timestamp, START + last * PERIOD);
+    HaTelemetryRecord record;
+    while(!ha_telemetry_read(telemetry, last, &record)) {
+        furi_delay_ms(1);
+    }
+    CHECK_EQ(record.timestamp, START + last * PERIOD);
+    append_records(telemetry, last + 1, last + 2);
+    CHECK(ha_telemetry_read(telemetry, last + 1, &record));
+    CHECK_EQ(record.timestamp, START + (last + 1) * PERIOD);
+    ha_telemetry_free(telemetry);
+}
+
+static void test_reopen(void) {
+    remove_log();
+    const uint32_t count = 3 * HA_TELEMETRY_RECORDS_PER_SECTOR + 5;
+    HaTelemetry* telemetry = ha_telemetry_alloc();
+    append_records(telemetry, 0, count);
+    ha_telemetry_free(telemetry);
+
+    // The partial sector is reloaded and completed
+    telemetry = ha_telemetry_alloc();
+    HaSnapshot snapshot;
+    CHECK(ha_telemetry_load_last(telemetry, &snapshot));
+    CHECK_EQ(snapshot.timestamp, START + (count - 1) * PERIOD);
+    CHECK_EQ(snapshot.values[HaEntityCo2], 400 + count - 1);
+    CHECK_EQ(snapshot.rssi, -60);
+    append_records(telemetry, count, count + HA_TELEMETRY_RECORDS_PER_SECTOR);
+    check_seeks(telemetry, count + HA_TELEMETRY_RECORDS_PER_SECTOR);
+    ha_telemetry_free(telemetry);
+
+    // A lost index is rebuilt from the log
+    storage_simply_remove(NULL, HA_TELEMETRY_IDX_PATH);
+    telemetry = ha_telemetry_alloc();
+    CHECK(ha_telemetry_load_last(telemetry, &snapshot));
+    CHECK_EQ(telemetry->index_len, 5);
+    check_seeks(telemetry, count + HA_TELEMETRY_RECORDS_PER_SECTOR);
+    ha_telemetry_free(telemetry);
+}
+
+static void test_window(void) {
+    remove_log();
+    const uint32_t count = 20 * HA_TELEMETRY_RECORDS_PER_SECTOR;
+    HaTelemetry* telemetry = ha_telemetry_alloc();
+    append_records(telemetry, 0, count);
+
+    HaTelemetryWindow window;
+    CHECK(!ha_telemetry_get_window(telemetry, &window));
+    ha_telemetry_request_window(
+        telemetry, HaEntityCo2, START + 10 * PERIOD, START + (count - 10) * PERIOD);
+    while(!ha_telemetry_get_window(telemetry, &window)) {
+        furi_delay_ms(1);
+    }
+    CHECK_EQ(window.count, HA_TELEMETRY_WINDOW_POINTS);
+    CHECK_EQ(window.points[0], 410);
+    bool increasing = true;
+    for(size_t i = 1; i < window.count; i++) {
+        increasing &= window.points[i] > window.points[i - 1];
+    }
+    CHECK(increasing);
+    CHECK(window.points[window.count - 1] < (int16_t)(400 + count - 10));
+
+    // An entity never logged gives an empty window
+    ha_telemetry_request_window(telemetry, HaEntityOutsideHum, START, START + count * PERIOD);
+    while(!ha_telemetry_get_window(telemetry, &window)) {
+        furi_delay_ms(1);
+    }
+    CHECK_EQ(window.count, 0);
+    ha_telemetry_free(telemetry);
+}
+
+int main(void) {
+    test_empty();
+    test_seek();
+    test_skips_close_snapshots();
+    test_append_never_waits();
+    test_reopen();
+    test_window();
+    remove_log();
+    return test_done("ha_telemetry");
+}
@@ -0,0 +1,96 @@
+#include "test.h"
+#include "sghz_fec.h"
+
+static size_t coded_frame(uint8_t counter, uint8_t* frame, uint8_t* coded) {
+    HaSnapshot snapshot = {0};
+    snapshot.valid = (1 << HaEntityCount) - 1;
+    for(size_t e = 0; e < HaEntityCount; e++) {
+        snapshot.values[e] = (int16_t)(e * 777 + counter);
+    }
+    const size_t len = sghz_frame_encode(&snapshot, counter, frame, SGHZ_FRAME_MAX_SIZE);
+    sghz_fec_encode(frame, len, coded, SGHZ_FEC_FRAME_SIZE);
+    return len;
+}
+
+static void flip(uint8_t* coded, size_t bit) {
+    coded[1 + bit / 8] ^= 1 << (bit % 8);
+}
+
+static void test_round_trip(void) {
+    uint8_t frame[SGHZ_FRAME_MAX_SIZE];
+    uint8_t coded[SGHZ_FEC_FRAME_SIZE];
+    const size_t len = coded_frame(1, frame, coded);
+    CHECK_EQ(coded[0], SGHZ_FEC_MAGIC);
+    uint8_t out[SGHZ_FRAME_MAX_SIZE];
+    memset(out, 0xEE, sizeof(out));
+    CHECK_EQ(sghz_fec_decode(coded, out), 0);
+    CHECK(memcmp(out, frame, len) == 0);
+    // The padding decodes to zeros
+    for(size_t i = len; i < SGHZ_FRAME_MAX_SIZE; i++) {
+        CHECK_EQ(out[i], 0);
+    }
+
+    CHECK_EQ(sghz_fec_encode(frame, SGHZ_FRAME_MAX_SIZE + 1, coded, sizeof(coded)), 0);
+    CHECK_EQ(sghz_fec_encode(frame, len, coded, sizeof(coded) - 1), 0);
+}
+
+static void test_single_bit_errors(void) {
+    uint8_t frame[SGHZ_FRAME_MAX_SIZE];
+    uint8_t coded[SGHZ_FEC_FRAME_SIZE];
+    const size_t len = coded_frame(2, frame, coded);
+    uint8_t out[SGHZ_FRAME_MAX_SIZE];
+    for(size_t bit = 0; bit < SGHZ_FEC_CODED_SIZE * 8; bit++) {
+        flip(coded, bit);
+        CHECK_EQ(sghz_fec_decode(coded, out), 1);
+        CHECK(memcmp(out, frame, len) == 0);
+        flip(coded, bit);
+    }
+}
+
+static void test_bursts(void) {
+    uint8_t frame[SGHZ_FRAME_MAX_SIZE];
+    uint8_t coded[SGHZ_FEC_FRAME_SIZE];
+    const size_t len = coded_frame(3, frame, coded);
+    uint8_t out[SGHZ_FRAME_MAX_SIZE];
+    // A burst as long as the number of codewords hits each of them once
+    for(size_t start = 0; start + SGHZ_FEC_CODED_SIZE <= SGHZ_FEC_CODED_SIZE * 8; start += 5) {
+        uint8_t burst[SGHZ_FEC_FRAME_SIZE];
+        memcpy(burst, coded, sizeof(burst));
+        for(size_t bit = start; bit < start + SGHZ_FEC_CODED_SIZE; bit++) {
+            flip(burst, bit);
+        }
+        CHECK_EQ(sghz_fec_decode(burst, out), (int32_t)SGHZ_FEC_CODED_SIZE);
+        CHECK(memcmp(out, frame, len) == 0);
+    }
+
+    // One bit longer puts two errors in a codeword, detected but not corrected
+    for(size_t bit = 0; bit <= SGHZ_FEC_CODED_SIZE; bit++) {
+        flip(coded, bit);
+    }
+    CHECK_EQ(sghz_fec_decode(coded, out), -1);
+}
+
+static void test_double_errors(void) {
+    uint8_t frame[SGHZ_FRAME_MAX_SIZE];
+    uint8_t coded[SGHZ_FEC_FRAME_SIZE];
+    coded_frame(4, frame, coded);
+    uint8_t out[SGHZ_FRAME_MAX_SIZE];
+    // Any two bits of the same codeword
+    for(uint8_t a = 0; a < 8; a++) {
+        for(uint8_t b = a + 1; b < 8; b++) {
+            flip(coded, a * SGHZ_FEC_CODED_SIZE + 7);
+            flip(coded, b * SGHZ_FEC_CODED_SIZE + 7);
+            CHECK_EQ(sghz_fec_decode(coded, out), -1);
+            flip(coded, a * SGHZ_FEC_CODED_SIZE + 7);
+            flip(coded, b * SGHZ_FEC_CODED_SIZE + 7);
+        }
+    }
+}
+
+int main(void) {
+    test_round_trip();
+    test_single_bit_errors();
+    test_bursts();
+    test_double_errors();
+    return test_done("sghz_fec");
+}
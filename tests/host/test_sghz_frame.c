@@ -0,0 +1,136 @@
+#include "test.h"
+#include "sghz_frame.h"
+
+static HaSnapshot full_snapshot(void) {
+    HaSnapshot snapshot = {0};
+    snapshot.valid = (1 << HaEntityCount) - 1;
+    for(size_t e = 0; e < HaEntityCount; e++) {
+        snapshot.values[e] = (int16_t)(e * 1000 - 3000);
+    }
+    snapshot.dehum_sts = true;
+    return snapshot;
+}
+
+static void test_crc(void) {
+    // Check value of CRC-16/CCITT-FALSE
+    CHECK_EQ(sghz_frame_crc16((const uint8_t*)"123456789", 9), 0x29B1);
+    CHECK_EQ(sghz_frame_crc16(NULL, 0), 0xFFFF);
+}
+
+static void test_round_trip(void) {
+    uint8_t buffer[SGHZ_FRAME_MAX_SIZE];
+    HaSnapshot in = full_snapshot();
+    const size_t len = sghz_frame_encode(&in, 42, buffer, sizeof(buffer));
+    CHECK_EQ(len, SGHZ_FRAME_HEADER_SIZE + HaEntityCount * 2 + SGHZ_FRAME_CRC_SIZE);
+    CHECK_EQ(len, sghz_frame_length(buffer[3], buffer[4]));
+
+    HaSnapshot out = {0};
+    uint8_t counter;
+    int16_t ack;
+    CHECK_EQ(sghz_frame_decode(buffer, len, &out, &counter, &ack), SghzFrameOk);
+    CHECK_EQ(counter, 42);
+    CHECK_EQ(ack, SGHZ_FRAME_NO_ACK);
+    CHECK_EQ(out.valid, in.valid);
+    CHECK(out.dehum_sts);
+    CHECK(!out.dehum_aut_sts);
+    CHECK(memcmp(out.values, in.values, sizeof(in.values)) == 0);
+}
+
+static void test_partial(void) {
+    uint8_t buffer[SGHZ_FRAME_MAX_SIZE];
+    HaSnapshot in = {0};
+    in.valid = (1 << HaEntityKitchenHum) | (1 << HaEntityPm2_5);
+    in.values[HaEntityKitchenHum] = 655;
+    in.values[HaEntityPm2_5] = -1;
+    in.dehum_aut_sts = true;
+    const size_t len = sghz_frame_encode(&in, 0, buffer, sizeof(buffer));
+    CHECK_EQ(len, SGHZ_FRAME_HEADER_SIZE + 2 * 2 + SGHZ_FRAME_CRC_SIZE);
+
+    HaSnapshot out = {0};
+    out.values[HaEntityBedroomTemp] = 123;
+    uint8_t counter;
+    int16_t ack;
+    CHECK_EQ(sghz_frame_decode(buffer, len, &out, &counter, &ack), SghzFrameOk);
+    CHECK_EQ(out.valid, in.valid);
+    CHECK_EQ(out.values[HaEntityKitchenHum], 655);
+    CHECK_EQ(out.values[HaEntityPm2_5], -1);
+    // Values not in the frame are left alone
+    CHECK_EQ(out.values[HaEntityBedroomTemp], 123);
+    CHECK(out.dehum_aut_sts);
+
+    CHECK_EQ(sghz_frame_encode(&in, 0, buffer, len - 1), 0);
+}
+
+static void test_ack(void) {
+    // The app never sends values, the sender frame is built by hand
+    uint8_t buffer[SGHZ_FRAME_MAX_SIZE] = {
+        SGHZ_FRAME_MAGIC,
+        SGHZ_FRAME_VERSION,
+        7,
+        1 << HaEntityCo2,
+        SGHZ_FRAME_FLAG_ACK,
+        200,
+        0x20,
+        0x03,
+    };
+    size_t len = 8;
+    const uint16_t crc = sghz_frame_crc16(buffer, len);
+    buffer[len++] = crc & 0xFF;
+    buffer[len++] = crc >> 8;
+    CHECK_EQ(len, sghz_frame_length(buffer[3], buffer[4]));
+
+    HaSnapshot out = {0};
+    uint8_t counter;
+    int16_t ack;
+    CHECK_EQ(sghz_frame_decode(buffer, len, &out, &counter, &ack), SghzFrameOk);
+    CHECK_EQ(ack, 200);
+    CHECK_EQ(out.values[HaEntityCo2], 800);
+}
+
+static void test_errors(void) {
+    uint8_t buffer[SGHZ_FRAME_MAX_SIZE];
+    HaSnapshot in = full_snapshot();
+    const size_t len = sghz_frame_encode(&in, 1, buffer, sizeof(buffer));
+    HaSnapshot out;
+    uint8_t counter;
+    int16_t ack;
+
+    CHECK_EQ(sghz_frame_decode(buffer, 0, &out, &counter, &ack), SghzFrameNotBinary);
+    CHECK_EQ(
+        sghz_frame_decode((const uint8_t*)"0112", 4, &out, &counter, &ack), SghzFrameNotBinary);
+    CHECK_EQ(sghz_frame_decode(buffer, 3, &out, &counter, &ack), SghzFrameBadLength);
+    CHECK_EQ(sghz_frame_decode(buffer, len - 1, &out, &counter, &ack), SghzFrameBadLength);
+
+    // Every single bit error after the magic is caught
+    uint32_t caught = 0;
+    for(size_t bit = 8; bit < len * 8; bit++) {
+        buffer[bit / 8] ^= 1 << (bit % 8);
+        caught += sghz_frame_decode(buffer, len, &out, &counter, &ack) != SghzFrameOk;
+        buffer[bit / 8] ^= 1 << (bit % 8);
+    }
+    CHECK_EQ(caught, len * 8 - 8);
+
+    buffer[1] = SGHZ_FRAME_VERSION + 1;
+    CHECK_EQ(sghz_frame_decode(buffer, len, &out, &counter, &ack), SghzFrameBadVersion);
+}
+
+static void test_cmd(void) {
+    uint8_t buffer[SGHZ_CMD_FRAME_SIZE];
+    CHECK_EQ(sghz_frame_encode_cmd(9, 2, buffer, sizeof(buffer)), SGHZ_CMD_FRAME_SIZE);
+    CHECK_EQ(buffer[0], SGHZ_CMD_MAGIC);
+    CHECK_EQ(buffer[1], SGHZ_CMD_VERSION);
+    CHECK_EQ(buffer[2], 9);
+    CHECK_EQ(buffer[3], 2);
+    CHECK_EQ(buffer[4] | buffer[5] << 8, sghz_frame_crc16(buffer, 4));
+    CHECK_EQ(sghz_frame_encode_cmd(9, 2, buffer, sizeof(buffer) - 1), 0);
+}
+
+int main(void) {
+    test_crc();
+    test_round_trip();
+    test_partial();
+    test_ack();
+    test_errors();
+    test_cmd();
+    return test_done("sghz_frame");
+}
@@ -0,0 +1,87 @@
+#include "test.h"
+#include "sghz_link.h"
+
+static void test_empty(void) {
+    SghzLink link;
+    sghz_link_reset(&link);
+    SghzLinkStats stats;
+    sghz_link_stats(&link, &stats);
+    CHECK_EQ(stats.loss_pct, HA_LINK_UNKNOWN);
+}
+
+static void test_no_loss(void) {
+    SghzLink link;
+    sghz_link_reset(&link);
+    for(uint32_t i = 0; i < 100; i++) {
+        CHECK(sghz_link_on_frame(&link, i % 100, 100, -60 - i % 5));
+    }
+    SghzLinkStats stats;
+    sghz_link_stats(&link, &stats);
+    CHECK_EQ(stats.loss_pct, 0);
+    CHECK_EQ(link.lost, 0);
+    CHECK_EQ(stats.rssi_last, -64);
+    CHECK_EQ(stats.rssi_min, -64);
+    CHECK_EQ(stats.rssi_max, -60);
+    CHECK_EQ(stats.rssi_avg, -62);
+}
+
+static void test_loss_and_wrap(void) {
+    SghzLink link;
+    sghz_link_reset(&link);
+    sghz_link_on_frame(&link, 250, 256, -70);
+    // 251 to 255, 0 and 1 lost across the wrap of the binary counter
+    sghz_link_on_frame(&link, 2, 256, -70);
+    CHECK_EQ(link.lost, 7);
+    SghzLinkStats stats;
+    sghz_link_stats(&link, &stats);
+    CHECK_EQ(stats.loss_pct, 7 * 100 / 9);
+
+    // The ASCII counter wraps at 100
+    sghz_link_reset(&link);
+    sghz_link_on_frame(&link, 98, 100, -70);
+    sghz_link_on_frame(&link, 1, 100, -70);
+    CHECK_EQ(link.lost, 2);
+}
+
+static void test_duplicates(void) {
+    SghzLink link;
+    sghz_link_reset(&link);
+    CHECK(sghz_link_on_frame(&link, 5, 256, -50));
+    CHECK(!sghz_link_on_frame(&link, 5, 256, -50));
+    CHECK_EQ(link.duplicates, 1);
+    CHECK_EQ(link.received, 1);
+}
+
+static void test_window_forgets(void) {
+    SghzLink link;
+    sghz_link_reset(&link);
+    // Every other frame lost, then a clean window
+    for(uint32_t i = 0; i < 20; i++) {
+        sghz_link_on_frame(&link, 2 * i, 256, -80);
+    }
+    uint8_t counter = 2 * 19;
+    SghzLinkStats stats;
+    sghz_link_stats(&link, &stats);
+    CHECK_EQ(stats.loss_pct, 50);
+    for(uint32_t i = 0; i < SGHZ_LINK_WINDOW; i++) {
+        sghz_link_on_frame(&link, ++counter, 256, -40);
+    }
+    sghz_link_stats(&link, &stats);
+    CHECK_EQ(stats.loss_pct, 0);
+    CHECK_EQ(stats.rssi_min, -40);
+    CHECK_EQ(link.lost, 19);
+
+    // A long outage fills the window with losses, the counter can't tell more than a wrap
+    sghz_link_on_frame(&link, counter + 200, 256, -40);
+    sghz_link_stats(&link, &stats);
+    CHECK_EQ(stats.loss_pct, 96);
+}
+
+int main(void) {
+    test_empty();
+    test_no_loss();
+    test_loss_and_wrap();
+    test_duplicates();
+    test_window_forgets();
+    return test_done("sghz_link");
+}
@@ -0,0 +1,199 @@
+#include "test.h"
+#include "sghz_rx.h"
+
+static const char ASCII_FRAME[] =
+    "07bt21.5bh55.0kt20.1kh60.2ot-3.1oh88.0dhon  adoff co0612pm0012";
+
+_Static_assert(sizeof(ASCII_FRAME) - 1 == SGHZ_ASCII_FRAME_SIZE, "Wrong test frame");
+
+/**
+ * @brief      Write bytes through the zero copy interface, in chunks of at most chunk bytes.
+ * @return     the bytes that didn't fit
+*/
+static size_t feed(SghzRx* rx, const uint8_t* data, size_t len, size_t chunk) {
+    while(len > 0) {
+        size_t space;
+        uint8_t* ptr = sghz_rx_write_ptr(rx, &space);
+        const size_t n = MIN(MIN(space, len), chunk);
+        if(n == 0) {
+            break;
+        }
+        memcpy(ptr, data, n);
+        sghz_rx_commit(rx, n);
+        data += n;
+        len -= n;
+    }
+    return len;
+}
+
+static size_t binary_frame(uint8_t counter, uint8_t* buffer) {
+    HaSnapshot snapshot = {0};
+    snapshot.valid = (1 << HaEntityBedroomTemp) | (1 << HaEntityOutsideHum);
+    snapshot.values[HaEntityBedroomTemp] = 215;
+    snapshot.values[HaEntityOutsideHum] = counter;
+    return sghz_frame_encode(&snapshot, counter, buffer, SGHZ_FRAME_MAX_SIZE);
+}
+
+static void test_binary_in_chunks(void) {
+    for(size_t chunk = 1; chunk <= SGHZ_FRAME_MAX_SIZE; chunk++) {
+        SghzRx rx;
+        sghz_rx_reset(&rx);
+        uint8_t in[SGHZ_FRAME_MAX_SIZE];
+        const size_t in_len = binary_frame(3, in);
+        uint8_t frame[SGHZ_ASCII_FRAME_SIZE];
+        size_t len = 0;
+        size_t fed = 0;
+        // Nothing comes out before the last byte
+        while(fed < in_len) {
+            const size_t n = MIN(chunk, in_len - fed);
+            feed(&rx, in + fed, n, n);
+            fed += n;
+            if(fed < in_len) {
+                CHECK_EQ(sghz_rx_next(&rx, frame, &len), SghzRxNone);
+            }
+        }
+        CHECK_EQ(sghz_rx_next(&rx, frame, &len), SghzRxBinary);
+        CHECK_EQ(len, in_len);
+        CHECK(memcmp(frame, in, in_len) == 0);
+        CHECK_EQ(sghz_rx_next(&rx, frame, &len), SghzRxNone);
+    }
+}
+
+static void test_ascii(void) {
+    SghzRx rx;
+    sghz_rx_reset(&rx);
+    uint8_t frame[SGHZ_ASCII_FRAME_SIZE];
+    size_t len;
+    feed(&rx, (const uint8_t*)ASCII_FRAME, SGHZ_ASCII_FRAME_SIZE - 1, 16);
+    CHECK_EQ(sghz_rx_next(&rx, frame, &len), SghzRxNone);
+    feed(&rx, (const uint8_t*)ASCII_FRAME + SGHZ_ASCII_FRAME_SIZE - 1, 1, 1);
+    CHECK_EQ(sghz_rx_next(&rx, frame, &len), SghzRxAscii);
+    CHECK_EQ(len, SGHZ_ASCII_FRAME_SIZE);
+    CHECK(memcmp(frame, ASCII_FRAME, SGHZ_ASCII_FRAME_SIZE) == 0);
+}
+
+static void test_resync(void) {
+    SghzRx rx;
+    sghz_rx_reset(&rx);
+    // Noise, a digit without a tag and a magic with a wrong version before the frame
+    const uint8_t noise[] = {0x00, 'x', '1', '2', '!', SGHZ_FRAME_MAGIC, 0x09, 0xFF, 'A'};
+    uint8_t in[SGHZ_FRAME_MAX_SIZE];
+    const size_t in_len = binary_frame(9, in);
+    feed(&rx, noise, sizeof(noise), sizeof(noise));
+    feed(&rx, in, in_len, in_len);
+    uint8_t frame[SGHZ_ASCII_FRAME_SIZE];
+    size_t len;
+    CHECK_EQ(sghz_rx_next(&rx, frame, &len), SghzRxBinary);
+    CHECK_EQ(rx.resyncs, sizeof(noise));
+    CHECK(memcmp(frame, in, in_len) == 0);
+}
+
+static void test_corrupted_then_valid(void) {
+    SghzRx rx;
+    sghz_rx_reset(&rx);
+    uint8_t in[SGHZ_FRAME_MAX_SIZE];
+    const size_t in_len = binary_frame(1, in);
+    in[6] ^= 0x10;
+    feed(&rx, in, in_len, in_len);
+    binary_frame(2, in);
+    feed(&rx, in, in_len, in_len);
+    uint8_t frame[SGHZ_ASCII_FRAME_SIZE];
+    size_t len;
+    CHECK_EQ(sghz_rx_next(&rx, frame, &len), SghzRxBinary);
+    CHECK_EQ(frame[2], 2);
+    CHECK_EQ(rx.crc_errors, 1);
+}
+
+static void test_stream_wraps_ring(void) {
+    SghzRx rx;
+    sghz_rx_reset(&rx);
+    srand(2);
+    uint32_t binary = 0;
+    uint32_t ascii = 0;
+    for(uint32_t i = 0; i < 500; i++) {
+        uint8_t in[SGHZ_ASCII_FRAME_SIZE];
+        size_t in_len;
+        const bool is_ascii = rand() % 3 == 0;
+        if(is_ascii) {
+            memcpy(in, ASCII_FRAME, SGHZ_ASCII_FRAME_SIZE);
+            in_len = SGHZ_ASCII_FRAME_SIZE;
+        } else {
+            in_len = binary_frame(i, in);
+        }
+        CHECK_EQ(feed(&rx, in, in_len, 1 + rand() % 20), 0);
+
+        uint8_t frame[SGHZ_ASCII_FRAME_SIZE];
+        size_t len;
+        const SghzRxType type = sghz_rx_next(&rx, frame, &len);
+        CHECK_EQ(type, is_ascii ? SghzRxAscii : SghzRxBinary);
+        CHECK(len == in_len && memcmp(frame, in, in_len) == 0);
+        binary += type == SghzRxBinary;
+        ascii += type == SghzRxAscii;
+    }
+    CHECK_EQ(rx.frames, binary + ascii);
+    CHECK_EQ(rx.resyncs, 0);
+    CHECK(rx.head > 4 * SGHZ_RX_RING_SIZE);
+}
+
+static void test_gap_drops_partial(void) {
+    SghzRx rx;
+    sghz_rx_reset(&rx);
+    furi_host_set_tick(1000);
+    uint8_t in[SGHZ_FRAME_MAX_SIZE];
+    const size_t in_len = binary_frame(5, in);
+    feed(&rx, in, 4, 4);
+    furi_host_set_tick(1000 + SGHZ_RX_GAP_MS + 1);
+    feed(&rx, in, in_len, in_len);
+    uint8_t frame[SGHZ_ASCII_FRAME_SIZE];
+    size_t len;
+    CHECK_EQ(sghz_rx_next(&rx, frame, &len), SghzRxBinary);
+    CHECK_EQ(rx.drops, 4);
+    CHECK_EQ(rx.resyncs, 0);
+    furi_host_set_tick(0);
+}
+
+static void test_full_ring(void) {
+    SghzRx rx;
+    sghz_rx_reset(&rx);
+    uint8_t noise[SGHZ_RX_RING_SIZE + 10];
+    memset(noise, '5', sizeof(noise));
+    CHECK_EQ(feed(&rx, noise, sizeof(noise), sizeof(noise)), 10);
+    size_t space;
+    sghz_rx_write_ptr(&rx, &space);
+    CHECK_EQ(space, 0);
+    sghz_rx_drop(&rx, 10);
+    CHECK_EQ(rx.drops, 10);
+    CHECK_EQ(rx.bytes, sizeof(noise));
+}
+
+static void test_fec(void) {
+    SghzRx rx;
+    sghz_rx_reset(&rx);
+    uint8_t in[SGHZ_FRAME_MAX_SIZE];
+    const size_t in_len = binary_frame(77, in);
+    uint8_t coded[SGHZ_FEC_FRAME_SIZE];
+    CHECK_EQ(sghz_fec_encode(in, in_len, coded, sizeof(coded)), SGHZ_FEC_FRAME_SIZE);
+    // A burst in the middle of the coded block
+    for(size_t i = 10; i < 14; i++) {
+        coded[i] ^= 0xFF;
+    }
+    feed(&rx, coded, sizeof(coded), 7);
+    uint8_t frame[SGHZ_ASCII_FRAME_SIZE];
+    size_t len;
+    CHECK_EQ(sghz_rx_next(&rx, frame, &len), SghzRxBinary);
+    CHECK(len == in_len && memcmp(frame, in, in_len) == 0);
+    CHECK_EQ(rx.fec_frames, 1);
+    CHECK_EQ(rx.fec_corrected, 32);
+}
+
+int main(void) {
+    test_binary_in_chunks();
+    test_ascii();
+    test_resync();
+    test_corrupted_then_valid();
+    test_stream_wraps_ring();
+    test_gap_drops_partial();
+    test_full_ring();
+    test_fec();
+    return test_done("sghz_rx");
+}
@@ -0,0 +1,129 @@
+#include "test.h"
+#include "sghz_sched.h"
+
+#define PERIOD  5000U
+#define MODULUS 100U
+
+static void test_learns_period(void) {
+    SghzSched sched;
+    sghz_sched_reset(&sched, PERIOD, 0);
+    uint32_t wait_ms;
+    CHECK(sghz_sched_update(&sched, 0, &wait_ms));
+    CHECK_EQ(wait_ms, SGHZ_SCHED_IDLE_MS);
+
+    sghz_sched_on_frame(&sched, 1000, 10, MODULUS);
+    CHECK(!sched.locked);
+    // A repeated counter is the same frame sent again
+    sghz_sched_on_frame(&sched, 1400, 10, MODULUS);
+    // One frame missed, the interval counts for two periods
+    sghz_sched_on_frame(&sched, 1000 + 2 * 4800, 12, MODULUS);
+    CHECK(!sched.locked);
+    CHECK_EQ(sched.period_ms, 4800);
+    sghz_sched_on_frame(&sched, 1000 + 3 * 4800, 13, MODULUS);
+    CHECK(sched.locked);
+    CHECK_EQ(sched.period_ms, 4800);
+}
+
+static void test_windows(void) {
+    SghzSched sched;
+    sghz_sched_reset(&sched, PERIOD, 0);
+    for(uint32_t i = 0; i < 3; i++) {
+        sghz_sched_on_frame(&sched, i * PERIOD, i, MODULUS);
+    }
+    CHECK(sched.locked);
+    const uint32_t last = 2 * PERIOD;
+
+    uint32_t wait_ms;
+    CHECK(!sghz_sched_update(&sched, last + 1000, &wait_ms));
+    CHECK_EQ(wait_ms, PERIOD - SGHZ_SCHED_WINDOW_MS - 1000);
+    CHECK(sghz_sched_update(&sched, last + PERIOD - 100, &wait_ms));
+    CHECK_EQ(wait_ms, 100 + SGHZ_SCHED_WINDOW_MS);
+
+    // Missed: the window is twice as wide, the late part of this one included
+    CHECK(sghz_sched_update(&sched, last + PERIOD + SGHZ_SCHED_WINDOW_MS + 10, &wait_ms));
+    CHECK_EQ(sched.misses, 1);
+    CHECK_EQ(sched.window_ms, 2 * SGHZ_SCHED_WINDOW_MS);
+    CHECK_EQ(wait_ms, SGHZ_SCHED_WINDOW_MS - 10);
+    CHECK(!sghz_sched_update(&sched, last + PERIOD + 2 * SGHZ_SCHED_WINDOW_MS, &wait_ms));
+    CHECK_EQ(wait_ms, PERIOD - 4 * SGHZ_SCHED_WINDOW_MS);
+    CHECK(sghz_sched_update(&sched, last + 2 * PERIOD - 2 * SGHZ_SCHED_WINDOW_MS, &wait_ms));
+
+    // After SGHZ_SCHED_MAX_MISSES the period is learned again
+    CHECK(sghz_sched_update(&sched, last + 10 * PERIOD, &wait_ms));
+    CHECK(!sched.locked);
+    CHECK_EQ(wait_ms, SGHZ_SCHED_IDLE_MS);
+}
+
+/**
+ * @brief      Run the scheduler against a sender with jitter, the radio only hears frames
+ *             sent while it's on.
+ * @return     the frames received
+*/
+static uint32_t simulate(
+    SghzSched* sched,
+    uint32_t period_ms,
+    uint32_t jitter_ms,
+    uint32_t frames,
+    uint32_t* sent_frames) {
+    uint32_t now = 0;
+    uint32_t next_frame = 700;
+    uint32_t received = 0;
+    uint8_t counter = 0;
+    uint32_t wait_ms = 0;
+    bool radio_on = sghz_sched_update(sched, now, &wait_ms);
+    *sent_frames = 0;
+    while(*sent_frames < frames) {
+        const uint32_t wake = now + wait_ms;
+        if(next_frame <= wake) {
+            now = next_frame;
+            if(radio_on) {
+                sghz_sched_on_frame(sched, now, counter, MODULUS);
+                received++;
+            }
+            counter = (counter + 1) % MODULUS;
+            (*sent_frames)++;
+            next_frame += period_ms - jitter_ms + rand() % (2 * jitter_ms + 1);
+        } else {
+            now = wake;
+        }
+        radio_on = sghz_sched_update(sched, now, &wait_ms);
+    }
+    return received;
+}
+
+static void test_follows_sender(void) {
+    srand(3);
+    SghzSched sched;
+    sghz_sched_reset(&sched, PERIOD, 0);
+    uint32_t sent;
+    const uint32_t received = simulate(&sched, 5200, 50, 500, &sent);
+    CHECK(sched.locked);
+    // The period is tracked, frames are only lost while learning it
+    CHECK(sched.period_ms > 5100 && sched.period_ms < 5300);
+    CHECK(received >= sent - 3);
+
+    // Mostly asleep: the window is a small part of the period
+    sghz_sched_log(&sched, sched.last_rx_tick);
+    const uint32_t total_ms = sched.last_rx_tick - sched.start_tick;
+    CHECK(sched.on_ms * 100 / total_ms < 20);
+}
+
+static void test_learns_far_period(void) {
+    srand(4);
+    SghzSched sched;
+    // The sender runs at more than twice the nominal period
+    sghz_sched_reset(&sched, PERIOD, 0);
+    uint32_t sent;
+    const uint32_t received = simulate(&sched, 12000, 20, 100, &sent);
+    CHECK(sched.locked);
+    CHECK(sched.period_ms > 11900 && sched.period_ms < 12100);
+    CHECK(received >= sent - 3);
+}
+
+int main(void) {
+    test_learns_period();
+    test_windows();
+    test_follows_sender();
+    test_learns_far_period();
+    return test_done("sghz_sched");
+}
@@ -0,0 +1,85 @@
+#include "test.h"
+#include <libs/spsc_queue.h>
+
+#define STRESS_ITEMS 1000000U
+
+typedef struct {
+    uint32_t seq;
+    uint32_t check;
+} Item;
+
+static void test_fill_and_drain(void) {
+    SpscQueue* queue = spsc_queue_alloc(4, sizeof(Item));
+    Item item;
+    CHECK(!spsc_queue_pop(queue, &item));
+    CHECK(!spsc_queue_peek(queue, &item));
+    CHECK_EQ(spsc_queue_count(queue), 0);
+
+    // Several rounds so the indexes wrap around the buffer
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+    for(uint32_t round = 0; round < 5; round++) {
+        while(spsc_queue_push(queue, &(Item){pushed, ~pushed})) {
+            pushed++;
+        }
+        CHECK_EQ(spsc_queue_count(queue), 4);
+        CHECK(spsc_queue_peek(queue, &item));
+        CHECK_EQ(item.seq, popped);
+        // Peek doesn't remove
+        CHECK_EQ(spsc_queue_count(queue), 4);
+        for(uint32_t i = 0; i < 3; i++) {
+            CHECK(spsc_queue_pop(queue, &item));
+            CHECK_EQ(item.seq, popped);
+            CHECK_EQ(item.check, ~popped);
+            popped++;
+        }
+    }
+    CHECK(spsc_queue_pop(queue, NULL));
+    CHECK_EQ(spsc_queue_count(queue), 0);
+
+    spsc_queue_push(queue, &item);
+    spsc_queue_reset(queue);
+    CHECK_EQ(spsc_queue_count(queue), 0);
+    CHECK(!spsc_queue_pop(queue, &item));
+    spsc_queue_free(queue);
+}
+
+static int32_t producer(void* context) {
+    SpscQueue* queue = context;
+    for(uint32_t seq = 0; seq < STRESS_ITEMS; seq++) {
+        while(!spsc_queue_push(queue, &(Item){seq, seq * 2654435761U})) {
+            furi_thread_yield();
+        }
+    }
+    return 0;
+}
+
+static void test_two_threads(void) {
+    SpscQueue* queue = spsc_queue_alloc(16, sizeof(Item));
+    FuriThread* thread = furi_thread_alloc_ex("Producer", 1024, producer, queue);
+    furi_thread_start(thread);
+
+    // Every item arrives once, in order and whole
+    uint32_t expected = 0;
+    uint32_t errors = 0;
+    while(expected < STRESS_ITEMS) {
+        Item item;
+        if(spsc_queue_pop(queue, &item)) {
+            errors += item.seq != expected || item.check != expected * 2654435761U;
+            expected++;
+        } else {
+            furi_thread_yield();
+        }
+    }
+    CHECK(furi_thread_join(thread));
+    CHECK_EQ(errors, 0);
+    CHECK_EQ(spsc_queue_count(queue), 0);
+    furi_thread_free(thread);
+    spsc_queue_free(queue);
+}
+
+int main(void) {
+    test_fill_and_drain();
+    test_two_threads();
+    return test_done("spsc_queue");
+}
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+"""Decode the Home Remote telemetry log (telemetry.bin) to CSV.
+
+Usage: telemetry_to_csv.py telemetry.bin [output.csv]
+"""
+import csv
+import struct
+import sys
+from datetime import datetime, timezone
+
+# Must match HaTelemetryRecord in src/ha_telemetry.h
+RECORD = struct.Struct("<IBBH8hBbB5x")
+ENTITIES = [
+    ("bedroom_temp", 10),
+    ("bedroom_hum", 10),
+    ("kitchen_temp", 10),
+    ("kitchen_hum", 10),
+    ("outside_temp", 10),
+    ("outside_hum", 10),
+    ("co2", 1),
+    ("pm2_5", 1),
+]
+SOURCES = ["wifi", "sghz", "bt_serial"]
+FLAG_DEHUM = 0b01
+FLAG_DEHUM_AUT = 0b10
+LINK_UNKNOWN = 0xFF
+
+
+def decode(path):
+    with open(path, "rb") as log:
+        while True:
+            data = log.read(RECORD.size)
+            if len(data) < RECORD.size:
+                break
+            timestamp, version, source, valid, *rest = RECORD.unpack(data)
+            values, flags, rssi, loss = rest[:-3], rest[-3], rest[-2], rest[-1]
+            row = {
+                # The Flipper RTC has no timezone, the timestamp is local time
+                "time": datetime.fromtimestamp(timestamp, timezone.utc).strftime("%Y-%m-%d %H:%M:%S"),
+                "version": version,
+                "source": SOURCES[source] if source < len(SOURCES) else source,
+            }
+            for i, (name, scale) in enumerate(ENTITIES):
+                row[name] = values[i] / scale if valid & (1 << i) else ""
+            row["dehum"] = int(bool(flags & FLAG_DEHUM))
+            row["dehum_aut"] = int(bool(flags & FLAG_DEHUM_AUT))
+            # Link quality is only in version 2 records, and only for the Sub-GHz backend
+            row["rssi"] = rssi if version >= 2 and rssi != 0 else ""
+            row["loss_pct"] = loss if version >= 2 and loss != LINK_UNKNOWN else ""
+            yield row
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return 1
+    out = open(sys.argv[2], "w", newline="") if len(sys.argv) > 2 else sys.stdout
+    fields = ["time", "version", "source"] + [name for name, _ in ENTITIES] + ["dehum", "dehum_aut", "rssi", "loss_pct"]
+    writer = csv.DictWriter(out, fieldnames=fields)
+    writer.writeheader()
+    for row in decode(sys.argv[1]):
+        writer.writerow(row)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())